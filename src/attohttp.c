@@ -37,19 +37,145 @@
 #include <strings.h>
 #include <ctype.h>
 #include "attohttp.h"
-#if defined(ATTOHTTP_DIGEST_AUTH)
+#ifdef ATTOHTTP_SSE_QUEUE
+# ifdef __STDC_NO_ATOMICS__
+#  error ATTOHTTP_SSE_QUEUE needs C11 atomics
+# endif
+# include <limits.h>
+# include <stdatomic.h>
+/*
+ * Producers may be interrupt handlers, and an atomic that takes a lock can
+ * deadlock there, so the queue positions have to be lock free.  uint32_t is
+ * either an unsigned int or an unsigned long, so whichever is 32 bits is
+ * checked.
+ */
+# if (UINT_MAX == 0xFFFFFFFF) && (ATOMIC_INT_LOCK_FREE != 2)
+#  error ATTOHTTP_SSE_QUEUE needs a lock free 32 bit atomic, and int is not always lock free here
+# endif
+# if (ULONG_MAX == 0xFFFFFFFF) && (ATOMIC_LONG_LOCK_FREE != 2)
+#  error ATTOHTTP_SSE_QUEUE needs a lock free 32 bit atomic, and long is not always lock free here
+# endif
+#endif
+#if defined(ATTOHTTP_DIGEST_AUTH) || defined(ATTOHTTP_AUTH_SESSION)
+# include <time.h>
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
 # include "md5.h"
 #endif
+#if defined(ATTOHTTP_WEBSOCKET)
+# include "sha1.h"
+#endif
+#if (defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_WEBSOCKET)) && !defined(ATTOHTTP_BASE64_NO_SIMD)
+# if defined(__AVX2__)
+#  include <immintrin.h>
+#  define _attoHTTPBASE64_AVX2
+#  define _attoHTTPBASE64_SSSE3
+# elif defined(__SSSE3__)
+#  include <tmmintrin.h>
+#  define _attoHTTPBASE64_SSSE3
+# endif
+#endif
 
-#define _attoHTTPCheckPage(page)  (!_attoHTTPPageEmpty(page) && (0 == strncmp((char *)_attoHTTP_url, (char *)page.url, sizeof(page.url))))
-#define _attoHTTPDefaultPage() (!_attoHTTPPageEmpty(_attoHTTPDefaultPage) && (strncmp((char *)_attoHTTP_url, "/", sizeof(_attoHTTP_url)) == 0) && (_attoHTTP_url_len == 1))
+#define _attoHTTPCheckPage(url, page)  (!_attoHTTPPageEmpty(page) && (0 == strncmp((char *)(url), (char *)page.url, sizeof(page.url))))
+#define _attoHTTPDefaultPage(url, len) (!_attoHTTPPageEmpty(_attoHTTPDefaultPage) && (strncmp((char *)(url), "/", sizeof(_attoHTTP_url)) == 0) && ((len) == 1))
 #define _attoHTTPPushC(char) _attoHTTP_extra_c = char
 #define _attoHTTPPageEmpty(page) (page.content == NULL)
-#define _attoHTTPServerSentEvents() (strlen(_attoHTTPServerSentEventsPage) && (strncmp((char *)_attoHTTP_url, _attoHTTPServerSentEventsPage, sizeof(_attoHTTP_url)) == 0))
+#define _attoHTTPBodyDone() (_attoHTTP_headersDone && (_attoHTTP_bodyread >= _attoHTTP_bodylength))
 
 #if defined(ATTOHTTP_BASIC_AUTH) && defined(ATTOHTTP_DIGEST_AUTH)
 # error Please choose BASIC auth or DIGEST auth.  Both does not work.
 #endif
+#if ATTOHTTP_MULTIPART_BUFFER_SIZE <= (ATTOHTTP_BOUNDARY_SIZE + 4)
+# error ATTOHTTP_MULTIPART_BUFFER_SIZE must be bigger than ATTOHTTP_BOUNDARY_SIZE + 4
+#endif
+#if ATTOHTTP_SSE_SUBSCRIBERS > 127
+# error ATTOHTTP_SSE_SUBSCRIBERS must be 127 or less
+#endif
+#if (ATTOHTTP_SSE_STREAMS < 1) || (ATTOHTTP_SSE_STREAMS > 127)
+# error ATTOHTTP_SSE_STREAMS must be between 1 and 127
+#endif
+#if ((ATTOHTTP_SSE_RING_SIZE & (ATTOHTTP_SSE_RING_SIZE - 1)) != 0) || (ATTOHTTP_SSE_RING_SIZE > 16384)
+# error ATTOHTTP_SSE_RING_SIZE must be a power of 2, and 16384 or less
+#endif
+#if (ATTOHTTP_SSE_HISTORY < 1) || (ATTOHTTP_SSE_HISTORY > 255)
+# error ATTOHTTP_SSE_HISTORY must be between 1 and 255
+#endif
+#if defined(ATTOHTTP_SSE_QUEUE) && (((ATTOHTTP_SSE_QUEUE_SLOTS & (ATTOHTTP_SSE_QUEUE_SLOTS - 1)) != 0) || (ATTOHTTP_SSE_QUEUE_SLOTS < 2) || (ATTOHTTP_SSE_QUEUE_SLOTS > 128))
+# error ATTOHTTP_SSE_QUEUE_SLOTS must be a power of 2 between 2 and 128
+#endif
+#if defined(ATTOHTTP_WEBSOCKET) && ((ATTOHTTP_WEBSOCKETS < 1) || (ATTOHTTP_WEBSOCKETS > 127))
+# error ATTOHTTP_WEBSOCKETS must be between 1 and 127
+#endif
+#if defined(ATTOHTTP_WEBSOCKET) && ((ATTOHTTP_WEBSOCKET_BUFFER_SIZE < 1) || (ATTOHTTP_WEBSOCKET_BUFFER_SIZE > 32767))
+# error ATTOHTTP_WEBSOCKET_BUFFER_SIZE must be between 1 and 32767
+#endif
+#if defined(ATTOHTTP_WEBSOCKET_DEFLATE) && !defined(ATTOHTTP_WEBSOCKET)
+# error ATTOHTTP_WEBSOCKET_DEFLATE needs ATTOHTTP_WEBSOCKET
+#endif
+#if defined(ATTOHTTP_WEBSOCKET_DEFLATE) && ((ATTOHTTP_WEBSOCKET_DEFLATE_BITS < 8) || (ATTOHTTP_WEBSOCKET_DEFLATE_BITS > 15))
+# error ATTOHTTP_WEBSOCKET_DEFLATE_BITS must be between 8 and 15
+#endif
+#if defined(ATTOHTTP_WEBSOCKET_DEFLATE) && (((1L << ATTOHTTP_WEBSOCKET_DEFLATE_BITS) + ATTOHTTP_WEBSOCKET_BUFFER_SIZE) > 0xFFFF)
+# error The deflate window and ATTOHTTP_WEBSOCKET_BUFFER_SIZE together must be less than 65536
+#endif
+#if defined(ATTOHTTP_AUTH_SESSION) && !defined(ATTOHTTP_BASIC_AUTH) && !defined(ATTOHTTP_DIGEST_AUTH)
+# error ATTOHTTP_AUTH_SESSION needs ATTOHTTP_BASIC_AUTH or ATTOHTTP_DIGEST_AUTH
+#endif
+#if defined(ATTOHTTP_AUTH_SESSION) && (((ATTOHTTP_AUTH_SESSIONS & (ATTOHTTP_AUTH_SESSIONS - 1)) != 0) || (ATTOHTTP_AUTH_SESSIONS > 128))
+# error ATTOHTTP_AUTH_SESSIONS must be a power of 2, and 128 or less
+#endif
+#if (defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)) && (((ATTOHTTP_AUTH_USERS & (ATTOHTTP_AUTH_USERS - 1)) != 0) || (ATTOHTTP_AUTH_USERS < 1) || (ATTOHTTP_AUTH_USERS > 1024))
+# error ATTOHTTP_AUTH_USERS must be a power of 2, and 1024 or less
+#endif
+#if defined(ATTOHTTP_DIGEST_AUTH) && ((ATTOHTTP_DIGEST_CNONCE_SIZE < 2) || (ATTOHTTP_DIGEST_CNONCE_SIZE > 255))
+# error ATTOHTTP_DIGEST_CNONCE_SIZE must be between 2 and 255
+#endif
+#if defined(ATTOHTTP_DIGEST_AUTH) && ((ATTOHTTP_DIGEST_NONCES < 1) || (ATTOHTTP_DIGEST_NONCES > 255))
+# error ATTOHTTP_DIGEST_NONCES must be between 1 and 255
+#endif
+#if (ATTOHTTP_SSE_HIGH_WATER < 1) || (ATTOHTTP_SSE_HIGH_WATER > ATTOHTTP_SSE_RING_SIZE)
+# error ATTOHTTP_SSE_HIGH_WATER must be between 1 and ATTOHTTP_SSE_RING_SIZE
+#endif
+#if defined(ATTOHTTP_LOAD_SHED) && ((ATTOHTTP_SHED_CONNECTIONS < 1) || (ATTOHTTP_SHED_QUEUE < 1) || (ATTOHTTP_SHED_BACKLOG <= ATTOHTTP_SHED_QUEUE))
+# error ATTOHTTP_SHED_CONNECTIONS and ATTOHTTP_SHED_QUEUE must be 1 or more, and ATTOHTTP_SHED_BACKLOG must be bigger than ATTOHTTP_SHED_QUEUE
+#endif
+#if defined(ATTOHTTP_REQUEST_QUEUE) && ((ATTOHTTP_REQUEST_QUEUE_API < 1) || (ATTOHTTP_REQUEST_QUEUE_API > 127) || (ATTOHTTP_REQUEST_QUEUE_STATIC < 1) || (ATTOHTTP_REQUEST_QUEUE_STATIC > 127))
+# error ATTOHTTP_REQUEST_QUEUE_API and ATTOHTTP_REQUEST_QUEUE_STATIC must be between 1 and 127
+#endif
+#if defined(ATTOHTTP_REQUEST_QUEUE) && ((ATTOHTTP_REQUEST_QUEUE_STREAK < 1) || (ATTOHTTP_REQUEST_QUEUE_STREAK > 255))
+# error ATTOHTTP_REQUEST_QUEUE_STREAK must be between 1 and 255
+#endif
+#if defined(ATTOHTTP_DEADLINE) && ((ATTOHTTP_DEADLINE_LINE < 1) || (ATTOHTTP_DEADLINE_HEADERS < ATTOHTTP_DEADLINE_LINE) || (ATTOHTTP_DEADLINE_REQUEST < ATTOHTTP_DEADLINE_HEADERS))
+# error ATTOHTTP_DEADLINE_LINE must be 1 or more, and no bigger than ATTOHTTP_DEADLINE_HEADERS, which must be no bigger than ATTOHTTP_DEADLINE_REQUEST
+#endif
+#if defined(ATTOHTTP_DEADLINE) && (ATTOHTTP_DEADLINE_BODY_RATE < 1)
+# error ATTOHTTP_DEADLINE_BODY_RATE must be 1 or more
+#endif
+#if defined(ATTOHTTP_RATE_LIMIT) && (((ATTOHTTP_RATE_PEERS & (ATTOHTTP_RATE_PEERS - 1)) != 0) || (ATTOHTTP_RATE_PEERS > 128))
+# error ATTOHTTP_RATE_PEERS must be a power of 2, and 128 or less
+#endif
+#if defined(ATTOHTTP_RATE_LIMIT) && ((ATTOHTTP_RATE_BURST < 1) || (ATTOHTTP_RATE_BURST > 65535))
+# error ATTOHTTP_RATE_BURST must be between 1 and 65535
+#endif
+#if defined(ATTOHTTP_RATE_LIMIT) && ((ATTOHTTP_RATE_PER_SEC < 1) || (ATTOHTTP_RATE_PER_SEC > 1000000))
+# error ATTOHTTP_RATE_PER_SEC must be between 1 and 1000000
+#endif
+#if defined(ATTOHTTP_RATE_LIMIT) && ((ATTOHTTP_RATE_CONNECTIONS < 1) || (ATTOHTTP_RATE_CONNECTIONS > 255))
+# error ATTOHTTP_RATE_CONNECTIONS must be between 1 and 255
+#endif
+/** Masks a ring cursor down to an index in _attoHTTPSSERing */
+#define _attoHTTPSSERingIndex(x) ((uint16_t)((x) & (ATTOHTTP_SSE_RING_SIZE - 1)))
+/** The number of ring bytes that still need to go out to a subscriber */
+#define _attoHTTPSSEPending(s) (_attoHTTPSSEHead - (s)->cursor)
+/** The event id after id.  0 means no id, so it is skipped when the ids wrap around. */
+#define _attoHTTPSSEAfter(id) ((uint32_t)((id) + 1) + ((uint32_t)((id) + 1) == 0))
+/** The id that the next event will get.  Subscribers that are caught up sit here. */
+#define _attoHTTPSSENextID() _attoHTTPSSEAfter(_attoHTTPSSELastID)
+/** The history entry for an event id */
+#define _attoHTTPSSEEvent(id) (&_attoHTTPSSEHistory[(id) % ATTOHTTP_SSE_HISTORY])
+/** Turns a number from the config into a string, so it can go in a constant response */
+#define _attoHTTPSTR(x) _attoHTTPSTR_(x)
+#define _attoHTTPSTR_(x) #x
 
 unsigned char favicon_ico[] = {
   0x1f, 0x8b, 0x08, 0x08, 0xbf, 0x58, 0xcd, 0x55, 0x00, 0x03, 0x66, 0x61,
@@ -100,10 +226,18 @@ uint8_t _attoHTTP_url[ATTOHTTP_URL_BUFFER_SIZE];
 int16_t _attoHTTP_extra_c;
 /** @var Pointer to the start of the parameters in the URL */
 uint8_t *_attoHTTP_url_params;
-/** @var The length into the string where the params start */
-uint16_t _attoHTTP_url_params_start;
 /** @var The length of the URL */
 uint16_t _attoHTTP_url_len;
+/** @var The decoded URL parameters.  These point back into _attoHTTP_url */
+attoHTTPParam_t _attoHTTP_url_param[ATTOHTTP_URL_PARAMS];
+/** @var The number of URL parameters found */
+uint8_t _attoHTTP_url_param_count;
+/** @var The next URL parameter that attoHTTPParseURLParam will return */
+uint8_t _attoHTTP_url_param_next;
+/** @var Flag to say the URL parameters have been decoded */
+uint8_t _attoHTTP_url_indexed;
+/** @var Flag to say a parameter could not be decoded */
+uint8_t _attoHTTP_param_error;
 /** @var Pointer to our read parameter */
 void *_attoHTTP_read;
 /** @var Pointer to our write parameter */
@@ -120,16 +254,220 @@ returncode_t _attoHTTP_returnCode;
 uint16_t _attoHTTP_accept;
 /** @var Incoming content type */
 mimetypes_t _attoHTTP_contenttype;
-/** @var Incoming content length */
+/** @var Outgoing content length */
 uint32_t _attoHTTP_contentlength;
+/** @var The Content-Length the client sent, or ATTOHTTP_LENGTH_UNKNOWN */
+uint32_t _attoHTTP_bodylength;
+/** @var The number of bytes of the body that have been read */
+uint32_t _attoHTTP_bodyread;
+/** @var Flag to say the client is waiting for a 100 Continue */
+uint8_t _attoHTTP_expectContinue;
+#ifdef ATTOHTTP_DEADLINE
+/** @var The time in ms that the request started */
+uint32_t _attoHTTP_started;
+/** @var How many ms after _attoHTTP_started the part being read has to be in by */
+uint32_t _attoHTTP_deadline;
+/** @var Flag to say the client took too long, so nothing more will be read */
+uint8_t _attoHTTP_timedOut;
+#endif
+/** @var The multipart boundary from the incoming content type */
+char _attoHTTP_boundary[ATTOHTTP_BOUNDARY_SIZE];
 /** @var Our different pages are stored here */
 attoHTTPPage_t _attoHTTPPages[ATTOHTTP_PAGE_BUFFERS];
 /** @var The default HTTP page is stored here */
 attoHTTPPage_t _attoHTTPDefaultPage;
 /** @var The default API callback function is stored here */
 attoHTTPDefAPICallback _attoHTTPDefaultCallback;
-/** @var The server sent events page is here */
-char _attoHTTPServerSentEventsPage[ATTOHTTP_PAGE_URL_SIZE];
+/** @var The page this request is for, or NULL */
+attoHTTPPage_t *_attoHTTP_page;
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/** @var REST routes that don't need authentication.  Empty ones start with 0. */
+char _attoHTTPAuthRoutes[ATTOHTTP_AUTH_ROUTES][ATTOHTTP_PAGE_URL_SIZE];
+/** @var This request needs authentication */
+uint8_t _attoHTTP_authRequired;
+#endif
+/** @var The settings for each server sent events stream */
+attoHTTPSSEStream_t _attoHTTPSSEStreams[ATTOHTTP_SSE_STREAMS];
+/** @var The number of server sent events streams that have a URL */
+uint8_t _attoHTTPSSEStreamCount;
+/** @var The server sent events stream that this request asked for */
+int8_t _attoHTTP_sseStream;
+/** @var The connections that are subscribed to server sent events */
+attoHTTPSSESubscriber_t _attoHTTPSSESubscribers[ATTOHTTP_SSE_SUBSCRIBERS];
+/** @var This gets called when a new subscriber is added */
+attoHTTPSSESubscribeCallback _attoHTTPSSESubscribeCallback;
+/** @var Events are serialized once into here and then sent to each subscriber */
+uint8_t _attoHTTPSSERing[ATTOHTTP_SSE_RING_SIZE];
+/** @var The total number of bytes that have been put into _attoHTTPSSERing */
+uint32_t _attoHTTPSSEHead;
+/** @var Where the last few published events start in _attoHTTPSSERing */
+attoHTTPSSEHistory_t _attoHTTPSSEHistory[ATTOHTTP_SSE_HISTORY];
+/** @var The id of the last event published */
+uint32_t _attoHTTPSSELastID;
+/** @var The time in ms from the last call to attoHTTPSSEPoll() */
+uint32_t _attoHTTPSSENow;
+/** @var This gets the time when something is sent or published.  NULL uses _attoHTTPSSENow */
+attoHTTPSSEClockCallback _attoHTTPSSEClock;
+/** @var The time the first event that hasn't been flushed was published */
+uint32_t _attoHTTPSSEBatchStart;
+/** @var Flag to say that there are published events waiting on the flush window */
+uint8_t _attoHTTPSSEBatch;
+/** @var The reconnect time in ms to send to new subscribers.  0 doesn't send it */
+uint32_t _attoHTTPSSERetry;
+#ifdef ATTOHTTP_SSE_QUEUE
+/**
+ * @brief One event waiting in the publish queue
+ *
+ * seq says who owns the slot.  When it is equal to the queue position the
+ * slot is free for that position, and when it is one more the event there is
+ * ready to be published.  The event name is at the start of buf, and the data
+ * follows it.  This is kept out of attohttp.h because C++ doesn't have _Atomic.
+ */
+typedef struct {
+    _Atomic uint32_t seq;
+    int8_t stream;
+    uint16_t elen;
+    uint16_t dlen;
+    uint8_t buf[ATTOHTTP_SSE_QUEUE_EVENT_SIZE];
+} attoHTTPSSEQueueSlot_t;
+/** @var Events from other threads wait in here to be published */
+attoHTTPSSEQueueSlot_t _attoHTTPSSEQueueSlots[ATTOHTTP_SSE_QUEUE_SLOTS];
+/** @var The next position in the queue for a producer to claim */
+_Atomic uint32_t _attoHTTPSSEQueueHead;
+/** @var The next position in the queue to publish.  Only attoHTTPSSEDrain() uses this */
+uint32_t _attoHTTPSSEQueueTail;
+#endif
+#ifdef ATTOHTTP_WEBSOCKET
+/** The client sent "Upgrade: websocket" */
+#define _attoHTTPWS_UPGRADE    0x01
+/** The client sent "Connection: Upgrade" */
+#define _attoHTTPWS_CONNECTION 0x02
+/** The client sent "Sec-WebSocket-Version: 13" */
+#define _attoHTTPWS_VERSION    0x04
+/** The client sent a good Sec-WebSocket-Key */
+#define _attoHTTPWS_KEY        0x08
+/** Everything a WebSocket upgrade needs */
+#define _attoHTTPWS_ALL        0x0F
+/** The length of a Sec-WebSocket-Key */
+#define _attoHTTPWS_KEY_SIZE   24
+/** The frame parser states */
+#define _attoHTTPWS_HEADER     0
+#define _attoHTTPWS_LENGTH     1
+#define _attoHTTPWS_EXTLEN     2
+#define _attoHTTPWS_MASK       3
+#define _attoHTTPWS_PAYLOAD    4
+/** @var The URLs that take WebSocket upgrades */
+attoHTTPWebSocketRoute_t _attoHTTPWebSocketRoutes[ATTOHTTP_WEBSOCKET_ROUTES];
+/** @var The open WebSocket connections */
+attoHTTPWebSocket_t _attoHTTPWebSockets[ATTOHTTP_WEBSOCKETS];
+/** @var Flags for the upgrade headers that the client sent */
+uint8_t _attoHTTP_wsUpgrade;
+/** @var The Sec-WebSocket-Key that the client sent */
+char _attoHTTP_wsKey[_attoHTTPWS_KEY_SIZE + 1];
+/** @var The message callback for the WebSocket URL that this request asked for */
+attoHTTPWebSocketCallback _attoHTTP_wsCallback;
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+/** The client sent server_no_context_takeover */
+#define _attoHTTPWS_NO_TAKEOVER  0x01
+/** The client sent server_max_window_bits, so it has to be in the reply */
+#define _attoHTTPWS_WINDOW_BITS  0x02
+/** The bits for the hash table that finds matches */
+#define _attoHTTPWS_HASH_BITS    10
+/** Marks an empty hash chain.  It can't be a place in _attoHTTPDeflateData. */
+#define _attoHTTPWS_NO_MATCH     0xFFFF
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+# define _attoHTTPWS_WINDOW_SIZE 0
+#else
+# define _attoHTTPWS_WINDOW_SIZE (1 << ATTOHTTP_WEBSOCKET_DEFLATE_BITS)
+#endif
+/** @var The window bits for permessage-deflate, or 0 if it wasn't asked for */
+uint8_t _attoHTTP_wsDeflate;
+/** @var Flags for the permessage-deflate parameters the client sent */
+uint8_t _attoHTTP_wsDeflateFlags;
+/** @var The window from the last message, then the message to compress */
+uint8_t _attoHTTPDeflateData[_attoHTTPWS_WINDOW_SIZE + ATTOHTTP_WEBSOCKET_BUFFER_SIZE];
+/** @var The newest place in _attoHTTPDeflateData for each hash */
+uint16_t _attoHTTPDeflateHead[1 << _attoHTTPWS_HASH_BITS];
+/** @var The place before this one in _attoHTTPDeflateData with the same hash */
+uint16_t _attoHTTPDeflatePrev[_attoHTTPWS_WINDOW_SIZE + ATTOHTTP_WEBSOCKET_BUFFER_SIZE];
+/** @var Compressed messages are built here before they are sent */
+uint8_t _attoHTTPDeflateOut[ATTOHTTP_WEBSOCKET_BUFFER_SIZE];
+/** @var Compressed messages from the client are inflated into here */
+uint8_t _attoHTTPInflateOut[ATTOHTTP_WEBSOCKET_BUFFER_SIZE];
+/** @var Base lengths for the deflate length codes */
+static const uint16_t _attoHTTPDeflateLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+/** @var Extra bits for the deflate length codes */
+static const uint8_t _attoHTTPDeflateLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+/** @var Base distances for the deflate distance codes */
+static const uint16_t _attoHTTPDeflateDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+/** @var Extra bits for the deflate distance codes */
+static const uint8_t _attoHTTPDeflateDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+/**
+ * This is where compressed bits go.  Bits go in from the low end, the way
+ * RFC 1951 packs them.  If the output fills up, full gets set and the rest is
+ * thrown away.
+ */
+typedef struct {
+    uint8_t *out;
+    uint16_t size;
+    uint16_t pos;
+    uint32_t bits;
+    uint8_t count;
+    uint8_t full;
+} attoHTTPBitWriter_t;
+/**
+ * This is the state for inflating one message.  When in runs out, the
+ * 0x00 0x00 0xFF 0xFF that RFC 7692 takes off the end is read in its place.
+ */
+typedef struct {
+    const uint8_t *in;
+    uint32_t inlen;
+    uint32_t inpos;
+    uint8_t *out;
+    uint16_t outlen;
+    uint16_t outpos;
+    uint32_t bits;
+    uint8_t count;
+    int8_t error;
+} attoHTTPInflate_t;
+/**
+ * A canonical Huffman code, the way RFC 1951 builds them.  count is how many
+ * codes there are of each length, and symbol has the symbols sorted by code.
+ */
+typedef struct {
+    uint16_t count[16];
+    uint16_t symbol[288];
+} attoHTTPHuffman_t;
+/** @var The fixed literal/length code from RFC 1951, built the first time it is used */
+attoHTTPHuffman_t _attoHTTPInflateFixedLens;
+/** @var The fixed distance code from RFC 1951 */
+attoHTTPHuffman_t _attoHTTPInflateFixedDist;
+/** @var Says the fixed codes are built */
+uint8_t _attoHTTPInflateFixed;
+/** @var The literal/length code for a block with its own codes.  These are kept off the stack. */
+attoHTTPHuffman_t _attoHTTPInflateLens;
+/** @var The distance code for a block with its own codes */
+attoHTTPHuffman_t _attoHTTPInflateDist;
+/** @var The code lengths that _attoHTTPInflateLens and _attoHTTPInflateDist are built from */
+uint8_t _attoHTTPInflateLengths[288 + 32];
+#endif
+#endif
+/** @var The Last-Event-ID that the client sent */
+uint32_t _attoHTTP_lastEventID;
+/** @var Flag to say that _attoHTTP_lastEventID is good */
+uint8_t _attoHTTP_lastEventIDValid;
 
 /** @var The curly brace level we are at */
 uint8_t _attoHTTPParseJSONParam_cblevel;
@@ -147,8 +485,167 @@ static const uint8_t *_authtypes[] = {
     [BASIC_AUTH] = (uint8_t *)"Basic",
     [DIGEST_AUTH] = (uint8_t *)"Digest",
 };
+/** The most users the credential store takes.  It is never more than 3/4 full. */
+#define _attoHTTPAUTH_USERS_MAX (ATTOHTTP_AUTH_USERS - (ATTOHTTP_AUTH_USERS / 4))
+/** @var The credential store.  This is a hash table on the user name. */
+attoHTTPAuthUser_t _attoHTTPAuthUsers[ATTOHTTP_AUTH_USERS];
+/** @var The number of users in _attoHTTPAuthUsers */
+uint16_t _attoHTTPAuthUserCount;
+#endif
+#ifdef ATTOHTTP_DIGEST_AUTH
+/** The length of our nonces in hex */
+#define _attoHTTPDIGEST_NONCE_SIZE 48
+/** @var The last nonce count used with each nonce */
+attoHTTPDigestNonce_t _attoHTTPDigestNonces[ATTOHTTP_DIGEST_NONCES];
+/** @var The newest nonce that was dropped from _attoHTTPDigestNonces */
+uint32_t _attoHTTPDigestEvicted;
+/** @var The count of nonces made.  Every nonce gets the next one */
+uint32_t _attoHTTPDigestNonceID;
+/** @var Counts the times a nonce was used, to find the least recently used one */
+uint32_t _attoHTTPDigestUses;
+/** @var The inner and outer pad states for the nonce MAC */
+MD5_HMAC_KEY _attoHTTPDigestKey;
+/** @var _attoHTTPDigestKey has been set up */
+uint8_t _attoHTTPDigestKeyed;
+/** @var The nonce the client sent was ours, but it was too old */
+uint8_t _attoHTTP_digestStale;
+/** @var The MD5 of the part of the request target that didn't fit in _attoHTTP_url */
+uint8_t _attoHTTP_urlOverMD5[16];
+/** @var The length of the part of the request target that didn't fit in _attoHTTP_url */
+uint16_t _attoHTTP_urlOverLen;
+/** Digest Authorization parameters that are kept until the end of the header */
+#define _attoHTTPDIGEST_USER      0
+#define _attoHTTPDIGEST_NONCE     1
+#define _attoHTTPDIGEST_NC        2
+#define _attoHTTPDIGEST_CNONCE    3
+#define _attoHTTPDIGEST_RESPONSE  4
+/** Digest Authorization parameters that are compared as they come in */
+#define _attoHTTPDIGEST_REALM     5
+#define _attoHTTPDIGEST_QOP       6
+#define _attoHTTPDIGEST_ALGORITHM 7
+/** The uri, which is hashed and compared as it comes in */
+#define _attoHTTPDIGEST_URI       8
+/** The number of parameters we look at.  Anything else is skipped. */
+#define _attoHTTPDIGEST_PARAMS    9
+/** The parameters that have to be there.  That is all of them but algorithm. */
+#define _attoHTTPDIGEST_NEEDED    (((1 << _attoHTTPDIGEST_PARAMS) - 1) & ~(1 << _attoHTTPDIGEST_ALGORITHM))
+/** @var The names of the Digest Authorization parameters */
+static const char *_attoHTTPDigestParams[_attoHTTPDIGEST_PARAMS] = {
+    [_attoHTTPDIGEST_USER] = "username",
+    [_attoHTTPDIGEST_NONCE] = "nonce",
+    [_attoHTTPDIGEST_NC] = "nc",
+    [_attoHTTPDIGEST_CNONCE] = "cnonce",
+    [_attoHTTPDIGEST_RESPONSE] = "response",
+    [_attoHTTPDIGEST_REALM] = "realm",
+    [_attoHTTPDIGEST_QOP] = "qop",
+    [_attoHTTPDIGEST_ALGORITHM] = "algorithm",
+    [_attoHTTPDIGEST_URI] = "uri",
+};
+/**
+ * The parts of a Digest Authorization header, as it is read.  Only the short
+ * parameters are kept.  The uri can be as long as the client wants, so it
+ * goes into the MD5 for HA2 a piece at a time.  Whatever is past the end of
+ * _attoHTTP_url also goes into over, to check against _attoHTTP_urlOverMD5.
+ */
+typedef struct {
+    char user[ATTOHTTP_AUTH_USER_SIZE];
+    char nonce[_attoHTTPDIGEST_NONCE_SIZE + 1];
+    char nc[9];
+    char cnonce[ATTOHTTP_DIGEST_CNONCE_SIZE];
+    char response[33];
+    MD5_CTX ha2;
+    MD5_CTX over;
+    uint8_t uri[32];
+    uint8_t urifill;
+    uint16_t seen;
+    uint16_t bad;
+} attoHTTPDigestFields_t;
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+/** The number of random bytes in a session cookie */
+#define _attoHTTPSESSION_SIZE 16
+/**
+ * This is a session that got a cookie.  The low bits of the first byte of the
+ * token are the index of the session in the table, so a cookie can be found
+ * without searching for it.
+ */
+typedef struct {
+    uint8_t token[_attoHTTPSESSION_SIZE];
+    uint32_t made;
+    uint32_t used;
+    uint8_t valid;
+} attoHTTPSession_t;
+/** @var The sessions */
+attoHTTPSession_t _attoHTTPSessions[ATTOHTTP_AUTH_SESSIONS];
+/** @var Counts the times a session was used, to find the least recently used one */
+uint32_t _attoHTTPSessionUses;
+/** @var The session this request is in, or -1 if there isn't one */
+int8_t _attoHTTP_session;
+/** @var The session is new, so the cookie has to be sent */
+uint8_t _attoHTTP_sessionNew;
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+/** The most slots that are looked at for a peer, starting at its hash */
+#define _attoHTTPRATE_PROBE ((ATTOHTTP_RATE_PEERS < 4) ? ATTOHTTP_RATE_PEERS : 4)
+/** The buckets count in thousandths of a request, so refills don't get rounded away */
+#define _attoHTTPRATE_TOKEN 1000UL
+/** A full bucket */
+#define _attoHTTPRATE_FULL ((uint32_t)ATTOHTTP_RATE_BURST * _attoHTTPRATE_TOKEN)
+/**
+ * This is a client, keyed by its address.  Each one has a bucket of requests
+ * that refills over time, and a count of the connections it has open.
+ */
+typedef struct {
+    uint32_t peer;
+    uint32_t stamp;
+    uint32_t tokens;
+    uint32_t used;
+    uint8_t conns;
+    uint8_t valid;
+} attoHTTPPeer_t;
+/** @var The clients that have been seen lately */
+attoHTTPPeer_t _attoHTTPPeers[ATTOHTTP_RATE_PEERS];
+/** @var Counts the times a peer was let in, to find the least recently used one */
+uint32_t _attoHTTPPeerUses;
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+/** @var The connections waiting to be served.  Each class has its own ring in here. */
+void *_attoHTTPQueue[ATTOHTTP_REQUEST_QUEUE_API + ATTOHTTP_REQUEST_QUEUE_STATIC];
+/** @var Where the ring for each class starts in _attoHTTPQueue */
+static const uint8_t _attoHTTPQueueStart[ATTOHTTP_REQUEST_CLASSES] = {0, ATTOHTTP_REQUEST_QUEUE_API};
+/** @var The size of the ring for each class */
+static const uint8_t _attoHTTPQueueSize[ATTOHTTP_REQUEST_CLASSES] = {ATTOHTTP_REQUEST_QUEUE_API, ATTOHTTP_REQUEST_QUEUE_STATIC};
+/** @var The oldest connection in each ring */
+uint8_t _attoHTTPQueueHead[ATTOHTTP_REQUEST_CLASSES];
+/** @var The number of connections in each ring */
+uint8_t _attoHTTPQueueLen[ATTOHTTP_REQUEST_CLASSES];
+/** @var The API requests that have been served in a row while static ones waited */
+uint8_t _attoHTTPQueueStreak;
 #endif
 
+/** @var Pages for server sent events streams point here, so they aren't empty */
+static const uint8_t _attoHTTPSSEStreamPage[] = "";
+/** @var This is sent to subscribers that have been idle too long */
+static const uint8_t _attoHTTPSSEHeartbeat[] = ":\n\n";
+/** @var This is sent to clients that take too long to send their request */
+static const uint8_t _attoHTTPReject408[] =
+    HTTP_VERSION " 408 Request Timeout" HTTPEOL
+    "Connection: close" HTTPEOL
+    "Content-Length: 0" HTTPEOL
+    HTTPEOL;
+/** @var This is sent to clients that are over their rate limit */
+static const uint8_t _attoHTTPReject429[] =
+    HTTP_VERSION " 429 Too Many Requests" HTTPEOL
+    "Retry-After: " _attoHTTPSTR(ATTOHTTP_RATE_RETRY_AFTER) HTTPEOL
+    "Content-Length: 0" HTTPEOL
+    HTTPEOL;
+/** @var This is sent to clients when there is too much going on to serve them */
+static const uint8_t _attoHTTPReject503[] =
+    HTTP_VERSION " 503 Service Unavailable" HTTPEOL
+    "Retry-After: " _attoHTTPSTR(ATTOHTTP_SHED_RETRY_AFTER) HTTPEOL
+    "Content-Length: 0" HTTPEOL
+    HTTPEOL;
+
 /** @var This is a map of our mime types */
 static const uint8_t *_mimetypes[] = {
     [APPLICATION_JSON] = (uint8_t *)"application/json",
@@ -158,7 +655,24 @@ static const uint8_t *_mimetypes[] = {
     [APPLICATION_JAVASCRIPT] = (uint8_t *)"application/javascript",
     [APPLICATION_XWWWFORMURLENCODED] = (uint8_t *)"application/x-www-form-urlencoded",
     [IMAGE_PNG] = (uint8_t *)"image/png",
-    [TEXT_EVENTSTREAM] = (uint8_t *)"text/event-stream"
+    [TEXT_EVENTSTREAM] = (uint8_t *)"text/event-stream",
+    [MULTIPART_FORMDATA] = (uint8_t *)"multipart/form-data"
+};
+
+/** The bit that says an entry in _attoHTTPHexTable is a hex digit */
+#define ATTOHTTP_HEX_VALID 0x10
+/**
+ * @var This is a map of hex digits to their value
+ *
+ * Hex digits are stored as their value with ATTOHTTP_HEX_VALID set.  Everything
+ * else is 0.  Because the flag is above the low nibble, ((hi << 4) | (lo & 0x0F))
+ * in a uint8_t gives the decoded byte straight out of two entries.
+ */
+static const uint8_t _attoHTTPHexTable[256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+    ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F,
 };
 
 
@@ -184,6 +698,18 @@ _attoHTTPInitRun(void)
 #else 
     _attoHTTPAuthenticated = 1;
 #endif
+#ifdef ATTOHTTP_DIGEST_AUTH
+    _attoHTTP_digestStale = 0;
+    _attoHTTP_urlOverLen = 0;
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+    _attoHTTP_session = -1;
+    _attoHTTP_sessionNew = 0;
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+    _attoHTTP_authRequired = 1;
+#endif
+    _attoHTTP_page = NULL;
     _attoHTTPMethod = METHOD_NOTSUPPORTED;
     _attoHTTPVersion = VUNKNOWN;
     _attoHTTP_url_len = 0;
@@ -193,10 +719,34 @@ _attoHTTPInitRun(void)
     _attoHTTP_returnCode = STATUS_RUNKNOWN;
     _attoHTTP_extra_c = -1;
     _attoHTTP_url_params = NULL;
-    _attoHTTP_url_params_start = ATTOHTTP_URL_BUFFER_SIZE;
+    _attoHTTP_url_param_count = 0;
+    _attoHTTP_url_param_next = 0;
+    _attoHTTP_url_indexed = 0;
+    _attoHTTP_param_error = 0;
     _attoHTTP_accept = TEXT_HTML;
     _attoHTTP_contenttype = TEXT_HTML;
     _attoHTTP_contentlength = 0;
+    _attoHTTP_bodylength = ATTOHTTP_LENGTH_UNKNOWN;
+    _attoHTTP_bodyread = 0;
+    _attoHTTP_expectContinue = 0;
+#ifdef ATTOHTTP_DEADLINE
+    _attoHTTP_started = attoHTTPGetMillis();
+    _attoHTTP_deadline = ATTOHTTP_DEADLINE_LINE;
+    _attoHTTP_timedOut = 0;
+#endif
+    _attoHTTP_boundary[0] = 0;
+    _attoHTTP_lastEventID = 0;
+    _attoHTTP_lastEventIDValid = 0;
+    _attoHTTP_sseStream = 0;
+#ifdef ATTOHTTP_WEBSOCKET
+    _attoHTTP_wsUpgrade = 0;
+    _attoHTTP_wsKey[0] = 0;
+    _attoHTTP_wsCallback = NULL;
+#endif
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    _attoHTTP_wsDeflate = 0;
+    _attoHTTP_wsDeflateFlags = 0;
+#endif
     _attoHTTPParseJSONParam_cblevel = 0;
     _attoHTTPParseJSONParam_sblevel = 0;
     _attoHTTPParseJSONParam_baselevel = 0;
@@ -204,9 +754,74 @@ _attoHTTPInitRun(void)
 
 }
 
+/**
+ * @brief Tells the client to send the body, if it is waiting to be told
+ *
+ * Clients that send "Expect: 100-continue" wait for this before they send
+ * the body.  It is only sent when the body is first read, so a handler can
+ * still turn the request down without the body ever being sent.
+ *
+ * @return none
+ */
+static void
+_attoHTTPSendContinue(void)
+{
+    _attoHTTP_expectContinue = 0;
+    if (_attoHTTP_firstlineSent == 0) {
+        attoHTTPprint(HTTP_VERSION_1_1 " 100 Continue" HTTPEOL HTTPEOL);
+    }
+}
+#ifdef ATTOHTTP_DEADLINE
+/**
+ * @brief Checks if the client has run out of time to send this part of the request
+ *
+ * Once this returns 1 it keeps returning 1 until the next request, so a
+ * client that got too slow doesn't get any more reads.
+ *
+ * @return 1 if the time is up, 0 otherwise
+ */
+static inline uint8_t
+_attoHTTPExpired(void)
+{
+    if (!_attoHTTP_timedOut && ((uint32_t)(attoHTTPGetMillis() - _attoHTTP_started) >= _attoHTTP_deadline)) {
+        _attoHTTP_timedOut = 1;
+    }
+    return _attoHTTP_timedOut;
+}
+/**
+ * @brief Works out when the body has to be in by
+ *
+ * The body gets ATTOHTTP_DEADLINE_LINE ms, plus what it takes to send it at
+ * ATTOHTTP_DEADLINE_BODY_RATE bytes a second, but the whole request still has
+ * to be in by ATTOHTTP_DEADLINE_REQUEST.  A body with no Content-Length gets
+ * up to ATTOHTTP_DEADLINE_REQUEST.
+ *
+ * @return The deadline in ms after _attoHTTP_started
+ */
+static inline uint32_t
+_attoHTTPBodyDeadline(void)
+{
+    uint32_t now = attoHTTPGetMillis() - _attoHTTP_started;
+    uint32_t secs = _attoHTTP_bodylength / ATTOHTTP_DEADLINE_BODY_RATE;
+    uint32_t allow;
+    if ((_attoHTTP_bodylength == ATTOHTTP_LENGTH_UNKNOWN) || (secs >= (ATTOHTTP_DEADLINE_REQUEST / 1000))) {
+        return ATTOHTTP_DEADLINE_REQUEST;
+    }
+    allow = ATTOHTTP_DEADLINE_LINE + (secs * 1000)
+        + (((_attoHTTP_bodylength % ATTOHTTP_DEADLINE_BODY_RATE) * 1000) / ATTOHTTP_DEADLINE_BODY_RATE);
+    if ((now >= ATTOHTTP_DEADLINE_REQUEST) || (allow >= (ATTOHTTP_DEADLINE_REQUEST - now))) {
+        return ATTOHTTP_DEADLINE_REQUEST;
+    }
+    return now + allow;
+}
+#endif
 /**
  * @brief Reads a character in
  *
+ * Once the headers are done, this will not read past the Content-Length
+ * that the client sent.  If ATTOHTTP_DEADLINE is set, nothing more is read
+ * once the client has taken too long.
+ *
  * @param c A pointer to the location to store the read character into
  *
  * @return 1 if a character was read, 0 if not
@@ -223,8 +838,20 @@ _attoHTTPReadC(uint8_t *c)
         *c = 0;
         ret = 0;
         */
+    } else if (_attoHTTPBodyDone()) {
+        ret = 0;
+#ifdef ATTOHTTP_DEADLINE
+    } else if (_attoHTTPExpired()) {
+        ret = 0;
+#endif
     } else {
+        if (_attoHTTP_expectContinue && _attoHTTP_headersDone) {
+            _attoHTTPSendContinue();
+        }
         ret = attoHTTPGetByte(_attoHTTP_read, c);
+        if ((ret > 0) && _attoHTTP_headersDone) {
+            _attoHTTP_bodyread++;
+        }
     }
     return ret;
 }
@@ -277,9 +904,11 @@ _attoHTTPParseEOL(void)
             eolCount++;
         }
     } while ((isspace(c) || (eolCount == 0)) && (ret > 0) && (eolCount < 2));
-    _attoHTTPPushC(c);
     if (eolCount > 1) {
+        // The blank line is used up, so the body starts with the next read
         _attoHTTP_headersDone = 1;
+    } else {
+        _attoHTTPPushC(c);
     }
     return ret;
 }
@@ -341,6 +970,9 @@ _attoHTTPParseURL(void)
 {
     int8_t ret;
     uint8_t c;
+#ifdef ATTOHTTP_DIGEST_AUTH
+    MD5_CTX over;
+#endif
     // Remove any extra space
     ret = _attoHTTPParseSpace();
 
@@ -354,7 +986,6 @@ _attoHTTPParseURL(void)
                 if (_attoHTTP_url[_attoHTTP_url_len] == '?') {
                     _attoHTTP_url[_attoHTTP_url_len] = 0;
                     _attoHTTP_url_params = &_attoHTTP_url[_attoHTTP_url_len + 1];
-                    _attoHTTP_url_params_start = _attoHTTP_url_len + 1;
                 }
                 _attoHTTP_url_len++;
             }
@@ -364,7 +995,22 @@ _attoHTTPParseURL(void)
         c = _attoHTTP_url[_attoHTTP_url_len];
         while (ret && !isblank(c)) {
             ret = _attoHTTPReadC(&c);
+#ifdef ATTOHTTP_DIGEST_AUTH
+            // Digest checks the whole target, so keep track of what is dropped
+            if ((ret > 0) && !isblank(c)) {
+                if (_attoHTTP_urlOverLen == 0) {
+                    MD5_Init(&over);
+                }
+                MD5_Update(&over, &c, 1);
+                _attoHTTP_urlOverLen++;
+            }
+#endif
+        }
+#ifdef ATTOHTTP_DIGEST_AUTH
+        if (_attoHTTP_urlOverLen > 0) {
+            MD5_Final(_attoHTTP_urlOverMD5, &over);
         }
+#endif
         _attoHTTPPushC(c);
         _attoHTTP_url[_attoHTTP_url_len] = 0;
 #ifdef __DEBUG__
@@ -413,317 +1059,2839 @@ _attoHTTPParseVersion()
 
     return ret;
 }
+#if defined(ATTOHTTP_DIGEST_AUTH) || defined(ATTOHTTP_AUTH_SESSION)
 /**
- * @brief Checks the Auth, based on what is given in the Authorization header
+ * @brief Writes bytes out as lower case hex
  *
- * @param auth The authentication type
- * @param cred The credential string, NULL terminated
- * 
- * @return 1 if the auth succeeded, 0 otherwise
+ * @param in  The bytes
+ * @param len The number of bytes
+ * @param out Where to put the hex.  This must have room for 2 * len + 1.
+ *
+ * @return None
  */
-static inline int8_t
-_attoHTTPCheckAuth(authtype_t auth, int8_t *cred)
+static void
+_attoHTTPHex(const uint8_t *in, uint8_t len, char *out)
 {
-    int8_t ret = 0;
-    switch (auth) {
-#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
-        case BASIC_AUTH:
-        case DIGEST_AUTH:
-            ret = attoHTTPWrapperCheckAuth((uint8_t)auth, cred);
-            break;
+    static const char hex[] = "0123456789abcdef";
+    while (len-- > 0) {
+        *out++ = hex[*in >> 4];
+        *out++ = hex[*in & 0x0F];
+        in++;
+    }
+    *out = 0;
+}
 #endif
-        default:
-            _attoHTTP_returnCode = STATUS_UNSUPPORTED;
-            break;
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * @brief Compares two buffers without stopping at the first difference
+ *
+ * This keeps the time it takes from saying how much of a secret was right.
+ *
+ * @param a   The first buffer
+ * @param b   The second buffer
+ * @param len The number of bytes to compare
+ *
+ * @return 1 if they are the same, 0 otherwise
+ */
+static uint8_t
+_attoHTTPSame(const void *a, const void *b, uint8_t len)
+{
+    const uint8_t *x = a;
+    const uint8_t *y = b;
+    uint8_t diff = 0;
+    while (len-- > 0) {
+        diff |= *x++ ^ *y++;
     }
-    if ((ret == 0) && (_attoHTTP_returnCode == STATUS_RUNKNOWN)) {
-        _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
+    return diff == 0;
+}
+/**
+ * @brief Hashes a user name for the credential store
+ *
+ * This is 32 bit FNV-1a.
+ *
+ * @param user The user name
+ *
+ * @return The hash
+ */
+static uint32_t
+_attoHTTPAuthHash(const char *user)
+{
+    uint32_t hash = 2166136261UL;
+    while (*user != 0) {
+        hash = (hash ^ (uint8_t)*user++) * 16777619UL;
     }
-    return ret;
+    return hash;
 }
 /**
- * @brief Parses the next header
+ * @brief Finds a user in the credential store
  *
- * @param name      The buffer to store the name in
- * @param namesize  The size of the name buffer
- * @param value     The buffer to store the value in
- * @param valuesize The size of the value buffer
+ * The hash of the name picks the slot, and the slots after it are tried
+ * until the name or an empty slot turns up.  Because the store is never more
+ * than 3/4 full that is only a slot or two, however many users there are.
  *
- * @return 1 if there is more to read, 0 if done reading
+ * @param user The user name
+ * @param hash The hash of the user name
+ *
+ * @return The user, or NULL if there isn't one by that name
  */
-static inline int8_t
-_attoHTTPParseHeader(uint8_t *name, uint16_t namesize, uint8_t *value, uint16_t valuesize)
+static attoHTTPAuthUser_t *
+_attoHTTPAuthFind(const char *user, uint32_t hash)
 {
-    int8_t ret;
-    namesize--; // Account for the termination character
-    do {
-        ret = _attoHTTPReadC(name);
-        if (*name == ':') {
+    attoHTTPAuthUser_t *u;
+    uint16_t slot = hash & (ATTOHTTP_AUTH_USERS - 1);
+    uint16_t i;
+    for (i = 0; i < ATTOHTTP_AUTH_USERS; i++) {
+        u = &_attoHTTPAuthUsers[slot];
+        if (u->user[0] == 0) {
             break;
-        } else {
-            name++;
-            namesize--;
         }
-    } while ((ret > 0) && (namesize > 0));
-    *name = 0; // Terminate the string
-
-    ret = _attoHTTPParseSpace();
-
-    valuesize--; // Account for the termination character
-    do {
-        ret = _attoHTTPReadC(value);
-        if ((*value == '\r') || (*value == '\n')) {
-            break;
-        } else {
-            value++;
-            valuesize--;
+        if ((u->hash == hash) && (strncmp(u->user, user, sizeof(u->user)) == 0)) {
+            return u;
         }
-    } while ((ret > 0) && (valuesize > 0));
-    if (valuesize > 0) {
-        _attoHTTPPushC(*value);
+        slot = (slot + 1) & (ATTOHTTP_AUTH_USERS - 1);
     }
-    *value = 0;  // Terminate the string
-    ret = _attoHTTPParseEOL();
-    return ret;
+    return NULL;
 }
+#endif
+#ifdef ATTOHTTP_BASIC_AUTH
 /**
- * @brief Parses headers and saves inforamtion it needs out of them.
+ * @brief Checks Basic credentials against the credential store
  *
- * @return 1 if there is more to read, 0 if done reading
+ * The credentials are "user:password" in base64.  HA1 is worked out from them
+ * and compared to the one in the store.  If there is no such user it is
+ * compared anyway, so the time this takes doesn't say which users exist.
+ *
+ * @param cred The base64 credentials from the header
+ *
+ * @return 1 if the credentials are good, 0 otherwise
  */
-static inline int8_t
-_attoHTTPParseHeaders(void)
+static uint8_t
+_attoHTTPBasicCheck(int8_t *cred)
 {
-    int8_t ret = 1;
-    uint8_t i;
-    uint8_t name[ATTOHTTP_HEADER_NAME_SIZE];
-    uint8_t value[ATTOHTTP_HEADER_VALUE_SIZE];
-
-    while ((_attoHTTP_headersDone == 0) && (ret > 0)) {
-        ret = _attoHTTPParseHeader(name, sizeof(name), value, sizeof(value));
-        if (strncasecmp((char *)name, "accept", sizeof(name)) == 0) {
-            for (i = 0; i < ATTOHTTP_MIME_TYPES; i++) {
-                if (strncasecmp((char *)value, (char *)_mimetypes[i], sizeof(value)) == 0) {
-                    _attoHTTP_accept = (1<<i);
-                }
-            }
-        } else if (strncasecmp((char *)name, "content-type", sizeof(name)) == 0) {
-            for (i = 0; i < ATTOHTTP_MIME_TYPES; i++) {
-                if (strstr((char *)value, (char *)_mimetypes[i]) != NULL) {
-                    _attoHTTP_contenttype = i;
-                    break;
-                }
-            }
-        } else if (strncasecmp((char *)name, "authorization", sizeof(name)) == 0) {
-#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
-            int8_t *ptr;
-            for (i = 0; i < ATTOHTTP_AUTH_TYPES; i++) {
-                ptr = (int8_t *)strstr((char *)value, (char *)_authtypes[i]);
-                if (ptr != NULL) {
-                    ptr += strlen((char *)_authtypes[i]) + 1;
-                    _attoHTTPAuthenticated = _attoHTTPCheckAuth(i, ptr);
-                    break;
-                }
-            }
-            // This means we didn't find anything
-            if (i >= ATTOHTTP_AUTH_TYPES) {
-                _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
-            }
+    static const uint8_t nobody[16];
+    uint8_t plain[((ATTOHTTP_HEADER_VALUE_SIZE / 4) * 3) + 1];
+    uint8_t ha1[16];
+    attoHTTPAuthUser_t *u;
+    char *pass;
+    uint16_t len;
+    uint8_t good;
+    len = attoHTTPBase64Decode(cred, strlen((char *)cred), (int8_t *)plain, sizeof(plain));
+    pass = memchr(plain, ':', len);
+    if (pass == NULL) {
+        return 0;
+    }
+    *pass++ = 0;
+    attoHTTPAuthHA1((char *)plain, pass, ha1);
+    u = _attoHTTPAuthFind((char *)plain, _attoHTTPAuthHash((char *)plain));
+    good = _attoHTTPSame(ha1, (u == NULL) ? nobody : u->ha1, sizeof(ha1));
+    memset(plain, 0, sizeof(plain));
+    return good && (u != NULL);
+}
 #endif
-        }
+#ifdef ATTOHTTP_DIGEST_AUTH
+/**
+ * @brief The HMAC-MD5 of a message, with the nonce key
+ *
+ * The pads were hashed when the key was set, so this is only two MD5 blocks
+ * for a nonce.  If attoHTTPDigestSecret() was never called, a key is made
+ * with attoHTTPGetRandom() the first time, since a key everybody knows would
+ * let anybody make nonces.
+ *
+ * @param msg The message
+ * @param len The length of the message
+ * @param mac Where to put the 16 byte MAC
+ *
+ * @return None
+ */
+static void
+_attoHTTPDigestMAC(const uint8_t *msg, uint8_t len, uint8_t *mac)
+{
+    MD5_HMAC_CTX ctx;
+    uint8_t key[32];
+    if (!_attoHTTPDigestKeyed) {
+        attoHTTPGetRandom(key, sizeof(key));
+        attoHTTPDigestSecret(key, sizeof(key));
+        memset(key, 0, sizeof(key));
     }
-    return ret;
+    MD5_HMAC_Init(&ctx, &_attoHTTPDigestKey);
+    MD5_HMAC_Update(&ctx, msg, len);
+    MD5_HMAC_Final(mac, &ctx);
 }
-
-
 /**
- * @brief Finds API callback
+ * @brief Makes a new nonce
  *
- * This function parses the URL into component parts, and feeds that to the
- * callback function.  This allows it to figure out what it should do, based
- * on the URL.
+ * The nonce is the time it was made, a count of the nonces made, and the MAC
+ * of both.  It can be checked without keeping it anywhere, and the count makes
+ * every one different, even if two are made in the same second.
  *
- * @return 1 if a function was called, 0 otherwise
+ * @param nonce Where to put the nonce.  This must have room for
+ *              _attoHTTPDIGEST_NONCE_SIZE + 1 characters.
+ *
+ * @return None
  */
-static inline int8_t
-_attoHTTPFindAPICallback(void)
+static void
+_attoHTTPDigestNonce(char *nonce)
 {
-    int8_t ret = 0;
-    uint8_t *command[ATTOHTTP_API_LEVELS];
-    uint8_t *id[ATTOHTTP_API_LEVELS];
+    uint8_t data[8];
+    uint8_t mac[16];
+    uint32_t now = ATTOHTTP_DIGEST_TIME();
+    uint32_t id = ++_attoHTTPDigestNonceID;
     uint8_t i;
-    uint8_t *url_ptr = _attoHTTP_url;
-    uint16_t ctr = _attoHTTP_url_len;
-    uint8_t cmdlvl = 0;
-    uint8_t idlvl = 0;
-    // Find the Callback
-    if (_attoHTTPDefaultCallback != NULL) {
-        ret = 1;
-        // Init the buffers
-        for (i = 0; i < ATTOHTTP_API_LEVELS; i++) {
-            command[i] = NULL;
-            id[i] = NULL;
+    for (i = 0; i < 4; i++) {
+        data[i] = (now >> (24 - (8 * i))) & 0xFF;
+        data[i + 4] = (id >> (24 - (8 * i))) & 0xFF;
+    }
+    _attoHTTPDigestMAC(data, sizeof(data), mac);
+    _attoHTTPHex(data, sizeof(data), nonce);
+    _attoHTTPHex(mac, sizeof(mac), &nonce[2 * sizeof(data)]);
+}
+/**
+ * @brief Checks that a nonce is one of ours, and isn't too old
+ *
+ * If the MAC is right but the nonce is too old, _attoHTTP_digestStale is set
+ * so the client knows to just try again with the new nonce.
+ *
+ * @param nonce The nonce from the client
+ * @param id    Where to put the count that is in the nonce
+ *
+ * @return 1 if the nonce is good, 0 otherwise
+ */
+static uint8_t
+_attoHTTPDigestCheckNonce(const char *nonce, uint32_t *id)
+{
+    uint8_t data[8];
+    uint8_t mac[16];
+    char hex[(2 * sizeof(mac)) + 1];
+    uint32_t made = 0;
+    uint8_t hi, lo, i;
+    if (strlen(nonce) != _attoHTTPDIGEST_NONCE_SIZE) {
+        return 0;
+    }
+    *id = 0;
+    for (i = 0; i < sizeof(data); i++) {
+        hi = _attoHTTPHexTable[(uint8_t)nonce[2 * i]];
+        lo = _attoHTTPHexTable[(uint8_t)nonce[(2 * i) + 1]];
+        if ((hi & lo & ATTOHTTP_HEX_VALID) == 0) {
+            return 0;
         }
-        // Parse the URL
-        while ((*url_ptr != 0) && (ctr > 0)) {
-            if (*url_ptr == '/') {
-                if ((cmdlvl == idlvl) && (cmdlvl < ATTOHTTP_API_LEVELS)) {
-                    // Don't get a level if there is nothing after the slash.
-                    if (ctr > 1) {
-                        command[cmdlvl] = url_ptr + 1;
-                        cmdlvl++;
+        data[i] = ((hi & 0x0F) << 4) | (lo & 0x0F);
+        if (i < 4) {
+            made = (made << 8) | data[i];
+        } else {
+            *id = (*id << 8) | data[i];
+        }
+    }
+    _attoHTTPDigestMAC(data, sizeof(data), mac);
+    _attoHTTPHex(mac, sizeof(mac), hex);
+    if (!_attoHTTPSame(hex, &nonce[2 * sizeof(data)], 2 * sizeof(mac))) {
+        return 0;
+    }
+    if ((uint32_t)(ATTOHTTP_DIGEST_TIME() - made) > ATTOHTTP_DIGEST_NONCE_LIFETIME) {
+        _attoHTTP_digestStale = 1;
+        return 0;
+    }
+    return 1;
+}
+/**
+ * @brief Checks that a nonce count hasn't been used before with this nonce
+ *
+ * The last count for each nonce is kept in a small table.  When it is full,
+ * the nonce that was used the longest time ago is dropped, and the newest
+ * nonce that has been dropped is remembered.  A nonce that isn't in the table
+ * and isn't newer than that might have been dropped, so it is treated as
+ * stale, and the client gets a new one.
+ *
+ * @param id The count from the nonce
+ * @param nc The nonce count from the client
+ *
+ * @return 1 if this nonce count is new, 0 otherwise
+ */
+static uint8_t
+_attoHTTPDigestCheckNC(uint32_t id, uint32_t nc)
+{
+    attoHTTPDigestNonce_t *n = NULL;
+    attoHTTPDigestNonce_t *oldest = &_attoHTTPDigestNonces[0];
+    uint8_t i;
+    _attoHTTPDigestUses++;
+    for (i = 0; i < ATTOHTTP_DIGEST_NONCES; i++) {
+        if (_attoHTTPDigestNonces[i].id == id) {
+            n = &_attoHTTPDigestNonces[i];
+            break;
+        }
+        if (_attoHTTPDigestNonces[i].used < oldest->used) {
+            oldest = &_attoHTTPDigestNonces[i];
+        }
+    }
+    if (n == NULL) {
+        if (id <= _attoHTTPDigestEvicted) {
+            _attoHTTP_digestStale = 1;
+            return 0;
+        }
+        if ((oldest->id != 0) && (oldest->id > _attoHTTPDigestEvicted)) {
+            _attoHTTPDigestEvicted = oldest->id;
+        }
+        n = oldest;
+        n->id = id;
+        n->nc = 0;
+    }
+    if (nc <= n->nc) {
+        // This is a replay
+        return 0;
+    }
+    n->nc = nc;
+    n->used = _attoHTTPDigestUses;
+    return 1;
+}
+/**
+ * @brief Gets the method of this request as a string
+ *
+ * @return The method
+ */
+static const char *
+_attoHTTPMethodName(void)
+{
+    switch (_attoHTTPMethod) {
+        case METHOD_GET:
+            return HTTP_METHOD_GET;
+        case METHOD_POST:
+            return HTTP_METHOD_POST;
+        case METHOD_PUT:
+            return HTTP_METHOD_PUT;
+        case METHOD_PATCH:
+            return HTTP_METHOD_PATCH;
+        case METHOD_DELETE:
+            return HTTP_METHOD_DELETE;
+        default:
+            return "";
+    }
+}
+/**
+ * @brief Takes one byte of a Digest Authorization parameter value
+ *
+ * Short values are saved.  The realm, qop and algorithm are compared with
+ * what we sent as they come in.  The uri is hashed and compared with the
+ * request URL as it comes in.  Anything that doesn't fit or doesn't match
+ * gets the parameter marked bad.
+ *
+ * @param f     The fields we are filling in
+ * @param param The parameter this byte is in
+ * @param pos   Where the byte is in the value
+ * @param c     The byte
+ *
+ * @return None
+ */
+static void
+_attoHTTPDigestByte(attoHTTPDigestFields_t *f, uint8_t param, uint16_t pos, uint8_t c)
+{
+    char *buf = NULL;
+    uint16_t size = 0;
+    const char *expect = NULL;
+    switch (param) {
+        case _attoHTTPDIGEST_USER:
+            buf = f->user;
+            size = sizeof(f->user);
+            break;
+        case _attoHTTPDIGEST_NONCE:
+            buf = f->nonce;
+            size = sizeof(f->nonce);
+            break;
+        case _attoHTTPDIGEST_NC:
+            buf = f->nc;
+            size = sizeof(f->nc);
+            break;
+        case _attoHTTPDIGEST_CNONCE:
+            buf = f->cnonce;
+            size = sizeof(f->cnonce);
+            break;
+        case _attoHTTPDIGEST_RESPONSE:
+            buf = f->response;
+            size = sizeof(f->response);
+            c = tolower(c);
+            break;
+        case _attoHTTPDIGEST_REALM:
+            expect = ATTOHTTP_AUTH_REALM;
+            break;
+        case _attoHTTPDIGEST_QOP:
+            expect = "auth";
+            break;
+        case _attoHTTPDIGEST_ALGORITHM:
+            expect = "MD5";
+            c = toupper(c);
+            break;
+        case _attoHTTPDIGEST_URI:
+            if (f->urifill >= sizeof(f->uri)) {
+                MD5_Update(&f->ha2, f->uri, f->urifill);
+                f->urifill = 0;
+            }
+            f->uri[f->urifill++] = c;
+            // It has to be the whole request target, query and all.  The
+            // '?' was turned into a 0 when the URL was read in.
+            if (pos >= _attoHTTP_url_len) {
+                if (pos == _attoHTTP_url_len) {
+                    MD5_Init(&f->over);
+                }
+                MD5_Update(&f->over, &c, 1);
+            } else if (c != ((_attoHTTP_url[pos] == 0) ? '?' : _attoHTTP_url[pos])) {
+                f->bad |= (1 << param);
+            }
+            return;
+        default:
+            return;
+    }
+    if (buf != NULL) {
+        if (pos < (size - 1)) {
+            buf[pos] = c;
+        } else {
+            f->bad |= (1 << param);
+        }
+    } else if ((pos >= strlen(expect)) || (expect[pos] != c)) {
+        f->bad |= (1 << param);
+    }
+}
+/**
+ * @brief Finishes a Digest Authorization parameter value
+ *
+ * @param f     The fields we are filling in
+ * @param param The parameter that ended
+ * @param len   The length of the value
+ *
+ * @return None
+ */
+static void
+_attoHTTPDigestEnd(attoHTTPDigestFields_t *f, uint8_t param, uint16_t len)
+{
+    uint8_t digest[16];
+    switch (param) {
+        case _attoHTTPDIGEST_REALM:
+            if (len != strlen(ATTOHTTP_AUTH_REALM)) {
+                f->bad |= (1 << param);
+            }
+            break;
+        case _attoHTTPDIGEST_QOP:
+            if (len != 4) {
+                f->bad |= (1 << param);
+            }
+            break;
+        case _attoHTTPDIGEST_ALGORITHM:
+            if (len != 3) {
+                f->bad |= (1 << param);
+            }
+            break;
+        case _attoHTTPDIGEST_URI:
+            MD5_Update(&f->ha2, f->uri, f->urifill);
+            f->urifill = 0;
+            if (len != (_attoHTTP_url_len + _attoHTTP_urlOverLen)) {
+                f->bad |= (1 << param);
+            } else if (_attoHTTP_urlOverLen > 0) {
+                MD5_Final(digest, &f->over);
+                if (memcmp(digest, _attoHTTP_urlOverMD5, sizeof(digest)) != 0) {
+                    f->bad |= (1 << param);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+/**
+ * @brief Checks the credentials from a Digest Authorization header
+ *
+ * This is RFC 7616 with MD5 and qop=auth.  HA1 is kept for each user, and HA2
+ * was hashed while the header was read, so this only has to hash the response.
+ * The nonce count is only looked at after the response checks out, so someone
+ * that doesn't have the password can't fill up the nonce table.
+ *
+ * @param f The fields from the header
+ *
+ * @return 1 if the credentials are good, 0 otherwise
+ */
+static int8_t
+_attoHTTPDigestCheck(attoHTTPDigestFields_t *f)
+{
+    char hex[33];
+    char ha2[33];
+    const char *parts[5];
+    char *end;
+    uint8_t digest[16];
+    static const uint8_t nobody[16];
+    attoHTTPAuthUser_t *u;
+    MD5_CTX ctx;
+    uint32_t id, count;
+    uint8_t i;
+    if (((f->seen & _attoHTTPDIGEST_NEEDED) != _attoHTTPDIGEST_NEEDED) || (f->bad != 0)
+        || (strlen(f->response) != 32) || (strlen(f->nc) != 8)) {
+        return 0;
+    }
+    count = strtoul(f->nc, &end, 16);
+    if (*end != 0) {
+        return 0;
+    }
+    if (!_attoHTTPDigestCheckNonce(f->nonce, &id)) {
+        return 0;
+    }
+    // A user that isn't there is checked anyway, so the time doesn't give it away
+    u = _attoHTTPAuthFind(f->user, _attoHTTPAuthHash(f->user));
+    MD5_Final(digest, &f->ha2);
+    _attoHTTPHex(digest, sizeof(digest), ha2);
+    // The response is MD5(HA1:nonce:nc:cnonce:qop:HA2)
+    _attoHTTPHex((u == NULL) ? nobody : u->ha1, 16, hex);
+    parts[0] = f->nonce;
+    parts[1] = f->nc;
+    parts[2] = f->cnonce;
+    parts[3] = "auth";
+    parts[4] = ha2;
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, hex, 32);
+    for (i = 0; i < (sizeof(parts) / sizeof(parts[0])); i++) {
+        MD5_Update(&ctx, ":", 1);
+        MD5_Update(&ctx, parts[i], strlen(parts[i]));
+    }
+    MD5_Final(digest, &ctx);
+    _attoHTTPHex(digest, sizeof(digest), hex);
+    if (!_attoHTTPSame(hex, f->response, 32) || (u == NULL)) {
+        return 0;
+    }
+    return _attoHTTPDigestCheckNC(id, count);
+}
+/**
+ * @brief Reads a Digest Authorization header and checks it
+ *
+ * The header is read straight from the client, one parameter at a time, so
+ * it doesn't have to fit in ATTOHTTP_HEADER_VALUE_SIZE.  Quoted values can
+ * have backslash escapes.  This sets _attoHTTPAuthenticated.
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseDigest(void)
+{
+    attoHTTPDigestFields_t f;
+    char name[12];
+    const char *method = _attoHTTPMethodName();
+    uint8_t c = 0;
+    uint8_t param, quoted, len, i;
+    uint16_t pos;
+    int8_t ret;
+    memset(&f, 0, sizeof(f));
+    // HA2 is MD5(method:uri)
+    MD5_Init(&f.ha2);
+    MD5_Update(&f.ha2, method, strlen(method));
+    MD5_Update(&f.ha2, ":", 1);
+    ret = _attoHTTPReadC(&c);
+    while ((ret > 0) && (c != '\r') && (c != '\n')) {
+        if ((c == ',') || isblank(c)) {
+            ret = _attoHTTPReadC(&c);
+            continue;
+        }
+        // The name
+        len = 0;
+        while ((ret > 0) && (c != '=') && (c != ',') && (c != '\r') && (c != '\n') && !isblank(c)) {
+            if (len < sizeof(name)) {
+                name[len++] = c;
+            }
+            ret = _attoHTTPReadC(&c);
+        }
+        while ((ret > 0) && isblank(c)) {
+            ret = _attoHTTPReadC(&c);
+        }
+        if ((ret <= 0) || (c != '=')) {
+            continue;
+        }
+        param = _attoHTTPDIGEST_PARAMS;
+        if (len < sizeof(name)) {
+            name[len] = 0;
+            for (i = 0; i < _attoHTTPDIGEST_PARAMS; i++) {
+                if (strcasecmp(name, _attoHTTPDigestParams[i]) == 0) {
+                    param = i;
+                    if ((f.seen & (1 << i)) != 0) {
+                        // It is only allowed once
+                        f.bad |= (1 << i);
                     }
-                } else if ((cmdlvl > idlvl) && (idlvl < ATTOHTTP_API_LEVELS)) {
-                    // Don't get a level if there is nothing after the slash.
-                    if (ctr > 1) {
-                        id[idlvl] = url_ptr + 1;
-                        idlvl++;
+                    f.seen |= (1 << i);
+                    break;
+                }
+            }
+        }
+        // The value
+        do {
+            ret = _attoHTTPReadC(&c);
+        } while ((ret > 0) && isblank(c));
+        quoted = (c == '"');
+        if (quoted) {
+            ret = _attoHTTPReadC(&c);
+        }
+        pos = 0;
+        while ((ret > 0) && (c != '\r') && (c != '\n')) {
+            if (quoted) {
+                if (c == '"') {
+                    ret = _attoHTTPReadC(&c);
+                    break;
+                } else if (c == '\\') {
+                    ret = _attoHTTPReadC(&c);
+                    if ((ret <= 0) || (c == '\r') || (c == '\n')) {
+                        break;
                     }
                 }
-                *url_ptr = 0;
+            } else if ((c == ',') || isblank(c)) {
+                break;
             }
-            url_ptr++;
-            ctr--;
+            _attoHTTPDigestByte(&f, param, pos, c);
+            if (pos < UINT16_MAX) {
+                pos++;
+            }
+            ret = _attoHTTPReadC(&c);
+        }
+        _attoHTTPDigestEnd(&f, param, pos);
+    }
+    if ((c == '\r') || (c == '\n')) {
+        _attoHTTPPushC(c);
+    }
+    _attoHTTPAuthenticated = _attoHTTPDigestCheck(&f);
+    if ((_attoHTTPAuthenticated == 0) && (_attoHTTP_returnCode == STATUS_RUNKNOWN)) {
+        _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
+    }
+    return ret;
+}
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+/**
+ * @brief Looks up a session cookie
+ *
+ * The slot comes from the cookie itself, so this is one look in the table
+ * no matter how many sessions there are.
+ *
+ * @param hex The cookie value, which is the token in hex
+ *
+ * @return 1 if the session is good, 0 otherwise
+ */
+static uint8_t
+_attoHTTPSessionFind(const char *hex)
+{
+    uint8_t token[_attoHTTPSESSION_SIZE];
+    attoHTTPSession_t *sess;
+    uint8_t hi, lo, i;
+    for (i = 0; i < sizeof(token); i++) {
+        hi = _attoHTTPHexTable[(uint8_t)hex[2 * i]];
+        lo = _attoHTTPHexTable[(uint8_t)hex[(2 * i) + 1]];
+        if ((hi & lo & ATTOHTTP_HEX_VALID) == 0) {
+            return 0;
+        }
+        token[i] = ((hi & 0x0F) << 4) | (lo & 0x0F);
+    }
+    i = token[0] & (ATTOHTTP_AUTH_SESSIONS - 1);
+    sess = &_attoHTTPSessions[i];
+    if (!sess->valid || !_attoHTTPSame(sess->token, token, sizeof(token))) {
+        return 0;
+    }
+    if ((uint32_t)(ATTOHTTP_AUTH_TIME() - sess->made) > ATTOHTTP_AUTH_SESSION_LIFETIME) {
+        sess->valid = 0;
+        return 0;
+    }
+    sess->used = ++_attoHTTPSessionUses;
+    _attoHTTP_session = i;
+    return 1;
+}
+/**
+ * @brief Starts a session for a request that just passed authentication
+ *
+ * An empty or expired slot is used if there is one.  Otherwise the session
+ * that was used the longest time ago is dropped.
+ *
+ * @return None
+ */
+static void
+_attoHTTPSessionNew(void)
+{
+    attoHTTPSession_t *sess;
+    uint32_t now = ATTOHTTP_AUTH_TIME();
+    uint8_t slot = 0;
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_AUTH_SESSIONS; i++) {
+        sess = &_attoHTTPSessions[i];
+        if (!sess->valid || ((uint32_t)(now - sess->made) > ATTOHTTP_AUTH_SESSION_LIFETIME)) {
+            slot = i;
+            break;
+        }
+        if (sess->used < _attoHTTPSessions[slot].used) {
+            slot = i;
+        }
+    }
+    sess = &_attoHTTPSessions[slot];
+    attoHTTPGetRandom(sess->token, sizeof(sess->token));
+    sess->token[0] = (sess->token[0] & ~(ATTOHTTP_AUTH_SESSIONS - 1)) | slot;
+    sess->made = now;
+    sess->used = ++_attoHTTPSessionUses;
+    sess->valid = 1;
+    _attoHTTP_session = slot;
+    _attoHTTP_sessionNew = 1;
+}
+/**
+ * @brief Reads the Cookie header, looking for our session cookie
+ *
+ * The header is read straight from the client, since there might be a lot
+ * of other cookies in front of ours.  If the session is good, the request is
+ * authenticated, and the Authorization header doesn't get checked.
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseCookie(void)
+{
+    char name[sizeof(ATTOHTTP_AUTH_SESSION_COOKIE)];
+    char value[(2 * _attoHTTPSESSION_SIZE) + 1];
+    uint8_t c = 0;
+    uint8_t len;
+    int8_t ret;
+    ret = _attoHTTPReadC(&c);
+    while ((ret > 0) && (c != '\r') && (c != '\n')) {
+        if ((c == ';') || isblank(c)) {
+            ret = _attoHTTPReadC(&c);
+            continue;
+        }
+        len = 0;
+        while ((ret > 0) && (c != '=') && (c != ';') && (c != '\r') && (c != '\n')) {
+            if (len < sizeof(name)) {
+                name[len++] = c;
+            }
+            ret = _attoHTTPReadC(&c);
+        }
+        if ((ret <= 0) || (c != '=')) {
+            continue;
+        }
+        ret = _attoHTTPReadC(&c);
+        if ((len == (sizeof(name) - 1)) && (strncmp(name, ATTOHTTP_AUTH_SESSION_COOKIE, len) == 0)) {
+            len = 0;
+            while ((ret > 0) && (c != ';') && (c != '\r') && (c != '\n') && !isblank(c)) {
+                if (len < sizeof(value)) {
+                    value[len++] = c;
+                }
+                ret = _attoHTTPReadC(&c);
+            }
+            if ((len == (sizeof(value) - 1)) && _attoHTTPSessionFind(value)) {
+                _attoHTTPAuthenticated = 1;
+                break;
+            }
+        } else {
+            while ((ret > 0) && (c != ';') && (c != '\r') && (c != '\n')) {
+                ret = _attoHTTPReadC(&c);
+            }
+        }
+    }
+    if ((c == '\r') || (c == '\n')) {
+        _attoHTTPPushC(c);
+    }
+    return ret;
+}
+/**
+ * @brief Sends the session cookie, if this request started a session
+ *
+ * @return The number of characters printed
+ */
+static uint16_t
+_attoHTTPSendSessionCookie(void)
+{
+    char hex[(2 * _attoHTTPSESSION_SIZE) + 1];
+    if (_attoHTTP_sessionNew == 0) {
+        return 0;
+    }
+    _attoHTTP_sessionNew = 0;
+    _attoHTTPHex(_attoHTTPSessions[_attoHTTP_session].token, _attoHTTPSESSION_SIZE, hex);
+    return attoHTTPprintf(
+        "Set-Cookie: " ATTOHTTP_AUTH_SESSION_COOKIE "=%s; Max-Age=%lu; Path=/; HttpOnly" HTTPEOL,
+        hex, (unsigned long)ATTOHTTP_AUTH_SESSION_LIFETIME
+    );
+}
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+/**
+ * @brief Finds the slot for a peer
+ *
+ * A peer can only be in the few slots after its hash, so this never looks
+ * at the whole table.  If the peer isn't there and add is set, it gets an
+ * empty slot, or else the least recently used slot that has no connections
+ * open.  The new peer starts with a full bucket.
+ *
+ * @param peer The peer address
+ * @param now  The time in ms
+ * @param add  Set to add the peer if it isn't found
+ *
+ * @return The slot, or NULL if there isn't one
+ */
+static attoHTTPPeer_t *
+_attoHTTPPeerFind(uint32_t peer, uint32_t now, uint8_t add)
+{
+    attoHTTPPeer_t *p;
+    attoHTTPPeer_t *slot = NULL;
+    uint8_t start = (uint8_t)((uint32_t)(peer * 2654435761UL) >> 24);
+    uint8_t i;
+    for (i = 0; i < _attoHTTPRATE_PROBE; i++) {
+        p = &_attoHTTPPeers[(start + i) & (ATTOHTTP_RATE_PEERS - 1)];
+        if (!p->valid) {
+            if ((slot == NULL) || slot->valid) {
+                slot = p;
+            }
+        } else if (p->peer == peer) {
+            return p;
+        } else if ((p->conns == 0) && ((slot == NULL) || (slot->valid && (p->used < slot->used)))) {
+            slot = p;
+        }
+    }
+    if (!add || (slot == NULL)) {
+        return NULL;
+    }
+    slot->peer = peer;
+    slot->stamp = now;
+    slot->tokens = _attoHTTPRATE_FULL;
+    slot->used = 0;
+    slot->conns = 0;
+    slot->valid = 1;
+    return slot;
+}
+#endif
+/**
+ * @brief Checks the Auth, based on what is given in the Authorization header
+ *
+ * @param auth The authentication type
+ * @param cred The credential string, NULL terminated
+ * 
+ * @return 1 if the auth succeeded, 0 otherwise
+ */
+static inline int8_t
+_attoHTTPCheckAuth(authtype_t auth, int8_t *cred)
+{
+    int8_t ret = 0;
+    switch (auth) {
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+        case BASIC_AUTH:
+        case DIGEST_AUTH:
+            ret = attoHTTPWrapperCheckAuth((uint8_t)auth, cred);
+            break;
+#endif
+        default:
+            _attoHTTP_returnCode = STATUS_UNSUPPORTED;
+            break;
+    }
+    if ((ret == 0) && (_attoHTTP_returnCode == STATUS_RUNKNOWN)) {
+        _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
+    }
+    return ret;
+}
+/**
+ * @brief Parses the name of the next header, and the space after it
+ *
+ * @param name      The buffer to store the name in
+ * @param namesize  The size of the name buffer
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseHeaderName(uint8_t *name, uint16_t namesize)
+{
+    int8_t ret;
+    namesize--; // Account for the termination character
+    do {
+        ret = _attoHTTPReadC(name);
+        if (*name == ':') {
+            break;
+        } else {
+            name++;
+            namesize--;
+        }
+    } while ((ret > 0) && (namesize > 0));
+    *name = 0; // Terminate the string
+
+    return _attoHTTPParseSpace();
+}
+/**
+ * @brief Parses the value of a header
+ *
+ * @param value     The buffer to store the value in
+ * @param valuesize The size of the value buffer
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseHeaderValue(uint8_t *value, uint16_t valuesize)
+{
+    int8_t ret;
+    valuesize--; // Account for the termination character
+    do {
+        ret = _attoHTTPReadC(value);
+        if ((*value == '\r') || (*value == '\n')) {
+            break;
+        } else {
+            value++;
+            valuesize--;
+        }
+    } while ((ret > 0) && (valuesize > 0));
+    if (valuesize > 0) {
+        _attoHTTPPushC(*value);
+    }
+    *value = 0;  // Terminate the string
+    return ret;
+}
+/**
+ * @brief Saves the multipart boundary from a Content-Type header value
+ *
+ * The boundary is usually near the end of the header, so it might not have
+ * fit in the value buffer.  If it didn't, the rest of it is read straight
+ * from the client.
+ *
+ * @param value     The header value that was read
+ * @param valuesize The size of the value buffer
+ *
+ * @return none
+ */
+static inline void
+_attoHTTPParseBoundary(uint8_t *value, uint16_t valuesize)
+{
+    uint8_t *ptr = (uint8_t *)strstr((char *)value, "boundary=");
+    uint16_t len = 0;
+    uint8_t c;
+    if (ptr == NULL) {
+        return;
+    }
+    ptr += 9;
+    if (*ptr == '"') {
+        ptr++;
+    }
+    while ((*ptr != 0) && (*ptr != '"') && (*ptr != ';') && !isspace(*ptr) && (len < (sizeof(_attoHTTP_boundary) - 1))) {
+        _attoHTTP_boundary[len++] = *ptr++;
+    }
+    if ((*ptr == 0) && ((ptr - value) == (valuesize - 1))) {
+        // The value was cut off, so get the rest of the boundary
+        while (_attoHTTPReadC(&c) > 0) {
+            if ((c == '"') || (c == ';') || isspace(c) || (len >= (sizeof(_attoHTTP_boundary) - 1))) {
+                _attoHTTPPushC(c);
+                break;
+            }
+            _attoHTTP_boundary[len++] = c;
+        }
+    }
+    _attoHTTP_boundary[len] = 0;
+}
+/**
+ * @brief Saves the Content-Length header value
+ *
+ * @param value The header value
+ *
+ * @return none
+ */
+static inline void
+_attoHTTPParseContentLength(uint8_t *value)
+{
+    uint32_t len = 0;
+    uint8_t *ptr = value;
+    while (isdigit(*ptr) && (len < (ATTOHTTP_LENGTH_UNKNOWN / 10))) {
+        len = (len * 10) + (*ptr++ - '0');
+    }
+    if ((ptr == value) || (*ptr != 0)) {
+        _attoHTTP_returnCode = STATUS_BADREQUEST;
+    } else {
+        _attoHTTP_bodylength = len;
+    }
+}
+/**
+ * @brief Saves the Last-Event-ID header value
+ *
+ * The ids that attoHTTPSSEPublish() hands out are numbers, so anything else
+ * is ignored.
+ *
+ * @param value The header value
+ *
+ * @return none
+ */
+static inline void
+_attoHTTPParseLastEventID(uint8_t *value)
+{
+    uint32_t id = 0;
+    uint8_t *ptr = value;
+    // Stop short of overflowing, which leaves a digit so the id is ignored
+    while (isdigit(*ptr) && (id <= ((0xFFFFFFFF - (*ptr - '0')) / 10))) {
+        id = (id * 10) + (*ptr++ - '0');
+    }
+    if ((ptr != value) && (*ptr == 0)) {
+        _attoHTTP_lastEventID = id;
+        _attoHTTP_lastEventIDValid = 1;
+    }
+}
+#ifdef ATTOHTTP_WEBSOCKET
+/**
+ * @brief Checks for a token in a comma separated header value
+ *
+ * The match is not case sensitive, since "Connection: keep-alive, Upgrade"
+ * is what browsers send.
+ *
+ * @param value The header value
+ * @param token The token to look for
+ *
+ * @return 1 if the token is there, 0 otherwise
+ */
+static uint8_t
+_attoHTTPHeaderToken(const uint8_t *value, const char *token)
+{
+    uint8_t len = strlen(token);
+    while (*value != 0) {
+        while ((*value == ' ') || (*value == ',')) {
+            value++;
+        }
+        if ((strncasecmp((char *)value, token, len) == 0)
+            && ((value[len] == 0) || (value[len] == ',') || (value[len] == ' '))) {
+            return 1;
+        }
+        while ((*value != 0) && (*value != ',')) {
+            value++;
+        }
+    }
+    return 0;
+}
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+/**
+ * @brief Takes the spaces and quotes off of both ends of a string
+ *
+ * @param str The string.  The end is cut off in place.
+ *
+ * @return Where the string starts now
+ */
+static char *
+_attoHTTPTrim(char *str)
+{
+    char *end;
+    while ((*str == ' ') || (*str == '"')) {
+        str++;
+    }
+    end = str + strlen(str);
+    while ((end > str) && ((end[-1] == ' ') || (end[-1] == '"'))) {
+        *--end = 0;
+    }
+    return str;
+}
+/**
+ * @brief Looks for a permessage-deflate offer that we can take
+ *
+ * The offers are tried in order, and the first one with only parameters
+ * from RFC 7692 that make sense is taken.  The window the server uses is
+ * never more than ATTOHTTP_WEBSOCKET_DEFLATE_BITS.  Whatever client window
+ * the client offers is fine, since the reply always has
+ * client_no_context_takeover in it, so nothing has to be kept from one
+ * message from the client to the next.
+ *
+ * The value gets cut up while this works on it.
+ *
+ * @param value The Sec-WebSocket-Extensions header value
+ *
+ * @return None
+ */
+static void
+_attoHTTPParseWebSocketExtensions(uint8_t *value)
+{
+    char *offer = (char *)value;
+    char *next, *param, *end, *arg;
+    uint8_t bits, flags, good, first;
+    long n;
+    while ((offer != NULL) && (*offer != 0) && (_attoHTTP_wsDeflate == 0)) {
+        next = strchr(offer, ',');
+        if (next != NULL) {
+            *next++ = 0;
+        }
+        bits = ATTOHTTP_WEBSOCKET_DEFLATE_BITS;
+        flags = 0;
+        good = 0;
+        first = 1;
+        for (param = offer; param != NULL; param = end, first = 0) {
+            end = strchr(param, ';');
+            if (end != NULL) {
+                *end++ = 0;
+            }
+            arg = strchr(param, '=');
+            if (arg != NULL) {
+                *arg++ = 0;
+                arg = _attoHTTPTrim(arg);
+            }
+            param = _attoHTTPTrim(param);
+            if (first) {
+                good = (strcasecmp(param, "permessage-deflate") == 0) && (arg == NULL);
+            } else if (strcasecmp(param, "server_no_context_takeover") == 0) {
+                flags |= _attoHTTPWS_NO_TAKEOVER;
+            } else if (strcasecmp(param, "server_max_window_bits") == 0) {
+                n = (arg == NULL) ? 0 : strtol(arg, NULL, 10);
+                if ((n < 8) || (n > 15)) {
+                    good = 0;
+                } else if (n < bits) {
+                    bits = n;
+                }
+                flags |= _attoHTTPWS_WINDOW_BITS;
+            } else if (strcasecmp(param, "client_max_window_bits") == 0) {
+                n = (arg == NULL) ? 15 : strtol(arg, NULL, 10);
+                if ((n < 8) || (n > 15)) {
+                    good = 0;
+                }
+            } else if (strcasecmp(param, "client_no_context_takeover") != 0) {
+                good = 0;
+            }
+            if (!good) {
+                break;
+            }
+        }
+        if (good) {
+            _attoHTTP_wsDeflate = bits;
+            _attoHTTP_wsDeflateFlags = flags;
+        }
+        offer = next;
+    }
+}
+#endif
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * @brief Parses the Authorization header and checks the credentials
+ *
+ * The scheme is read first.  Digest headers are read straight from the
+ * client when there are users to check them against, because they are
+ * usually a lot longer than ATTOHTTP_HEADER_VALUE_SIZE.  Everything else
+ * goes into the value buffer and to attoHTTPWrapperCheckAuth.
+ *
+ * @param value     The buffer to store the value in
+ * @param valuesize The size of the value buffer
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseAuthorization(uint8_t *value, uint16_t valuesize)
+{
+    int8_t ret;
+    int8_t *ptr;
+    uint16_t len = 0;
+    uint8_t c = 0;
+    uint8_t i;
+    do {
+        ret = _attoHTTPReadC(&c);
+        if ((ret <= 0) || isspace(c)) {
+            break;
+        }
+        if (len < (valuesize - 1)) {
+            value[len++] = c;
+        }
+    } while (1);
+    value[len] = 0;
+#ifdef ATTOHTTP_DIGEST_AUTH
+    if ((ret > 0) && isblank(c) && (_attoHTTPAuthUserCount != 0)
+        && (strcasecmp((char *)value, (char *)_authtypes[DIGEST_AUTH]) == 0)) {
+        return _attoHTTPParseDigest();
+    }
+#endif
+    if (ret > 0) {
+        _attoHTTPPushC(c);
+        if (len < (valuesize - 1)) {
+            ret = _attoHTTPParseHeaderValue(&value[len], valuesize - len);
+        }
+    }
+    for (i = 0; i < ATTOHTTP_AUTH_TYPES; i++) {
+        ptr = (int8_t *)strstr((char *)value, (char *)_authtypes[i]);
+        if (ptr != NULL) {
+            ptr += strlen((char *)_authtypes[i]) + 1;
+#ifdef ATTOHTTP_BASIC_AUTH
+            if ((i == BASIC_AUTH) && (_attoHTTPAuthUserCount != 0)) {
+                _attoHTTPAuthenticated = _attoHTTPBasicCheck(ptr);
+                break;
+            }
+#endif
+            _attoHTTPAuthenticated = _attoHTTPCheckAuth(i, ptr);
+            break;
+        }
+    }
+    // This means we didn't find anything
+    if (i >= ATTOHTTP_AUTH_TYPES) {
+        _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
+    }
+    return ret;
+}
+#endif
+/**
+ * @brief Parses headers and saves inforamtion it needs out of them.
+ *
+ * @return 1 if there is more to read, 0 if done reading
+ */
+static inline int8_t
+_attoHTTPParseHeaders(void)
+{
+    int8_t ret = 1;
+    uint8_t i;
+    uint8_t name[ATTOHTTP_HEADER_NAME_SIZE];
+    uint8_t value[ATTOHTTP_HEADER_VALUE_SIZE];
+
+    while ((_attoHTTP_headersDone == 0) && (ret > 0)) {
+        ret = _attoHTTPParseHeaderName(name, sizeof(name));
+        if ((strncasecmp((char *)name, "authorization", sizeof(name)) != 0)
+#ifdef ATTOHTTP_AUTH_SESSION
+            && (strncasecmp((char *)name, "cookie", sizeof(name)) != 0)
+#endif
+        ) {
+            ret = _attoHTTPParseHeaderValue(value, sizeof(value));
+        }
+        if (strncasecmp((char *)name, "accept", sizeof(name)) == 0) {
+            for (i = 0; i < ATTOHTTP_MIME_TYPES; i++) {
+                if (strncasecmp((char *)value, (char *)_mimetypes[i], sizeof(value)) == 0) {
+                    _attoHTTP_accept = (1<<i);
+                }
+            }
+        } else if (strncasecmp((char *)name, "content-type", sizeof(name)) == 0) {
+            if (strstr((char *)value, (char *)_mimetypes[MULTIPART_FORMDATA]) != NULL) {
+                _attoHTTP_contenttype = MULTIPART_FORMDATA;
+                _attoHTTPParseBoundary(value, sizeof(value));
+            } else {
+                for (i = 0; i < ATTOHTTP_MIME_TYPES; i++) {
+                    if (strstr((char *)value, (char *)_mimetypes[i]) != NULL) {
+                        _attoHTTP_contenttype = i;
+                        break;
+                    }
+                }
+            }
+        } else if (strncasecmp((char *)name, "content-length", sizeof(name)) == 0) {
+            _attoHTTPParseContentLength(value);
+        } else if (strncasecmp((char *)name, "last-event-id", sizeof(name)) == 0) {
+            _attoHTTPParseLastEventID(value);
+#ifdef ATTOHTTP_WEBSOCKET
+        } else if (strncasecmp((char *)name, "upgrade", sizeof(name)) == 0) {
+            if (_attoHTTPHeaderToken(value, "websocket")) {
+                _attoHTTP_wsUpgrade |= _attoHTTPWS_UPGRADE;
+            }
+        } else if (strncasecmp((char *)name, "connection", sizeof(name)) == 0) {
+            if (_attoHTTPHeaderToken(value, "upgrade")) {
+                _attoHTTP_wsUpgrade |= _attoHTTPWS_CONNECTION;
+            }
+        } else if (strncasecmp((char *)name, "sec-websocket-version", sizeof(name)) == 0) {
+            if (strncmp((char *)value, "13", sizeof(value)) == 0) {
+                _attoHTTP_wsUpgrade |= _attoHTTPWS_VERSION;
+            }
+        } else if (strncasecmp((char *)name, "sec-websocket-key", sizeof(name)) == 0) {
+            if (strlen((char *)value) == _attoHTTPWS_KEY_SIZE) {
+                memcpy(_attoHTTP_wsKey, value, _attoHTTPWS_KEY_SIZE + 1);
+                _attoHTTP_wsUpgrade |= _attoHTTPWS_KEY;
+            }
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+        } else if (strncasecmp((char *)name, "sec-websocket-extensions", sizeof(name)) == 0) {
+            _attoHTTPParseWebSocketExtensions(value);
+#endif
+#endif
+        } else if (strncasecmp((char *)name, "expect", sizeof(name)) == 0) {
+            if ((strncasecmp((char *)value, "100-continue", sizeof(value)) == 0) && (_attoHTTPVersion == V1_1)) {
+                _attoHTTP_expectContinue = 1;
+            }
+        } else if (strncasecmp((char *)name, "authorization", sizeof(name)) == 0) {
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+            // Public pages and good session cookies don't need this checked
+            if (!_attoHTTPAuthenticated) {
+                ret = _attoHTTPParseAuthorization(value, sizeof(value));
+            }
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+        } else if (strncasecmp((char *)name, "cookie", sizeof(name)) == 0) {
+            if (_attoHTTP_authRequired && (_attoHTTP_session < 0)) {
+                ret = _attoHTTPParseCookie();
+            }
+#endif
+        }
+        ret = _attoHTTPParseEOL();
+    }
+    return ret;
+}
+
+
+/**
+ * @brief Finds API callback
+ *
+ * This function parses the URL into component parts, and feeds that to the
+ * callback function.  This allows it to figure out what it should do, based
+ * on the URL.
+ *
+ * @return 1 if a function was called, 0 otherwise
+ */
+static inline int8_t
+_attoHTTPFindAPICallback(void)
+{
+    int8_t ret = 0;
+    uint8_t *command[ATTOHTTP_API_LEVELS];
+    uint8_t *id[ATTOHTTP_API_LEVELS];
+    uint8_t i;
+    uint8_t *url_ptr = _attoHTTP_url;
+    uint16_t ctr = _attoHTTP_url_len;
+    uint8_t cmdlvl = 0;
+    uint8_t idlvl = 0;
+    // Find the Callback
+    if (_attoHTTPDefaultCallback != NULL) {
+        ret = 1;
+        // Init the buffers
+        for (i = 0; i < ATTOHTTP_API_LEVELS; i++) {
+            command[i] = NULL;
+            id[i] = NULL;
+        }
+        // Parse the URL
+        while ((*url_ptr != 0) && (ctr > 0)) {
+            if (*url_ptr == '/') {
+                if ((cmdlvl == idlvl) && (cmdlvl < ATTOHTTP_API_LEVELS)) {
+                    // Don't get a level if there is nothing after the slash.
+                    if (ctr > 1) {
+                        command[cmdlvl] = url_ptr + 1;
+                        cmdlvl++;
+                    }
+                } else if ((cmdlvl > idlvl) && (idlvl < ATTOHTTP_API_LEVELS)) {
+                    // Don't get a level if there is nothing after the slash.
+                    if (ctr > 1) {
+                        id[idlvl] = url_ptr + 1;
+                        idlvl++;
+                    }
+                }
+                *url_ptr = 0;
+            }
+            url_ptr++;
+            ctr--;
+        }
+        if (cmdlvl > 0) {
+            _attoHTTP_returnCode = _attoHTTPDefaultCallback(_attoHTTPMethod, _attoHTTP_accept, command, id, cmdlvl, idlvl);
+        } else {
+            _attoHTTP_returnCode = STATUS_INTERNAL_ERROR;
+        }
+    }
+    return ret;
+}
+/**
+ * @brief This prints out the STATUS_OK message
+ *
+ * @return The number of characters printed
+ */
+uint16_t
+attoHTTPSendServerSentEventHeaders(void)
+{
+    uint16_t chars = 0;
+    attoHTTPFirstLine(STATUS_OK);
+    chars += attoHTTPprintf("Content-Type: %s" HTTPEOL, _mimetypes[TEXT_EVENTSTREAM]);
+    chars += attoHTTPprint("Cache-Control: no-cache" HTTPEOL);
+#ifdef ATTOHTTP_AUTH_SESSION
+    chars += _attoHTTPSendSessionCookie();
+#endif
+    chars += attoHTTPprint(HTTPEOL);
+    if (_attoHTTPSSERetry > 0) {
+        chars += attoHTTPprintf("retry:%" PRIu32 "\n\n", _attoHTTPSSERetry);
+    }
+    _attoHTTP_returnCode = STATUS_SERVERSENTEVENTS;
+    _attoHTTP_headersSent = 1;
+    return chars;
+}
+#ifdef ATTOHTTP_WEBSOCKET
+/**
+ * @brief This sends out the headers that finish a WebSocket upgrade
+ *
+ * Sec-WebSocket-Accept is the base64 of the SHA-1 of the key the client sent
+ * with the GUID from RFC 6455 stuck on the end.  If permessage-deflate was
+ * taken, the reply says what parameters we are using.
+ *
+ * @return The number of characters printed
+ */
+static uint16_t
+_attoHTTPSendWebSocketHeaders(void)
+{
+    static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    SHA1_CTX ctx;
+    uint8_t digest[SHA1_DIGEST_LENGTH];
+    char accept[((SHA1_DIGEST_LENGTH + 2) / 3 * 4) + 1];
+    uint16_t chars = 0;
+    SHA1_Init(&ctx);
+    SHA1_Update(&ctx, _attoHTTP_wsKey, _attoHTTPWS_KEY_SIZE);
+    SHA1_Update(&ctx, guid, sizeof(guid) - 1);
+    SHA1_Final(digest, &ctx);
+    attoHTTPBase64Encode((int8_t *)digest, sizeof(digest), (int8_t *)accept, sizeof(accept));
+    chars += attoHTTPFirstLine(STATUS_SWITCHING_PROTOCOLS);
+    chars += attoHTTPprint("Upgrade: websocket" HTTPEOL);
+    chars += attoHTTPprint("Connection: Upgrade" HTTPEOL);
+    chars += attoHTTPprintf("Sec-WebSocket-Accept: %s" HTTPEOL, accept);
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+    _attoHTTP_wsDeflateFlags |= _attoHTTPWS_NO_TAKEOVER;
+#endif
+    if (_attoHTTP_wsDeflate != 0) {
+        chars += attoHTTPprint("Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover");
+        if ((_attoHTTP_wsDeflateFlags & _attoHTTPWS_NO_TAKEOVER) != 0) {
+            chars += attoHTTPprint("; server_no_context_takeover");
+        }
+        if ((_attoHTTP_wsDeflateFlags & _attoHTTPWS_WINDOW_BITS) != 0) {
+            chars += attoHTTPprintf("; server_max_window_bits=%u", _attoHTTP_wsDeflate);
+        }
+        chars += attoHTTPprint(HTTPEOL);
+    }
+#endif
+    chars += attoHTTPprint(HTTPEOL);
+    _attoHTTP_returnCode = STATUS_SWITCHING_PROTOCOLS;
+    _attoHTTP_headersSent = 1;
+    return chars;
+}
+/**
+ * @brief Finds the WebSocket URL for this request, and upgrades the connection
+ *
+ * @return 1 if the connection was upgraded, -1 if the URL is a WebSocket but
+ *         the request can't be upgraded, 0 if the URL is not a WebSocket
+ */
+static int8_t
+_attoHTTPFindWebSocket(void)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_WEBSOCKET_ROUTES; i++) {
+        if ((_attoHTTPWebSocketRoutes[i].callback != NULL)
+            && (strncmp((char *)_attoHTTP_url, _attoHTTPWebSocketRoutes[i].url, sizeof(_attoHTTPWebSocketRoutes[i].url)) == 0)) {
+            if ((_attoHTTPMethod != METHOD_GET) || (_attoHTTPVersion != V1_1)
+                || (_attoHTTP_wsUpgrade != _attoHTTPWS_ALL)) {
+                _attoHTTP_returnCode = STATUS_BADREQUEST;
+                return -1;
+            }
+            _attoHTTP_wsCallback = _attoHTTPWebSocketRoutes[i].callback;
+            _attoHTTPSendWebSocketHeaders();
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+/**
+ * @brief Finds the page for a URL
+ *
+ * This is done right after the request line, so the page is known before
+ * the headers are read.
+ *
+ * @param url The URL, without the parameters
+ * @param len The length of the URL that was read, parameters and all
+ *
+ * @return The page, or NULL if there isn't one
+ */
+static inline attoHTTPPage_t *
+_attoHTTPMatchPage(const uint8_t *url, uint16_t len)
+{
+    uint8_t i;
+    if (_attoHTTPDefaultPage(url, len) || _attoHTTPCheckPage(url, _attoHTTPDefaultPage)) {
+        return &_attoHTTPDefaultPage;
+    }
+    for (i = 0; i < ATTOHTTP_PAGE_BUFFERS; i++) {
+        if (_attoHTTPCheckPage(url, _attoHTTPPages[i])) {
+            return &_attoHTTPPages[i];
+        }
+    }
+    return NULL;
+}
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * @brief Checks if this request needs authentication
+ *
+ * Pages have their own setting.  Anything else is a REST route, and doesn't
+ * need authentication if it is under one of the routes in
+ * _attoHTTPAuthRoutes.
+ *
+ * @return 1 if it needs authentication, 0 otherwise
+ */
+static inline uint8_t
+_attoHTTPAuthRequired(void)
+{
+    uint8_t i;
+    size_t len;
+    if (_attoHTTP_page != NULL) {
+        return (_attoHTTP_page->auth != AUTH_NONE);
+    }
+    for (i = 0; i < ATTOHTTP_AUTH_ROUTES; i++) {
+        len = strlen(_attoHTTPAuthRoutes[i]);
+        if ((len > 0) && (strncmp((char *)_attoHTTP_url, _attoHTTPAuthRoutes[i], len) == 0)
+            && ((_attoHTTP_url[len] == 0) || (_attoHTTP_url[len] == '/') || (_attoHTTPAuthRoutes[i][len - 1] == '/'))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif
+/**
+ * @brief Finds the page associated with the URL.
+ *
+ * If no pages are found, it will try to run an API callback function using
+ * _attoHTTPFindAPICallback()
+ *
+ * @return 1 if a page was found (or function called), 0 otherwise.
+ */
+static inline int8_t
+_attoHTTPFindPage(void)
+{
+    int8_t ret = 0;
+    attoHTTPPage_t *page = _attoHTTP_page;
+#ifdef ATTOHTTP_WEBSOCKET
+    ret = _attoHTTPFindWebSocket();
+    if (ret != 0) {
+        return ret;
+    }
+#endif
+    if (page != NULL) {
+        if ((_attoHTTPMethod == METHOD_GET) && (page->type == TEXT_EVENTSTREAM)) {
+            _attoHTTP_sseStream = page->stream;
+            attoHTTPSendServerSentEventHeaders();
+            ret = 1;
+        } else if (_attoHTTPMethod == METHOD_GET) {
+            _attoHTTP_returnCode = STATUS_OK;
+            _attoHTTP_contenttype = page->type;
+            _attoHTTP_contentlength = page->size;
+            attoHTTPSendHeaders();
+            attoHTTPwrite(page->content, page->size);
+            ret = 1;
+        } else {
+#ifdef __DEBUG__
+        printf("Wrong method on page: %d\r\n", _attoHTTPMethod);
+#endif
+            
+            _attoHTTP_returnCode = STATUS_UNSUPPORTED;
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = _attoHTTPFindAPICallback();
+    }
+    return ret;
+}
+/**
+ * @brief This gets a character for the URL parsing
+ *
+ * This reads the body of the request.  URL parameters for GET requests are
+ * handled by _attoHTTPIndexURLParams() instead.
+ *
+ * @param c The character buffer to put the character in
+ *
+ * @return The number of characters retrieved.
+ */
+uint8_t
+_attoHTTPParseURLParamChar(char *c)
+{
+    uint8_t ret = 0;
+    // Take up any space characters in the body.
+    do {
+        ret = _attoHTTPReadC((uint8_t *)c);
+    } while ((ret == 1) && (isspace((uint8_t)*c) || (*c == '?')));
+    return ret;
+
+}
+/**
+ * @brief Decodes one character of a URL encoded string
+ *
+ * '+' becomes a space and %XX becomes the byte it stands for.  Everything
+ * else is passed through as is.
+ *
+ * @param in  The string to decode from
+ * @param end One past the last character of the string
+ * @param c   Where to put the decoded character
+ *
+ * @return The number of input characters used, or 0 for a bad % escape
+ */
+static inline uint8_t
+_attoHTTPURLDecodeC(const uint8_t *in, const uint8_t *end, uint8_t *c)
+{
+    uint8_t hi, lo;
+    if (*in == '%') {
+        if ((end - in) < 3) {
+            return 0;
+        }
+        hi = _attoHTTPHexTable[in[1]];
+        lo = _attoHTTPHexTable[in[2]];
+        if ((hi & lo & ATTOHTTP_HEX_VALID) == 0) {
+            return 0;
+        }
+        *c = (uint8_t)((hi << 4) | (lo & 0x0F));
+        return 3;
+    }
+    *c = (*in == '+') ? ' ' : *in;
+    return 1;
+}
+/**
+ * @brief Decodes the URL parameters in place and indexes them
+ *
+ * This is done once per request, the first time the parameters are asked
+ * for.  Decoding never makes the string longer, so it is done in the URL
+ * buffer itself, and the names and values in _attoHTTP_url_param point back
+ * into it.
+ *
+ * @return none
+ */
+static void
+_attoHTTPIndexURLParams(void)
+{
+    uint8_t *r, *w, *end;
+    uint8_t c, used;
+    uint8_t bad = 0;
+    attoHTTPParam_t *param = NULL;
+
+    _attoHTTP_url_indexed = 1;
+    if (_attoHTTP_url_params == NULL) {
+        return;
+    }
+    r = _attoHTTP_url_params;
+    w = _attoHTTP_url_params;
+    end = &_attoHTTP_url[_attoHTTP_url_len];
+    while (r < end) {
+        if ((*r == '&') || (*r == 0)) {
+            r++;
+            *w++ = 0;
+            if (bad) {
+                // Leave out anything we couldn't decode
+                _attoHTTP_url_param_count--;
+                bad = 0;
+            }
+            param = NULL;
+            continue;
+        }
+        if (param == NULL) {
+            if (_attoHTTP_url_param_count >= ATTOHTTP_URL_PARAMS) {
+                break;
+            }
+            param = &_attoHTTP_url_param[_attoHTTP_url_param_count++];
+            param->name = (char *)w;
+            param->value = NULL;
+            param->name_len = 0;
+            param->value_len = 0;
+        }
+        if ((*r == '=') && (param->value == NULL)) {
+            r++;
+            *w++ = 0;
+            param->value = (char *)w;
+            continue;
+        }
+        used = _attoHTTPURLDecodeC(r, end, &c);
+        if (used == 0) {
+            // The parameter gets dropped, so there is nothing to write
+            _attoHTTP_param_error = 1;
+            bad = 1;
+            r++;
+            continue;
+        }
+        r += used;
+        *w++ = c;
+        if (param->value == NULL) {
+            param->name_len++;
+        } else {
+            param->value_len++;
+        }
+    }
+    *w = 0;
+    if (bad) {
+        _attoHTTP_url_param_count--;
+    }
+}
+/**
+ * @brief Copies out the next indexed URL parameter
+ *
+ * @param name      The buffer to put the name into
+ * @param name_len  The length of the name buffer
+ * @param value     The buffer to put the value into
+ * @param value_len The length of the value buffer
+ *
+ * @return 1 on success, 0 on no
+ */
+static inline uint8_t
+_attoHTTPNextURLParam(char *name, uint8_t name_len, char *value, uint8_t value_len)
+{
+    const attoHTTPParam_t *param;
+    param = attoHTTPURLParamIndex(_attoHTTP_url_param_next);
+    if ((param == NULL) || (name_len == 0) || (value_len == 0)) {
+        return 0;
+    }
+    _attoHTTP_url_param_next++;
+    strncpy(name, param->name, name_len);
+    name[name_len - 1] = 0;
+    if (param->value == NULL) {
+        return 0;
+    }
+    strncpy(value, param->value, value_len);
+    value[value_len - 1] = 0;
+    return 1;
+}
+/**
+ * @brief Sends out the headers requiring authentication
+ *
+ * @param headers Extra headers to send.  Each header should end with HTTPEOL
+ *
+ * @return The number of characters printed
+ */
+uint32_t
+_attoHTTPSendAuthMessage(char *headers)
+{
+    uint32_t chars = 0;
+#if defined(ATTOHTTP_DIGEST_AUTH)
+    char nonce[_attoHTTPDIGEST_NONCE_SIZE + 1];
+#endif
+    if (_attoHTTP_firstlineSent == 0) {
+        attoHTTPFirstLine(STATUS_UNAUTHORIZED);
+    }
+    if (_attoHTTP_headersSent == 0) {
+#if defined(ATTOHTTP_BASIC_AUTH)
+        chars += attoHTTPprintf("WWW-Authenticate: Basic realm=\"%s\"" HTTPEOL, ATTOHTTP_AUTH_REALM);
+#endif
+#if defined(ATTOHTTP_DIGEST_AUTH)
+        _attoHTTPDigestNonce(nonce);
+        chars += attoHTTPprintf("WWW-Authenticate: Digest realm=\"%s\",", ATTOHTTP_AUTH_REALM);
+        chars += attoHTTPprintf("qop=\"auth\",algorithm=MD5,");
+        chars += attoHTTPprintf("nonce=\"%s\",", nonce);
+        chars += attoHTTPprintf("opaque=\"%s\"", ATTOHTTP_AUTH_REALM);
+        if (_attoHTTP_digestStale) {
+            chars += attoHTTPprint(",stale=true");
+        }
+        chars += attoHTTPprint(HTTPEOL);
+#endif
+        if (headers != NULL) {
+            chars += attoHTTPprint(headers);
+        }
+        chars += attoHTTPprint(HTTPEOL);
+        _attoHTTP_headersSent = 1;
+        chars += attoHTTPprint(ATTOHTTP_AUTH_ERROR_MSG);
+    }
+    return chars;
+}
+/**
+ * @brief The input buffer for the multipart parser
+ */
+typedef struct {
+    uint8_t buffer[ATTOHTTP_MULTIPART_BUFFER_SIZE];
+    uint16_t start;
+    uint16_t fill;
+    uint8_t eof;
+} attoHTTPMultipartBuffer_t;
+/**
+ * @brief Moves the unused data to the front of the buffer and fills the rest
+ *
+ * @param mp The multipart buffer
+ *
+ * @return The number of bytes waiting in the buffer
+ */
+static uint16_t
+_attoHTTPMultipartFill(attoHTTPMultipartBuffer_t *mp)
+{
+    if (mp->start > 0) {
+        memmove(mp->buffer, &mp->buffer[mp->start], mp->fill - mp->start);
+        mp->fill -= mp->start;
+        mp->start = 0;
+    }
+    if (!mp->eof && (mp->fill < sizeof(mp->buffer))) {
+        uint16_t want = sizeof(mp->buffer) - mp->fill;
+        uint16_t got = attoHTTPReadBody(&mp->buffer[mp->fill], want);
+        mp->fill += got;
+        if (got < want) {
+            mp->eof = 1;
+        }
+    }
+    return mp->fill;
+}
+/**
+ * @brief Gets one character out of the multipart buffer
+ *
+ * @param mp The multipart buffer
+ * @param c  Where to put the character
+ *
+ * @return 1 if a character was read, 0 if there are no more
+ */
+static inline uint8_t
+_attoHTTPMultipartGetC(attoHTTPMultipartBuffer_t *mp, uint8_t *c)
+{
+    if ((mp->start >= mp->fill) && (_attoHTTPMultipartFill(mp) == 0)) {
+        return 0;
+    }
+    *c = mp->buffer[mp->start++];
+    return 1;
+}
+/**
+ * @brief Finds the delimiter in the multipart buffer
+ *
+ * The delimiter always starts with a CR, so this lets memchr() skip ahead to
+ * each CR and only compares the whole delimiter there.  That needs no table,
+ * so nothing but the buffer and the delimiter is kept.
+ *
+ * @param mp    The multipart buffer
+ * @param delim The delimiter to look for
+ * @param dlen  The length of the delimiter
+ *
+ * @return The offset from mp->start of the delimiter, or -1 if not found
+ */
+static int32_t
+_attoHTTPMultipartFind(attoHTTPMultipartBuffer_t *mp, const uint8_t *delim, uint16_t dlen)
+{
+    const uint8_t *hay = &mp->buffer[mp->start];
+    const uint8_t *end = &mp->buffer[mp->fill];
+    const uint8_t *ptr = hay;
+    while ((end - ptr) >= dlen) {
+        ptr = memchr(ptr, delim[0], (end - ptr) - dlen + 1);
+        if (ptr == NULL) {
+            break;
+        }
+        if (memcmp(ptr, delim, dlen) == 0) {
+            return ptr - hay;
+        }
+        ptr++;
+    }
+    return -1;
+}
+/**
+ * @brief Reads one line of a multipart header
+ *
+ * Anything that doesn't fit in the buffer is thrown away.
+ *
+ * @param mp   The multipart buffer
+ * @param line The buffer to put the line in
+ * @param size The size of the line buffer
+ *
+ * @return The length of the line, or -1 if the data ran out
+ */
+static int16_t
+_attoHTTPMultipartLine(attoHTTPMultipartBuffer_t *mp, uint8_t *line, uint16_t size)
+{
+    uint16_t len = 0;
+    uint8_t c;
+    while (_attoHTTPMultipartGetC(mp, &c)) {
+        if (c == '\n') {
+            line[len] = 0;
+            return len;
+        } else if ((c != '\r') && (len < (size - 1))) {
+            line[len++] = c;
+        }
+    }
+    return -1;
+}
+/**
+ * @brief Works out how many bytes an event takes on the wire
+ *
+ * @param elen The length of the event name
+ * @param dlen The length of the data
+ *
+ * @return The number of bytes
+ */
+static inline uint32_t
+_attoHTTPSSEEventLength(uint16_t elen, uint16_t dlen)
+{
+    uint32_t len = 1;
+    if (elen > 0) {
+        len += (uint32_t)elen + 7;    // "event:" + '\n'
+    }
+    if (dlen > 0) {
+        len += (uint32_t)dlen + 6;    // "data:" + '\n'
+    }
+    return len;
+}
+/**
+ * @brief Gets the time for server sent events
+ *
+ * @return The time in ms
+ */
+static inline uint32_t
+_attoHTTPSSETime(void)
+{
+    if (_attoHTTPSSEClock != NULL) {
+        return _attoHTTPSSEClock();
+    }
+    return _attoHTTPSSENow;
+}
+/**
+ * @brief Makes the id: line that goes in front of an event
+ *
+ * @param buf The buffer to put it in.  It has to hold 16 bytes.
+ * @param id  The event id.  0 makes an empty line, since 0 is never an id.
+ *
+ * @return The length of the line
+ */
+static inline uint8_t
+_attoHTTPSSEIDLine(char *buf, uint32_t id)
+{
+    if (id == 0) {
+        buf[0] = 0;
+        return 0;
+    }
+    return snprintf(buf, 16, "id:%" PRIu32 "\n", id);
+}
+/**
+ * @brief Copies bytes into the event ring buffer
+ *
+ * @param buf The bytes to copy
+ * @param len The number of bytes
+ *
+ * @return None
+ */
+static void
+_attoHTTPSSERingPut(const uint8_t *buf, uint16_t len)
+{
+    uint16_t start, chunk;
+    while (len > 0) {
+        start = _attoHTTPSSERingIndex(_attoHTTPSSEHead);
+        chunk = ATTOHTTP_SSE_RING_SIZE - start;
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(&_attoHTTPSSERing[start], buf, chunk);
+        _attoHTTPSSEHead += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+/**
+ * @brief Writes a block of bytes straight to a connection
+ *
+ * @param write The first argument for attoHTTPSetByte.
+ * @param buf   The bytes to write
+ * @param len   The number of bytes
+ *
+ * @return The number of bytes written, -1 on error
+ */
+static int16_t
+_attoHTTPWriteBlock(void *write, const uint8_t *buf, uint16_t len)
+{
+#ifdef ATTOHTTP_BULK_WRITE
+    return attoHTTPSetBytes(write, buf, len);
+#else
+    uint16_t i;
+    for (i = 0; i < len; i++) {
+        if (attoHTTPSetByte(write, buf[i]) != 1) {
+            return -1;
+        }
+    }
+    return len;
+#endif
+}
+/**
+ * @brief Writes a block of bytes to a subscriber
+ *
+ * If the write fails the subscriber is removed.
+ *
+ * @param sub The subscriber handle
+ * @param buf The bytes to write
+ * @param len The number of bytes
+ *
+ * @return The number of bytes written, -1 if the subscriber was removed
+ */
+static int16_t
+_attoHTTPSSEOut(int8_t sub, const uint8_t *buf, uint16_t len)
+{
+    attoHTTPSSESubscriber_t *s = &_attoHTTPSSESubscribers[sub];
+    int16_t ret = _attoHTTPWriteBlock(s->write, buf, len);
+    if (ret < 0) {
+        attoHTTPSSERemove(sub);
+    } else if (ret > 0) {
+        s->last = _attoHTTPSSETime();
+    }
+    return ret;
+}
+/**
+ * @brief Finds the end of an event in the ring
+ *
+ * @param id The event id
+ *
+ * @return The cursor just past the end of the event
+ */
+static inline uint32_t
+_attoHTTPSSEEventEnd(uint32_t id)
+{
+    if (id == _attoHTTPSSELastID) {
+        return _attoHTTPSSEHead;
+    }
+    return _attoHTTPSSEEvent(id + 1)->start;
+}
+/**
+ * @brief Compares bytes in the ring with a buffer
+ *
+ * @param pos The cursor in the ring to start at
+ * @param buf The buffer to compare with
+ * @param len The number of bytes
+ *
+ * @return 1 if they are the same, 0 otherwise
+ */
+static uint8_t
+_attoHTTPSSERingMatch(uint32_t pos, const uint8_t *buf, uint16_t len)
+{
+    while (len-- > 0) {
+        if (_attoHTTPSSERing[_attoHTTPSSERingIndex(pos++)] != *buf++) {
+            return 0;
+        }
+    }
+    return 1;
+}
+/**
+ * @brief Checks to see if a subscriber is too far behind
+ *
+ * @param s     The subscriber
+ * @param limit The most bytes that can be waiting
+ * @param slot  Also count it as behind if the next event will take the
+ *              history entry of the event it is on
+ *
+ * @return 1 if it is behind, 0 otherwise
+ */
+static inline uint8_t
+_attoHTTPSSEBehind(attoHTTPSSESubscriber_t *s, uint32_t limit, uint8_t slot)
+{
+    if (_attoHTTPSSEPending(s) > limit) {
+        return 1;
+    }
+    return slot && ((_attoHTTPSSENextID() - s->event) >= ATTOHTTP_SSE_HISTORY);
+}
+/**
+ * @brief Applies the back pressure policy to a subscriber
+ *
+ * This also skips over any events that were published to other streams.
+ * Events can only be skipped if none of them has been sent yet, so this
+ * doesn't do anything while the subscriber is part way through an event.
+ *
+ * If len is set the subscriber is about to lose data it hasn't got, so it
+ * is removed if skipping events doesn't make room.  Otherwise it is checked
+ * against the high water mark of its stream.
+ *
+ * @param sub The subscriber handle
+ * @param len The size of the event about to be published, or 0
+ *
+ * @return 0 if the subscriber was removed, 1 otherwise
+ */
+static uint8_t
+_attoHTTPSSEShed(int8_t sub, uint32_t len)
+{
+    attoHTTPSSESubscriber_t *s = &_attoHTTPSSESubscribers[sub];
+    attoHTTPSSEStream_t *stream;
+    attoHTTPSSEHistory_t *h;
+    uint32_t limit;
+    uint8_t lapped = (len > 0);
+    if (s->write == NULL) {
+        return 0;
+    }
+    stream = &_attoHTTPSSEStreams[s->stream];
+    limit = lapped ? (ATTOHTTP_SSE_RING_SIZE - len) : stream->highwater;
+    while (s->event != _attoHTTPSSENextID()) {
+        h = _attoHTTPSSEEvent(s->event);
+        if (s->cursor != h->start) {
+            break;
+        }
+        if (((h->stream == SSE_ALL_STREAMS) || (h->stream == s->stream))
+            && (!_attoHTTPSSEBehind(s, limit, lapped)
+                || !((stream->policy == SSE_DROP_OLDEST) || ((stream->policy == SSE_COALESCE) && h->superseded)))) {
+            break;
+        }
+        s->cursor = _attoHTTPSSEEventEnd(s->event);
+        s->event = _attoHTTPSSEAfter(s->event);
+    }
+    if (_attoHTTPSSEBehind(s, limit, lapped) && (lapped || (stream->policy == SSE_DISCONNECT))) {
+        attoHTTPSSERemove(sub);
+        return 0;
+    }
+    return 1;
+}
+/**
+ * @brief Sends everything a subscriber hasn't got yet out of the ring
+ *
+ * The rest of a heartbeat goes out first if one has been started.  After
+ * that this goes one event at a time, so the back pressure policy can be applied
+ * between events.  Each event is sent in at most two blocks, one up to the
+ * end of the buffer and one from the start.  If a write fails the subscriber
+ * is removed.
+ *
+ * @param sub The subscriber handle
+ *
+ * @return 1 if the subscriber has everything, 0 otherwise
+ */
+static uint8_t
+_attoHTTPSSEFlushOne(int8_t sub)
+{
+    attoHTTPSSESubscriber_t *s = &_attoHTTPSSESubscribers[sub];
+    uint32_t end;
+    uint16_t start, chunk;
+    int16_t ret;
+    if (s->write == NULL) {
+        return 0;
+    }
+    while (s->beat > 0) {
+        ret = _attoHTTPSSEOut(sub, &_attoHTTPSSEHeartbeat[sizeof(_attoHTTPSSEHeartbeat) - 1 - s->beat], s->beat);
+        if (ret <= 0) {
+            return 0;
+        }
+        s->beat -= ret;
+    }
+    while (s->event != _attoHTTPSSENextID()) {
+        if (!_attoHTTPSSEShed(sub, 0)) {
+            return 0;
+        }
+        if (s->event == _attoHTTPSSENextID()) {
+            // Everything that was left got skipped
+            break;
+        }
+        end = _attoHTTPSSEEventEnd(s->event);
+        while (s->cursor != end) {
+            start = _attoHTTPSSERingIndex(s->cursor);
+            chunk = ATTOHTTP_SSE_RING_SIZE - start;
+            if (chunk > (end - s->cursor)) {
+                chunk = end - s->cursor;
+            }
+            ret = _attoHTTPSSEOut(sub, &_attoHTTPSSERing[start], chunk);
+            if (ret <= 0) {
+                // Either it was removed or it can't take any more right now
+                return 0;
+            }
+            s->cursor += ret;
+        }
+        s->event = _attoHTTPSSEAfter(s->event);
+    }
+    return 1;
+}
+/**
+ * @brief Works out where a new subscriber should start in the ring
+ *
+ * If the client sent a Last-Event-ID, and the events after it are still in
+ * the ring, the subscriber starts at the first one it missed.  Otherwise it
+ * only gets new events.
+ *
+ * @param s The subscriber to set the cursor on
+ *
+ * @return None
+ */
+static void
+_attoHTTPSSEReplayStart(attoHTTPSSESubscriber_t *s)
+{
+    attoHTTPSSEHistory_t *h;
+    uint32_t next;
+    s->cursor = _attoHTTPSSEHead;
+    s->event = _attoHTTPSSENextID();
+    if (_attoHTTP_lastEventIDValid && (_attoHTTP_lastEventID != _attoHTTPSSELastID)) {
+        next = _attoHTTPSSEAfter(_attoHTTP_lastEventID);
+        h = _attoHTTPSSEEvent(next);
+        if ((h->id == next) && ((_attoHTTPSSEHead - h->start) <= ATTOHTTP_SSE_RING_SIZE)) {
+            s->cursor = h->start;
+            s->event = next;
+        }
+    }
+}
+#ifdef ATTOHTTP_WEBSOCKET
+/**
+ * @brief Unmasks WebSocket payload bytes
+ *
+ * The mask is turned into a word so that this can go 4 bytes at a time.  The
+ * memcpy() calls turn into plain loads and stores, without caring about how
+ * buf is aligned.
+ *
+ * @param buf    The payload bytes
+ * @param len    The number of bytes
+ * @param mask   The 4 byte masking key from the frame
+ * @param offset How far into the frame payload buf starts
+ *
+ * @return None
+ */
+static void
+_attoHTTPWebSocketUnmask(uint8_t *buf, uint16_t len, const uint8_t *mask, uint32_t offset)
+{
+    uint8_t key[4];
+    uint32_t word;
+    uint32_t chunk;
+    uint16_t i;
+    for (i = 0; i < 4; i++) {
+        key[i] = mask[(offset + i) & 3];
+    }
+    memcpy(&word, key, sizeof(word));
+    for (i = 0; (i + 4) <= len; i += 4) {
+        memcpy(&chunk, &buf[i], sizeof(chunk));
+        chunk ^= word;
+        memcpy(&buf[i], &chunk, sizeof(chunk));
+    }
+    for (; i < len; i++) {
+        buf[i] ^= key[i & 3];
+    }
+}
+/**
+ * @brief Writes all of a block of bytes to a WebSocket
+ *
+ * Frames can't be cut short, so if the connection is full this waits on it
+ * with attoHTTPSetByte().
+ *
+ * @param write The first argument for attoHTTPSetByte.
+ * @param buf   The bytes to write
+ * @param len   The number of bytes
+ *
+ * @return 1 on success, 0 on error
+ */
+static uint8_t
+_attoHTTPWebSocketWrite(void *write, const uint8_t *buf, uint16_t len)
+{
+#ifdef ATTOHTTP_BULK_WRITE
+    int16_t ret;
+    while (len > 0) {
+        ret = attoHTTPSetBytes(write, buf, len);
+        if (ret == 0) {
+            ret = attoHTTPSetByte(write, *buf);
+        }
+        if (ret <= 0) {
+            return 0;
+        }
+        buf += ret;
+        len -= ret;
+    }
+#else
+    uint16_t i;
+    for (i = 0; i < len; i++) {
+        if (attoHTTPSetByte(write, buf[i]) != 1) {
+            return 0;
+        }
+    }
+#endif
+    return 1;
+}
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+/**
+ * @brief Puts bits into the compressed output
+ *
+ * @param b     The bit writer
+ * @param value The bits, first bit in the low end
+ * @param n     The number of bits
+ *
+ * @return None
+ */
+static void
+_attoHTTPPutBits(attoHTTPBitWriter_t *b, uint32_t value, uint8_t n)
+{
+    b->bits |= value << b->count;
+    b->count += n;
+    while (b->count >= 8) {
+        if (b->pos >= b->size) {
+            b->full = 1;
+        } else {
+            b->out[b->pos++] = b->bits & 0xFF;
+        }
+        b->bits >>= 8;
+        b->count -= 8;
+    }
+}
+/**
+ * @brief Puts a Huffman code into the compressed output
+ *
+ * Huffman codes go out starting with their top bit, so they are turned
+ * around first.
+ *
+ * @param b    The bit writer
+ * @param code The code
+ * @param n    The number of bits in the code
+ *
+ * @return None
+ */
+static void
+_attoHTTPPutCode(attoHTTPBitWriter_t *b, uint16_t code, uint8_t n)
+{
+    uint16_t rev = 0;
+    uint8_t i;
+    for (i = 0; i < n; i++) {
+        rev = (rev << 1) | (code & 1);
+        code >>= 1;
+    }
+    _attoHTTPPutBits(b, rev, n);
+}
+/**
+ * @brief Puts a literal/length symbol out using the fixed Huffman codes
+ *
+ * @param b   The bit writer
+ * @param sym The symbol, 0 to 287
+ *
+ * @return None
+ */
+static void
+_attoHTTPPutSymbol(attoHTTPBitWriter_t *b, uint16_t sym)
+{
+    if (sym < 144) {
+        _attoHTTPPutCode(b, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        _attoHTTPPutCode(b, 0x190 + (sym - 144), 9);
+    } else if (sym < 280) {
+        _attoHTTPPutCode(b, sym - 256, 7);
+    } else {
+        _attoHTTPPutCode(b, 0xC0 + (sym - 280), 8);
+    }
+}
+/**
+ * @brief Puts a match out using the fixed Huffman codes
+ *
+ * @param b    The bit writer
+ * @param len  The length of the match, 3 to 258
+ * @param dist How far back the match is, 1 to 32768
+ *
+ * @return None
+ */
+static void
+_attoHTTPPutMatch(attoHTTPBitWriter_t *b, uint16_t len, uint16_t dist)
+{
+    int8_t i;
+    for (i = 28; len < _attoHTTPDeflateLengthBase[i]; i--);
+    _attoHTTPPutSymbol(b, 257 + i);
+    _attoHTTPPutBits(b, len - _attoHTTPDeflateLengthBase[i], _attoHTTPDeflateLengthExtra[i]);
+    for (i = 29; dist < _attoHTTPDeflateDistBase[i]; i--);
+    _attoHTTPPutCode(b, i, 5);
+    _attoHTTPPutBits(b, dist - _attoHTTPDeflateDistBase[i], _attoHTTPDeflateDistExtra[i]);
+}
+/**
+ * @brief Hashes the 3 bytes at the start of a possible match
+ *
+ * @param data The bytes
+ *
+ * @return The hash
+ */
+static inline uint16_t
+_attoHTTPDeflateHash(const uint8_t *data)
+{
+    uint32_t key = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+    return (uint32_t)(key * 2654435761UL) >> (32 - _attoHTTPWS_HASH_BITS);
+}
+/**
+ * @brief Compresses a message for permessage-deflate
+ *
+ * This uses one block with the fixed Huffman codes from RFC 1951.  That
+ * doesn't need any tables to be sent, which is a good trade for short
+ * messages.  Matches are found with a hash chain that is only followed
+ * ATTOHTTP_WEBSOCKET_DEFLATE_CHAIN steps, and never go back further than the
+ * window that was set up.
+ *
+ * If the connection keeps its context, the window from the messages before
+ * goes in front of this one, so matches can point back into it.  The message
+ * ends with an empty stored block, with the 0x00 0x00 0xFF 0xFF from it left
+ * off, the way RFC 7692 asks.
+ *
+ * The output goes in _attoHTTPDeflateOut.  It has to be smaller than the
+ * message, or it is no good.
+ *
+ * @param w    The WebSocket
+ * @param data The message
+ * @param len  The length of the message
+ *
+ * @return The compressed length, or 0 if it didn't get smaller
+ */
+static uint16_t
+_attoHTTPDeflate(attoHTTPWebSocket_t *w, const uint8_t *data, uint16_t len)
+{
+    attoHTTPBitWriter_t b;
+    uint8_t *d = _attoHTTPDeflateData;
+    uint16_t window = 1 << w->deflate;
+    uint16_t hist = 0;
+    uint16_t end, pos, cand, blen, best, limit, i;
+    uint16_t hash;
+    uint8_t chain;
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+    if (w->takeover) {
+        hist = w->wfill;
+        memcpy(d, w->window, hist);
+    }
+#endif
+    memcpy(&d[hist], data, len);
+    end = hist + len;
+    // All 0xFF bytes makes every entry _attoHTTPWS_NO_MATCH
+    memset(_attoHTTPDeflateHead, 0xFF, sizeof(_attoHTTPDeflateHead));
+    for (pos = 0; (pos < hist) && ((pos + 2) < end); pos++) {
+        hash = _attoHTTPDeflateHash(&d[pos]);
+        _attoHTTPDeflatePrev[pos] = _attoHTTPDeflateHead[hash];
+        _attoHTTPDeflateHead[hash] = pos;
+    }
+    b.out = _attoHTTPDeflateOut;
+    b.size = len - 1;
+    b.pos = 0;
+    b.bits = 0;
+    b.count = 0;
+    b.full = 0;
+    // Not the last block, fixed Huffman codes
+    _attoHTTPPutBits(&b, 0x2, 3);
+    pos = hist;
+    while ((pos < end) && !b.full) {
+        blen = 0;
+        best = 0;
+        if ((pos + 2) < end) {
+            limit = ((end - pos) < 258) ? (end - pos) : 258;
+            hash = _attoHTTPDeflateHash(&d[pos]);
+            cand = _attoHTTPDeflateHead[hash];
+            for (chain = 0; (cand != _attoHTTPWS_NO_MATCH) && (chain < ATTOHTTP_WEBSOCKET_DEFLATE_CHAIN); chain++) {
+                if ((pos - cand) > window) {
+                    break;
+                }
+                if (d[cand + blen] == d[pos + blen]) {
+                    for (i = 0; (i < limit) && (d[cand + i] == d[pos + i]); i++);
+                    if (i > blen) {
+                        blen = i;
+                        best = pos - cand;
+                        if (i == limit) {
+                            break;
+                        }
+                    }
+                }
+                cand = _attoHTTPDeflatePrev[cand];
+            }
+        }
+        if (blen < 3) {
+            blen = 1;
+            _attoHTTPPutSymbol(&b, d[pos]);
+        } else {
+            _attoHTTPPutMatch(&b, blen, best);
+        }
+        for (i = 0; (i < blen) && ((pos + 2) < end); i++, pos++) {
+            hash = _attoHTTPDeflateHash(&d[pos]);
+            _attoHTTPDeflatePrev[pos] = _attoHTTPDeflateHead[hash];
+            _attoHTTPDeflateHead[hash] = pos;
+        }
+        pos += blen - i;
+    }
+    // End of block, then the empty stored block that gets cut off
+    _attoHTTPPutSymbol(&b, 256);
+    _attoHTTPPutBits(&b, 0, 3);
+    if (b.count > 0) {
+        _attoHTTPPutBits(&b, 0, 8 - b.count);
+    }
+    if (b.full) {
+        return 0;
+    }
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+    if (w->takeover) {
+        w->wfill = (end < window) ? end : window;
+        memcpy(w->window, &d[end - w->wfill], w->wfill);
+    }
+#endif
+    return b.pos;
+}
+/**
+ * @brief Gets the next byte of a compressed message
+ *
+ * @param s The inflate state
+ *
+ * @return The byte
+ */
+static uint8_t
+_attoHTTPInflateByte(attoHTTPInflate_t *s)
+{
+    static const uint8_t tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+    if (s->inpos < s->inlen) {
+        return s->in[s->inpos++];
+    }
+    if (s->inpos < (s->inlen + sizeof(tail))) {
+        return tail[s->inpos++ - s->inlen];
+    }
+    s->error = -1;
+    return 0;
+}
+/**
+ * @brief Gets bits out of a compressed message
+ *
+ * @param s    The inflate state
+ * @param need The number of bits, 16 or less
+ *
+ * @return The bits, first bit in the low end
+ */
+static uint16_t
+_attoHTTPInflateBits(attoHTTPInflate_t *s, uint8_t need)
+{
+    uint32_t val = s->bits;
+    while (s->count < need) {
+        val |= (uint32_t)_attoHTTPInflateByte(s) << s->count;
+        s->count += 8;
+    }
+    s->bits = val >> need;
+    s->count -= need;
+    return val & ((1UL << need) - 1);
+}
+/**
+ * @brief Builds a canonical Huffman code from the code lengths
+ *
+ * @param h       The code to build
+ * @param lengths The code length for each symbol, 0 if it isn't used
+ * @param n       The number of symbols
+ *
+ * @return 1 on success, 0 if there are too many codes of some length
+ */
+static uint8_t
+_attoHTTPHuffmanBuild(attoHTTPHuffman_t *h, const uint8_t *lengths, uint16_t n)
+{
+    uint16_t offs[16];
+    int32_t left = 1;
+    uint16_t sym;
+    uint8_t len;
+    memset(h->count, 0, sizeof(h->count));
+    for (sym = 0; sym < n; sym++) {
+        h->count[lengths[sym]]++;
+    }
+    for (len = 1; len < 16; len++) {
+        left = (left << 1) - h->count[len];
+        if (left < 0) {
+            return 0;
         }
-        if (cmdlvl > 0) {
-            _attoHTTP_returnCode = _attoHTTPDefaultCallback(_attoHTTPMethod, _attoHTTP_accept, command, id, cmdlvl, idlvl);
-        } else {
-            _attoHTTP_returnCode = STATUS_INTERNAL_ERROR;
+    }
+    offs[1] = 0;
+    for (len = 1; len < 15; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (sym = 0; sym < n; sym++) {
+        if (lengths[sym] != 0) {
+            h->symbol[offs[lengths[sym]]++] = sym;
         }
     }
-    return ret;
+    return 1;
 }
 /**
- * @brief This prints out the STATUS_OK message
+ * @brief Decodes one symbol with a Huffman code
  *
- * @return The number of characters printed
+ * @param s The inflate state
+ * @param h The code
+ *
+ * @return The symbol, or -1 on error
  */
-uint16_t
-attoHTTPSendServerSentEventHeaders(void)
+static int16_t
+_attoHTTPHuffmanDecode(attoHTTPInflate_t *s, const attoHTTPHuffman_t *h)
 {
-    uint16_t chars = 0;
-    attoHTTPFirstLine(STATUS_OK);
-    chars += attoHTTPprintf("Content-Type: %s" HTTPEOL, _mimetypes[TEXT_EVENTSTREAM]);
-    chars += attoHTTPprint("Cache-Control: no-cache" HTTPEOL);
-    chars += attoHTTPprint(HTTPEOL);
-    _attoHTTP_returnCode = STATUS_SERVERSENTEVENTS;
-    _attoHTTP_headersSent = 1;
-    return chars;
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    uint8_t len;
+    for (len = 1; (len < 16) && (s->error == 0); len++) {
+        code |= _attoHTTPInflateBits(s, 1);
+        if ((code - h->count[len]) < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += h->count[len];
+        first = (first + h->count[len]) << 1;
+        code <<= 1;
+    }
+    s->error = -1;
+    return -1;
 }
 /**
- * @brief Finds the page associated with the URL.
+ * @brief Inflates a block that uses Huffman codes
  *
- * If no pages are found, it will try to run an API callback function using
- * _attoHTTPFindAPICallback()
+ * @param s    The inflate state
+ * @param lens The literal/length code
+ * @param dist The distance code
  *
- * @return 1 if a page was found (or function called), 0 otherwise.
+ * @return None.  s->error is set on errors.
  */
-static inline int8_t
-_attoHTTPFindPage(void)
+static void
+_attoHTTPInflateCodes(attoHTTPInflate_t *s, const attoHTTPHuffman_t *lens, const attoHTTPHuffman_t *dist)
 {
-    int8_t ret = 0;
-    uint8_t i;
-    attoHTTPPage_t *page = NULL;
-    if (_attoHTTPDefaultPage() || _attoHTTPCheckPage(_attoHTTPDefaultPage)) {
-        page = &_attoHTTPDefaultPage;
-    } else {
-        for (i = 0; i < ATTOHTTP_PAGE_BUFFERS; i++) {
-            if (_attoHTTPCheckPage(_attoHTTPPages[i])) {
-                page = &_attoHTTPPages[i];
-                break;
+    int16_t sym;
+    uint16_t len, back;
+    for (;;) {
+        sym = _attoHTTPHuffmanDecode(s, lens);
+        if ((s->error != 0) || (sym == 256)) {
+            return;
+        }
+        if (sym < 256) {
+            if (s->outpos >= s->outlen) {
+                s->error = -2;
+                return;
             }
+            s->out[s->outpos++] = sym;
+            continue;
         }
-    }
-    if (page != NULL) {
-        if (_attoHTTPMethod == METHOD_GET) {
-            _attoHTTP_returnCode = STATUS_OK;
-            _attoHTTP_contenttype = page->type;
-            _attoHTTP_contentlength = page->size;
-            attoHTTPSendHeaders();
-            attoHTTPwrite(page->content, page->size);
-            ret = 1;
-        } else {
-#ifdef __DEBUG__
-        printf("Wrong method on page: %d\r\n", _attoHTTPMethod);
-#endif
-            
-            _attoHTTP_returnCode = STATUS_UNSUPPORTED;
-            ret = -1;
+        sym -= 257;
+        if (sym >= 29) {
+            s->error = -1;
+            return;
         }
-    }
-
-    if (ret == 0) {
-        if (_attoHTTPServerSentEvents()) {
-            attoHTTPSendServerSentEventHeaders();
-            ret = 1;
-        } else {
-            ret = _attoHTTPFindAPICallback();
+        len = _attoHTTPDeflateLengthBase[sym] + _attoHTTPInflateBits(s, _attoHTTPDeflateLengthExtra[sym]);
+        sym = _attoHTTPHuffmanDecode(s, dist);
+        if ((sym < 0) || (sym >= 30)) {
+            s->error = -1;
+            return;
+        }
+        back = _attoHTTPDeflateDistBase[sym] + _attoHTTPInflateBits(s, _attoHTTPDeflateDistExtra[sym]);
+        if ((s->error != 0) || (back > s->outpos)) {
+            // There is no context from the messages before to point into
+            s->error = -1;
+            return;
+        }
+        if ((uint32_t)(s->outlen - s->outpos) < len) {
+            s->error = -2;
+            return;
+        }
+        while (len-- > 0) {
+            s->out[s->outpos] = s->out[s->outpos - back];
+            s->outpos++;
         }
     }
-    return ret;
 }
 /**
- * @brief This gets a character for the URL parsing
+ * @brief Inflates a compressed message from the client
  *
- * This character could be in the waiting buffer, or in the URL buffer.  This
- * function chooses the buffer based on the HTTP method.
+ * This does all three kinds of blocks from RFC 1951.  The client was told
+ * client_no_context_takeover, so every message starts with nothing in the
+ * window.
  *
- * @param c The character buffer to put the character in
+ * @param in     The compressed message
+ * @param inlen  The length of the compressed message
+ * @param out    Where to put the message
+ * @param outlen The size of out
+ * @param got    Where to put the length of the message
  *
- * @return The number of characters retrieved.
+ * @return 0 on success, -1 if the data is bad, -2 if it doesn't fit
  */
-uint8_t
-_attoHTTPParseURLParamChar(char *c)
+static int8_t
+_attoHTTPInflate(const uint8_t *in, uint16_t inlen, uint8_t *out, uint16_t outlen, uint16_t *got)
 {
-    uint8_t ret = 0;
-    if (_attoHTTPMethod == METHOD_GET) {
-        if (_attoHTTP_url_params_start++ < ATTOHTTP_URL_BUFFER_SIZE) {
-            *c = *_attoHTTP_url_params;
-            _attoHTTP_url_params++;
-            ret = 1;
+    static const uint8_t order[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+    attoHTTPInflate_t s;
+    uint16_t nlen, ndist, ncode, index, len, i;
+    int16_t sym;
+    uint8_t last, type, rep;
+    s.in = in;
+    s.inlen = inlen;
+    s.inpos = 0;
+    s.out = out;
+    s.outlen = outlen;
+    s.outpos = 0;
+    s.bits = 0;
+    s.count = 0;
+    s.error = 0;
+    do {
+        last = _attoHTTPInflateBits(&s, 1);
+        type = _attoHTTPInflateBits(&s, 2);
+        if (s.error != 0) {
+            break;
         }
-    } else {
-        // Take up any space characters in the body.
-        do {
-            ret = _attoHTTPReadC((uint8_t *)c);
-        } while ((ret == 1) && (isspace((uint8_t)*c) || (*c == '?')));
-    }
-    return ret;
-
+        if (type == 0) {
+            // Stored blocks start on a byte
+            s.bits = 0;
+            s.count = 0;
+            len = _attoHTTPInflateByte(&s);
+            len |= _attoHTTPInflateByte(&s) << 8;
+            i = _attoHTTPInflateByte(&s);
+            i |= _attoHTTPInflateByte(&s) << 8;
+            if ((s.error != 0) || (len != (uint16_t)~i)) {
+                s.error = -1;
+            } else if ((uint32_t)(s.outlen - s.outpos) < len) {
+                s.error = -2;
+            }
+            while ((s.error == 0) && (len-- > 0)) {
+                s.out[s.outpos++] = _attoHTTPInflateByte(&s);
+            }
+        } else if (type == 1) {
+            if (!_attoHTTPInflateFixed) {
+                for (i = 0; i < 144; i++) {
+                    _attoHTTPInflateLengths[i] = 8;
+                }
+                for (; i < 256; i++) {
+                    _attoHTTPInflateLengths[i] = 9;
+                }
+                for (; i < 280; i++) {
+                    _attoHTTPInflateLengths[i] = 7;
+                }
+                for (; i < 288; i++) {
+                    _attoHTTPInflateLengths[i] = 8;
+                }
+                _attoHTTPHuffmanBuild(&_attoHTTPInflateFixedLens, _attoHTTPInflateLengths, 288);
+                memset(_attoHTTPInflateLengths, 5, 30);
+                _attoHTTPHuffmanBuild(&_attoHTTPInflateFixedDist, _attoHTTPInflateLengths, 30);
+                _attoHTTPInflateFixed = 1;
+            }
+            _attoHTTPInflateCodes(&s, &_attoHTTPInflateFixedLens, &_attoHTTPInflateFixedDist);
+        } else if (type == 2) {
+            nlen = _attoHTTPInflateBits(&s, 5) + 257;
+            ndist = _attoHTTPInflateBits(&s, 5) + 1;
+            ncode = _attoHTTPInflateBits(&s, 4) + 4;
+            if ((nlen > 286) || (ndist > 30)) {
+                s.error = -1;
+                break;
+            }
+            memset(_attoHTTPInflateLengths, 0, sizeof(order));
+            for (i = 0; i < ncode; i++) {
+                _attoHTTPInflateLengths[order[i]] = _attoHTTPInflateBits(&s, 3);
+            }
+            if (!_attoHTTPHuffmanBuild(&_attoHTTPInflateLens, _attoHTTPInflateLengths, sizeof(order))) {
+                s.error = -1;
+                break;
+            }
+            for (index = 0; (index < (nlen + ndist)) && (s.error == 0);) {
+                sym = _attoHTTPHuffmanDecode(&s, &_attoHTTPInflateLens);
+                if (sym < 16) {
+                    _attoHTTPInflateLengths[index++] = sym;
+                    continue;
+                }
+                len = 0;
+                if (sym == 16) {
+                    if (index == 0) {
+                        s.error = -1;
+                        break;
+                    }
+                    len = _attoHTTPInflateLengths[index - 1];
+                    rep = 3 + _attoHTTPInflateBits(&s, 2);
+                } else if (sym == 17) {
+                    rep = 3 + _attoHTTPInflateBits(&s, 3);
+                } else {
+                    rep = 11 + _attoHTTPInflateBits(&s, 7);
+                }
+                if ((index + rep) > (nlen + ndist)) {
+                    s.error = -1;
+                    break;
+                }
+                while (rep-- > 0) {
+                    _attoHTTPInflateLengths[index++] = len;
+                }
+            }
+            if ((s.error != 0) || (_attoHTTPInflateLengths[256] == 0)
+                || !_attoHTTPHuffmanBuild(&_attoHTTPInflateLens, _attoHTTPInflateLengths, nlen)
+                || !_attoHTTPHuffmanBuild(&_attoHTTPInflateDist, &_attoHTTPInflateLengths[nlen], ndist)) {
+                s.error = -1;
+                break;
+            }
+            _attoHTTPInflateCodes(&s, &_attoHTTPInflateLens, &_attoHTTPInflateDist);
+        } else {
+            s.error = -1;
+        }
+    } while (!last && (s.error == 0) && (s.inpos < (s.inlen + 4)));
+    *got = s.outpos;
+    return s.error;
 }
+#endif
 /**
- * @brief Sends out the headers requiring authentication
+ * @brief Takes one byte of a WebSocket frame header
  *
- * @param headers Extra headers to send.  Each header should end with HTTPEOL
+ * Anything that breaks RFC 6455 closes the connection with 1002, and frames
+ * that won't fit in the buffer close it with 1009.
  *
- * @return The number of characters printed
+ * @param ws The WebSocket handle
+ * @param c  The byte
+ *
+ * @return 1 if the byte was good, 0 if the connection was closed
  */
-uint32_t
-_attoHTTPSendAuthMessage(char *headers)
+static uint8_t
+_attoHTTPWebSocketHeader(int8_t ws, uint8_t c)
 {
-    uint32_t chars = 0;
-    if (_attoHTTP_firstlineSent == 0) {
-        attoHTTPFirstLine(STATUS_UNAUTHORIZED);
+    attoHTTPWebSocket_t *w = &_attoHTTPWebSockets[ws];
+    uint8_t opcode;
+    switch (w->state) {
+        case _attoHTTPWS_HEADER:
+            opcode = c & 0x0F;
+            if ((c & 0x70) != 0) {
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+                // RSV1 is only good on the first frame of a compressed message
+                if (((c & 0x70) != 0x40) || (w->deflate == 0) || (opcode < WS_TEXT) || (opcode > WS_BINARY)) {
+                    return !attoHTTPWebSocketClose(ws, 1002);
+                }
+#else
+                // No extensions are set up, so the reserved bits must be 0
+                return !attoHTTPWebSocketClose(ws, 1002);
+#endif
+            }
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+            if ((opcode == WS_TEXT) || (opcode == WS_BINARY)) {
+                w->compressed = ((c & 0x40) != 0);
+            }
+#endif
+            if (opcode >= WS_CLOSE) {
+                // Control frames can't be fragmented
+                if (((c & 0x80) == 0) || (opcode > WS_PONG)) {
+                    return !attoHTTPWebSocketClose(ws, 1002);
+                }
+            } else if (opcode == WS_CONTINUATION) {
+                if (w->opcode == 0) {
+                    return !attoHTTPWebSocketClose(ws, 1002);
+                }
+            } else if ((opcode > WS_BINARY) || (w->opcode != 0)) {
+                return !attoHTTPWebSocketClose(ws, 1002);
+            }
+            w->frame = c;
+            w->state = _attoHTTPWS_LENGTH;
+            break;
+        case _attoHTTPWS_LENGTH:
+            if ((c & 0x80) == 0) {
+                // Everything from the client has to be masked
+                return !attoHTTPWebSocketClose(ws, 1002);
+            }
+            c &= 0x7F;
+            if (((w->frame & 0x0F) >= WS_CLOSE) && (c > sizeof(w->control))) {
+                return !attoHTTPWebSocketClose(ws, 1002);
+            }
+            w->left = 0;
+            if (c == 126) {
+                w->count = 2;
+                w->state = _attoHTTPWS_EXTLEN;
+            } else if (c == 127) {
+                w->count = 8;
+                w->state = _attoHTTPWS_EXTLEN;
+            } else {
+                w->left = c;
+                w->count = 4;
+                w->state = _attoHTTPWS_MASK;
+            }
+            break;
+        case _attoHTTPWS_EXTLEN:
+            if ((w->count > 4) && (c != 0)) {
+                // Nothing that needs more than 32 bits will fit anyway
+                return !attoHTTPWebSocketClose(ws, 1009);
+            }
+            w->left = (w->left << 8) | c;
+            w->count--;
+            if (w->count == 0) {
+                w->count = 4;
+                w->state = _attoHTTPWS_MASK;
+            }
+            break;
+        case _attoHTTPWS_MASK:
+            w->mask[4 - w->count] = c;
+            w->count--;
+            if (w->count == 0) {
+                if (((w->frame & 0x0F) < WS_CLOSE) && (w->left > (uint32_t)(ATTOHTTP_WEBSOCKET_BUFFER_SIZE - w->fill))) {
+                    return !attoHTTPWebSocketClose(ws, 1009);
+                }
+                w->size = w->left;
+                w->state = _attoHTTPWS_PAYLOAD;
+            }
+            break;
     }
-    if (_attoHTTP_headersSent == 0) {
-#if defined(ATTOHTTP_BASIC_AUTH)
-        chars += attoHTTPprintf("WWW-Authenticate: Basic realm=\"%s\"" HTTPEOL, ATTOHTTP_AUTH_REALM);
+    return 1;
+}
+/**
+ * @brief Deals with a WebSocket frame once all of its payload is in
+ *
+ * Pings get a pong back, and a close gets a close back.  The last fragment of
+ * a data message gets the message sent to the callback.
+ *
+ * @param ws The WebSocket handle
+ *
+ * @return 1 if the connection is still open, -1 otherwise
+ */
+static int8_t
+_attoHTTPWebSocketFrame(int8_t ws)
+{
+    attoHTTPWebSocket_t *w = &_attoHTTPWebSockets[ws];
+    wsopcode_t opcode = (wsopcode_t)(w->frame & 0x0F);
+    uint8_t *data = w->buffer;
+    uint16_t len;
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    int8_t ret;
 #endif
-#if defined(ATTOHTTP_DIGEST_AUTH)
-        chars += attoHTTPprintf("WWW-Authenticate: Digest realm=\"%s\",", ATTOHTTP_AUTH_REALM);
-        chars += attoHTTPprintf("qop=\"auth,auth-int\",");
-        chars += attoHTTPprintf("nonce=\"%s\",", ATTOHTTP_AUTH_REALM);
-        chars += attoHTTPprintf("opaque=\"%s\"" HTTPEOL, ATTOHTTP_AUTH_REALM);
+    w->state = _attoHTTPWS_HEADER;
+    switch (opcode) {
+        case WS_PING:
+            attoHTTPWebSocketSend(ws, WS_PONG, w->control, w->size);
+            break;
+        case WS_PONG:
+            break;
+        case WS_CLOSE:
+            // Send the status code back, the way RFC 6455 asks
+            attoHTTPWebSocketClose(ws, (w->size >= 2) ? ((w->control[0] << 8) | w->control[1]) : 0);
+            break;
+        default:
+            if (opcode != WS_CONTINUATION) {
+                w->opcode = opcode;
+            }
+            if ((w->frame & 0x80) != 0) {
+                opcode = (wsopcode_t)w->opcode;
+                len = w->fill;
+                w->opcode = 0;
+                w->fill = 0;
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+                if (w->compressed) {
+                    data = _attoHTTPInflateOut;
+                    ret = _attoHTTPInflate(w->buffer, len, data, sizeof(_attoHTTPInflateOut), &len);
+                    if (ret != 0) {
+                        attoHTTPWebSocketClose(ws, (ret == -2) ? 1009 : 1007);
+                        return -1;
+                    }
+                }
 #endif
-        if (headers != NULL) {
-            chars += attoHTTPprint(headers);
-        }
-        chars += attoHTTPprint(HTTPEOL);
-        _attoHTTP_headersSent = 1;
-        chars += attoHTTPprint(ATTOHTTP_AUTH_ERROR_MSG);
+                if (w->callback != NULL) {
+                    w->callback(ws, opcode, data, len);
+                }
+            }
+            break;
     }
-    return chars;
+    return (w->write != NULL) ? 1 : -1;
 }
+#endif
 /***************************************************************************
  * @endcond
  ***************************************************************************/
@@ -810,8 +3978,11 @@ attoHTTPprint(const char *buffer)
  *  - 202 Accepted
  *  - 400 Bad Request
  *  - 404 Not Fount
+ *  - 408 Request Timeout
+ *  - 429 Too Many Requests
  *  - 500 Internal Error
  *  - 501 Not Implemented
+ *  - 503 Service Unavailable
  *
  * Anything else returns: 500 Internal Error
  *
@@ -823,10 +3994,16 @@ uint16_t
 attoHTTPFirstLine(uint16_t code)
 {
     char *str = 0;
+    char *version = HTTP_VERSION;
     uint16_t chars = 0;
     if (_attoHTTP_firstlineSent == 0) {
         _attoHTTP_firstlineSent = 1;
         switch (code) {
+            case 101:
+                // There is no upgrading in HTTP/1.0
+                str = "Switching Protocols";
+                version = HTTP_VERSION_1_1;
+                break;
             case 200:
                 str = "OK";
                 break;
@@ -842,19 +4019,290 @@ attoHTTPFirstLine(uint16_t code)
             case 404:
                 str = "Not Found";
                 break;
+            case 408:
+                str = "Request Timeout";
+                break;
+            case 429:
+                str = "Too Many Requests";
+                break;
             case 501:
                 str = "Not Implemented";
                 break;
+            case 503:
+                str = "Service Unavailable";
+                break;
             default:
                 str = "Internal Error";
                 code = 500;
                 _attoHTTP_returnCode = STATUS_INTERNAL_ERROR;
                 break;
         }
-        chars += attoHTTPprintf(HTTP_VERSION " %d %s" HTTPEOL, code, str);
+        chars += attoHTTPprintf("%s %d %s" HTTPEOL, version, code, str);
+    }
+    return chars;
+}
+/**
+ * @brief Turns a connection away without reading anything from it
+ *
+ * The whole response is a constant, so this costs one write.  It is meant
+ * to be called by the wrapper right after accept(), in place of
+ * attoHTTPExecute(), and then the connection should be closed.  These are
+ * the codes that can be sent:
+ *  - 408 Request Timeout, for a client that took too long to send its request
+ *  - 429 Too Many Requests, with a Retry-After of ATTOHTTP_RATE_RETRY_AFTER
+ *  - 503 Service Unavailable, with a Retry-After of ATTOHTTP_SHED_RETRY_AFTER
+ *
+ * @param write The first argument for attoHTTPSetByte.
+ * @param code  The return code to send
+ *
+ * @return The code that was sent, or STATUS_RUNKNOWN if nothing was sent
+ */
+returncode_t
+attoHTTPReject(void *write, returncode_t code)
+{
+    switch (code) {
+        case STATUS_REQUEST_TIMEOUT:
+            _attoHTTPWriteBlock(write, _attoHTTPReject408, sizeof(_attoHTTPReject408) - 1);
+            break;
+        case STATUS_TOO_MANY_REQUESTS:
+            _attoHTTPWriteBlock(write, _attoHTTPReject429, sizeof(_attoHTTPReject429) - 1);
+            break;
+        case STATUS_SERVICE_UNAVAILABLE:
+            _attoHTTPWriteBlock(write, _attoHTTPReject503, sizeof(_attoHTTPReject503) - 1);
+            break;
+        default:
+            code = STATUS_RUNKNOWN;
+            break;
+    }
+    return code;
+}
+#ifdef ATTOHTTP_LOAD_SHED
+/**
+ * @brief Checks if there is too much going on to serve a new connection
+ *
+ * The connections that are in flight are the server sent events and
+ * WebSocket connections being held open, the ones in line to be served
+ * with attoHTTPQueueAdd(), the ones the wrapper is holding until their
+ * request line comes in, plus the ones waiting to be accepted.  If there
+ * are ATTOHTTP_SHED_CONNECTIONS of those, or
+ * ATTOHTTP_SHED_QUEUE are waiting, the new connection should be sent
+ * STATUS_SERVICE_UNAVAILABLE with attoHTTPReject(), without reading the
+ * request.  Turning clients away quickly drains the queue faster than
+ * serving them, so the ones that do get served don't time out waiting.
+ *
+ * @param queued The connections waiting to be accepted, not counting the
+ *               one that was just accepted.  0 if it can't be found out.
+ * @param held   The connections that have been accepted but not put in
+ *               line with attoHTTPQueueAdd() yet, not counting the one that
+ *               was just accepted
+ *
+ * @return 1 if the new connection should be turned away, 0 otherwise
+ */
+uint8_t
+attoHTTPOverloaded(uint16_t queued, uint16_t held)
+{
+    uint16_t inflight = attoHTTPSSECount();
+#ifdef ATTOHTTP_WEBSOCKET
+    inflight += attoHTTPWebSocketCount();
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    inflight += attoHTTPQueueCount();
+#endif
+    inflight += queued + held;
+    return (queued >= ATTOHTTP_SHED_QUEUE) || (inflight >= ATTOHTTP_SHED_CONNECTIONS);
+}
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+/**
+ * @brief Finds out what kind of request this is, from its request line
+ *
+ * This is meant for a wrapper that peeks at what a client has sent so far,
+ * before attoHTTPExecute() reads it.  Only the method and URL are looked at,
+ * and they are matched against the routes the same way attoHTTPExecute()
+ * will match them.  The headers are never looked at.
+ *
+ * @param line What the client has sent so far
+ * @param len  The number of bytes in line
+ *
+ * @return The class of the request, or REQUEST_PENDING if the URL isn't all
+ *         there yet
+ */
+requestclass_t
+attoHTTPClassify(const uint8_t *line, uint16_t len)
+{
+    uint8_t url[ATTOHTTP_URL_BUFFER_SIZE];
+    attoHTTPPage_t *page;
+    uint16_t ulen = 0;
+    uint16_t i = 0;
+#ifdef ATTOHTTP_WEBSOCKET
+    uint8_t j;
+#endif
+    while ((i < len) && isspace(line[i])) {
+        i++;
+    }
+    while ((i < len) && !isspace(line[i])) {
+        i++;
+    }
+    while ((i < len) && isblank(line[i])) {
+        i++;
+    }
+    if (i >= len) {
+        return REQUEST_PENDING;
+    }
+    while ((i < len) && !isspace(line[i]) && (ulen < (sizeof(url) - 1))) {
+        // The parameters end the route, like in _attoHTTPParseURL()
+        url[ulen] = (line[i] == '?') ? 0 : line[i];
+        ulen++;
+        i++;
+    }
+    if ((i >= len) && (ulen < (sizeof(url) - 1))) {
+        return REQUEST_PENDING;
+    }
+    url[ulen] = 0;
+#ifdef ATTOHTTP_WEBSOCKET
+    for (j = 0; j < ATTOHTTP_WEBSOCKET_ROUTES; j++) {
+        if ((_attoHTTPWebSocketRoutes[j].callback != NULL)
+            && (strncmp((char *)url, _attoHTTPWebSocketRoutes[j].url, sizeof(_attoHTTPWebSocketRoutes[j].url)) == 0)) {
+            return REQUEST_API;
+        }
+    }
+#endif
+    page = _attoHTTPMatchPage(url, ulen);
+    if (page != NULL) {
+        return (page->type == TEXT_EVENTSTREAM) ? REQUEST_API : REQUEST_STATIC;
+    }
+    return (_attoHTTPDefaultCallback != NULL) ? REQUEST_API : REQUEST_STATIC;
+}
+/**
+ * @brief Puts a connection in line to be served
+ *
+ * Each class has its own line, ATTOHTTP_REQUEST_QUEUE_API or
+ * ATTOHTTP_REQUEST_QUEUE_STATIC long.  If the line is full the connection
+ * should be turned away, for example with attoHTTPReject() and
+ * STATUS_SERVICE_UNAVAILABLE.
+ *
+ * @param conn   The connection.  attoHTTPQueueNext() gives this back.
+ * @param rclass The class from attoHTTPClassify()
+ *
+ * @return 1 if the connection is in line, 0 if there is no room for it
+ */
+uint8_t
+attoHTTPQueueAdd(void *conn, requestclass_t rclass)
+{
+    uint8_t slot;
+    if ((conn == NULL) || (rclass < 0) || (rclass >= ATTOHTTP_REQUEST_CLASSES)
+        || (_attoHTTPQueueLen[rclass] >= _attoHTTPQueueSize[rclass])) {
+        return 0;
+    }
+    slot = (_attoHTTPQueueHead[rclass] + _attoHTTPQueueLen[rclass]) % _attoHTTPQueueSize[rclass];
+    _attoHTTPQueue[_attoHTTPQueueStart[rclass] + slot] = conn;
+    _attoHTTPQueueLen[rclass]++;
+    return 1;
+}
+/**
+ * @brief Takes the next connection that should be served out of line
+ *
+ * API requests always go first, except that a static request gets served
+ * after ATTOHTTP_REQUEST_QUEUE_STREAK API requests in a row have gone
+ * ahead of it.  Each class is served in the order it came in.
+ *
+ * @return The connection, or NULL if there are none waiting
+ */
+void *
+attoHTTPQueueNext(void)
+{
+    requestclass_t rclass = REQUEST_API;
+    void *conn;
+    if ((_attoHTTPQueueLen[REQUEST_API] == 0)
+        || ((_attoHTTPQueueLen[REQUEST_STATIC] > 0) && (_attoHTTPQueueStreak >= ATTOHTTP_REQUEST_QUEUE_STREAK))) {
+        rclass = REQUEST_STATIC;
+    }
+    if (_attoHTTPQueueLen[rclass] == 0) {
+        return NULL;
+    }
+    if ((rclass == REQUEST_API) && (_attoHTTPQueueLen[REQUEST_STATIC] > 0)) {
+        _attoHTTPQueueStreak++;
+    } else {
+        _attoHTTPQueueStreak = 0;
+    }
+    conn = _attoHTTPQueue[_attoHTTPQueueStart[rclass] + _attoHTTPQueueHead[rclass]];
+    _attoHTTPQueueHead[rclass] = (_attoHTTPQueueHead[rclass] + 1) % _attoHTTPQueueSize[rclass];
+    _attoHTTPQueueLen[rclass]--;
+    return conn;
+}
+/**
+ * @brief Gets the number of connections waiting to be served
+ *
+ * @return The number of connections in line
+ */
+uint8_t
+attoHTTPQueueCount(void)
+{
+    return _attoHTTPQueueLen[REQUEST_API] + _attoHTTPQueueLen[REQUEST_STATIC];
+}
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+/**
+ * @brief Checks if a new connection from a peer can be served
+ *
+ * Each peer has a bucket that holds ATTOHTTP_RATE_BURST requests, and
+ * refills at ATTOHTTP_RATE_PER_SEC.  A connection is let in if there is a
+ * request left in the bucket and the peer has fewer than
+ * ATTOHTTP_RATE_CONNECTIONS connections open.  Every connection that is let
+ * in must be given back with attoHTTPPeerClose() when it is closed.  If the
+ * peer is turned away, attoHTTPReject() should be sent
+ * STATUS_TOO_MANY_REQUESTS.
+ *
+ * Peers are turned away if there is no room to keep track of them, which
+ * only happens when the slots they hash to all have connections open.
+ *
+ * @param peer The peer address, for example the IPv4 address from accept()
+ * @param now  The time in ms.  It only has to count up.
+ *
+ * @return 1 if the connection can be served, 0 otherwise
+ */
+uint8_t
+attoHTTPPeerOpen(uint32_t peer, uint32_t now)
+{
+    attoHTTPPeer_t *p = _attoHTTPPeerFind(peer, now, 1);
+    uint32_t elapsed;
+    if (p == NULL) {
+        return 0;
+    }
+    elapsed = now - p->stamp;
+    p->stamp = now;
+    if (elapsed >= (_attoHTTPRATE_FULL / ATTOHTTP_RATE_PER_SEC)) {
+        p->tokens = _attoHTTPRATE_FULL;
+    } else {
+        p->tokens += elapsed * ATTOHTTP_RATE_PER_SEC;
+        if (p->tokens > _attoHTTPRATE_FULL) {
+            p->tokens = _attoHTTPRATE_FULL;
+        }
+    }
+    if ((p->conns >= ATTOHTTP_RATE_CONNECTIONS) || (p->tokens < _attoHTTPRATE_TOKEN)) {
+        return 0;
+    }
+    p->tokens -= _attoHTTPRATE_TOKEN;
+    p->conns++;
+    p->used = ++_attoHTTPPeerUses;
+    return 1;
+}
+/**
+ * @brief Gives back a connection that attoHTTPPeerOpen() let in
+ *
+ * @param peer The peer address
+ *
+ * @return None
+ */
+void
+attoHTTPPeerClose(uint32_t peer)
+{
+    attoHTTPPeer_t *p = _attoHTTPPeerFind(peer, 0, 0);
+    if ((p != NULL) && (p->conns > 0)) {
+        p->conns--;
     }
-    return chars;
 }
+#endif
 /**
  * @brief This retrieves the next parameter in a JSON string
  *
@@ -961,69 +4409,623 @@ attoHTTPParseJSONParam(char *name, uint8_t name_len, char *value, uint8_t value_
         } else {
             break;
         }
-    } while ((value_len > 0) && ret);
-    // Make sure there is a trailing \0
-    *value= 0;
-    *name = 0;
-    if ((divider == 0) && (n != name)) {
-        strncpy(v, n, vl);
-        snprintf(n, nl, "%d", _attoHTTPParseJSONParam_counter++);
-        name_len = 0;
+    } while ((value_len > 0) && ret);
+    // Make sure there is a trailing \0
+    *value= 0;
+    *name = 0;
+    if ((divider == 0) && (n != name)) {
+        strncpy(v, n, vl);
+        snprintf(n, nl, "%d", _attoHTTPParseJSONParam_counter++);
+        name_len = 0;
+    }
+    return name_len == 0;
+
+}
+/**
+ * @brief This adds a page to the buffer at the given URL
+ *
+ * @param Callback The callback function to use.
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPDefaultREST(attoHTTPDefAPICallback Callback)
+{
+    uint8_t ret = 0;
+    if (_attoHTTPDefaultCallback == NULL) {
+        _attoHTTPDefaultCallback = Callback;
+        ret = 1;
+    }
+    return ret;
+}
+/**
+ * @brief Writes out an event
+ *
+ * @param write The first argument for attoHTTPSetByte.
+ * @param last  The id to put on the event, or 0 to leave it off
+ * @param event The event name
+ * @param elen  The length of the event name.  0 leaves it out.
+ * @param data  The event data
+ * @param dlen  The length of the data.  0 leaves it out.
+ *
+ * @return The number of bytes written
+ */
+static uint16_t
+_attoHTTPSendEvent(void *write, uint32_t last, char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    char *estr = "event:";
+    char *dstr = "data:";
+    char id[16];
+    uint16_t ret = 0;
+    uint8_t i, idlen;
+    idlen = _attoHTTPSSEIDLine(id, last);
+    for (i = 0; i < idlen; i++) {
+        ret += attoHTTPSetByte(write, id[i]);
+    }
+    if (elen > 0) {
+        for (i = 0; i < strlen(estr); i++) {
+            ret += attoHTTPSetByte(write, estr[i]);
+        }
+        while (elen-- > 0) {
+            ret += attoHTTPSetByte(write, *event++);
+        }
+        ret += attoHTTPSetByte(write, '\n');
+    }
+    if (dlen > 0) {
+        for (i = 0; i < strlen(dstr); i++) {
+            ret += attoHTTPSetByte(write, dstr[i]);
+        }
+        while (dlen-- > 0) {
+            ret += attoHTTPSetByte(write, *data++);
+        }
+        ret += attoHTTPSetByte(write, '\n');
+    }
+    ret += attoHTTPSetByte(write, '\n');
+    return ret;
+}
+/**
+ * @brief This sends out an event
+ *
+ * The event has no id, since there is no way to know which events the
+ * connection has got.  The client keeps the last id it saw.
+ *
+ * @param *write The first argument for attoHTTPSetByte.
+ *
+ * @return The number of bytes written
+ */
+uint16_t
+attoHTTPSendEvent(void *write, char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    return _attoHTTPSendEvent(write, 0, event, elen, data, dlen);
+}
+/**
+ * @brief Adds a connection to the server sent events subscribers
+ *
+ * The wrapper calls this when attoHTTPExecute() returns STATUS_SERVERSENTEVENTS.
+ * It must then leave the connection open.  write has to stay valid until the
+ * close callback is called, so it can't point at anything on the stack.
+ *
+ * The subscriber gets the stream that the request was for.  If that request
+ * had a Last-Event-ID header, the events the client missed are sent on the
+ * next flush, as long as they are still in the ring buffer.
+ *
+ * @param write The first argument for attoHTTPSetByte.
+ * @param close The function to close the connection.  This can be NULL.
+ *
+ * @return The subscriber handle, or -1 if there is no room or no such stream
+ */
+int8_t
+attoHTTPSSEAdd(void *write, attoHTTPSSECloseCallback close)
+{
+    int8_t i;
+    if ((write == NULL) || (_attoHTTP_sseStream < 0) || (_attoHTTP_sseStream >= ATTOHTTP_SSE_STREAMS)) {
+        return -1;
+    }
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        if (_attoHTTPSSESubscribers[i].write == NULL) {
+            _attoHTTPSSESubscribers[i].write = write;
+            _attoHTTPSSESubscribers[i].close = close;
+            _attoHTTPSSESubscribers[i].last = _attoHTTPSSETime();
+            _attoHTTPSSESubscribers[i].beat = 0;
+            _attoHTTPSSESubscribers[i].stream = _attoHTTP_sseStream;
+            _attoHTTPSSEReplayStart(&_attoHTTPSSESubscribers[i]);
+            if (_attoHTTPSSESubscribeCallback != NULL) {
+                _attoHTTPSSESubscribeCallback(i);
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+/**
+ * @brief Removes a server sent events subscriber and closes its connection
+ *
+ * @param sub The subscriber handle
+ *
+ * @return 1 if the subscriber was removed, 0 if it didn't exist
+ */
+uint8_t
+attoHTTPSSERemove(int8_t sub)
+{
+    attoHTTPSSESubscriber_t *s;
+    void *write;
+    if ((sub < 0) || (sub >= ATTOHTTP_SSE_SUBSCRIBERS)) {
+        return 0;
+    }
+    s = &_attoHTTPSSESubscribers[sub];
+    if (s->write == NULL) {
+        return 0;
+    }
+    write = s->write;
+    // Free the slot first so the close callback can add a new subscriber
+    s->write = NULL;
+    if (s->close != NULL) {
+        s->close(write);
+    }
+    s->close = NULL;
+    return 1;
+}
+/**
+ * @brief Gets the number of server sent events subscribers
+ *
+ * @return The number of subscribers
+ */
+uint8_t
+attoHTTPSSECount(void)
+{
+    uint8_t i;
+    uint8_t ret = 0;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        if (_attoHTTPSSESubscribers[i].write != NULL) {
+            ret++;
+        }
+    }
+    return ret;
+}
+/**
+ * @brief Sets the function that is called when a subscriber is added
+ *
+ * This is the place to send the first events to a new subscriber.
+ *
+ * @param callback The function to call.  NULL turns it off.
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPSSESetSubscribeCallback(attoHTTPSSESubscribeCallback callback)
+{
+    _attoHTTPSSESubscribeCallback = callback;
+    return 1;
+}
+/**
+ * @brief Sends an event to one subscriber
+ *
+ * Anything from the event ring buffer that the subscriber doesn't have yet
+ * goes out first.  If that can't all be sent, this event isn't sent either.
+ * If the whole event can't be written the subscriber is removed.
+ *
+ * The event carries the id of the last event the subscriber got out of the
+ * ring, so it can pick up from there with Last-Event-ID.
+ *
+ * @param sub   The subscriber handle
+ * @param event The event name
+ * @param elen  The length of the event name.  0 leaves it out.
+ * @param data  The event data
+ * @param dlen  The length of the data.  0 leaves it out.
+ *
+ * @return The number of bytes written, 0 on failure
+ */
+uint16_t
+attoHTTPSSESend(int8_t sub, char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    uint16_t ret;
+    uint32_t last;
+    char id[16];
+    if ((sub < 0) || (sub >= ATTOHTTP_SSE_SUBSCRIBERS) || !_attoHTTPSSEFlushOne(sub)) {
+        return 0;
+    }
+    // The subscriber has everything, so it is up to the last event published
+    last = (_attoHTTPSSESubscribers[sub].event == _attoHTTPSSENextID()) ? _attoHTTPSSELastID : 0;
+    ret = _attoHTTPSendEvent(_attoHTTPSSESubscribers[sub].write, last, event, elen, data, dlen);
+    if (ret != (_attoHTTPSSEIDLine(id, last) + _attoHTTPSSEEventLength(elen, dlen))) {
+        attoHTTPSSERemove(sub);
+        ret = 0;
+    }
+    return ret;
+}
+/**
+ * @brief Puts an event in the ring buffer for every subscriber
+ *
+ * This publishes to every stream.  See attoHTTPSSEPublishStream().
+ *
+ * @param event The event name
+ * @param elen  The length of the event name.  0 leaves it out.
+ * @param data  The event data
+ * @param dlen  The length of the data.  0 leaves it out.
+ *
+ * @return 1 on success, 0 if the event is too big for the ring buffer
+ */
+uint8_t
+attoHTTPSSEPublish(char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    return attoHTTPSSEPublishStream(SSE_ALL_STREAMS, event, elen, data, dlen);
+}
+/**
+ * @brief Puts an event in the ring buffer for the subscribers of a stream
+ *
+ * The event is only serialized once, with the next event id in front of it.
+ * Nothing is sent until attoHTTPSSEFlush() is called, or attoHTTPSSEPoll()
+ * sees that the first waiting event has been there for ATTOHTTP_SSE_FLUSH_WINDOW
+ * ms.  That way events that come in close together go out in one write.
+ *
+ * A subscriber that is so far behind that this event would write over data
+ * it hasn't got yet is flushed.  If it still can't keep up, events are skipped
+ * if the policy allows it, and otherwise it is removed.  After that any
+ * subscriber over the high water mark gets the policy applied to it.
+ *
+ * @param stream The stream to publish to, or SSE_ALL_STREAMS
+ * @param event  The event name
+ * @param elen   The length of the event name.  0 leaves it out.
+ * @param data   The event data
+ * @param dlen   The length of the data.  0 leaves it out.
+ *
+ * @return 1 on success, 0 if the event is too big for the ring buffer
+ */
+uint8_t
+attoHTTPSSEPublishStream(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    int8_t i;
+    char id[16];
+    uint32_t next = _attoHTTPSSENextID();
+    uint32_t prev;
+    uint32_t len;
+    uint8_t idlen;
+    attoHTTPSSEHistory_t *h;
+    if ((stream < SSE_ALL_STREAMS) || (stream >= ATTOHTTP_SSE_STREAMS)) {
+        return 0;
+    }
+    idlen = _attoHTTPSSEIDLine(id, next);
+    len = idlen + _attoHTTPSSEEventLength(elen, dlen);
+    if (len > ATTOHTTP_SSE_RING_SIZE) {
+        return 0;
+    }
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        if ((_attoHTTPSSESubscribers[i].write != NULL)
+            && _attoHTTPSSEBehind(&_attoHTTPSSESubscribers[i], ATTOHTTP_SSE_RING_SIZE - len, 1)) {
+            _attoHTTPSSEFlushOne(i);
+            _attoHTTPSSEShed(i, len);
+        }
+    }
+    if (elen > 0) {
+        // Mark the last event with this name, if it is still around
+        for (prev = _attoHTTPSSELastID; (prev != 0) && ((next - prev) < ATTOHTTP_SSE_HISTORY); prev--) {
+            h = _attoHTTPSSEEvent(prev);
+            if ((h->id != prev) || ((_attoHTTPSSEHead - h->start) > ATTOHTTP_SSE_RING_SIZE)) {
+                break;
+            }
+            if ((h->stream == stream) && (h->elen == elen)
+                && _attoHTTPSSERingMatch(h->start + h->name, (uint8_t *)event, elen)) {
+                h->superseded = 1;
+                break;
+            }
+        }
+    }
+    _attoHTTPSSELastID = next;
+    h = _attoHTTPSSEEvent(next);
+    h->id = next;
+    h->start = _attoHTTPSSEHead;
+    h->elen = elen;
+    h->name = idlen + 6;
+    h->superseded = 0;
+    h->stream = stream;
+    _attoHTTPSSERingPut((uint8_t *)id, idlen);
+    if (elen > 0) {
+        _attoHTTPSSERingPut((uint8_t *)"event:", 6);
+        _attoHTTPSSERingPut((uint8_t *)event, elen);
+        _attoHTTPSSERingPut((uint8_t *)"\n", 1);
+    }
+    if (dlen > 0) {
+        _attoHTTPSSERingPut((uint8_t *)"data:", 5);
+        _attoHTTPSSERingPut((uint8_t *)data, dlen);
+        _attoHTTPSSERingPut((uint8_t *)"\n", 1);
+    }
+    _attoHTTPSSERingPut((uint8_t *)"\n", 1);
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        _attoHTTPSSEShed(i, 0);
+    }
+    if (!_attoHTTPSSEBatch) {
+        _attoHTTPSSEBatch = 1;
+        _attoHTTPSSEBatchStart = _attoHTTPSSETime();
+    }
+    return 1;
+}
+/**
+ * @brief Sends out everything in the ring buffer to every subscriber
+ *
+ * Subscribers that can't be written to are removed.
+ *
+ * @return The number of subscribers that have everything
+ */
+uint8_t
+attoHTTPSSEFlush(void)
+{
+    int8_t i;
+    uint8_t ret = 0;
+    _attoHTTPSSEBatch = 0;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        ret += _attoHTTPSSEFlushOne(i);
+    }
+    return ret;
+}
+/**
+ * @brief Gets the number of bytes in the ring that a subscriber doesn't have
+ *
+ * @param sub The subscriber handle
+ *
+ * @return The number of bytes waiting to be sent
+ */
+uint16_t
+attoHTTPSSEPending(int8_t sub)
+{
+    if ((sub < 0) || (sub >= ATTOHTTP_SSE_SUBSCRIBERS) || (_attoHTTPSSESubscribers[sub].write == NULL)) {
+        return 0;
+    }
+    return _attoHTTPSSEPending(&_attoHTTPSSESubscribers[sub]);
+}
+/**
+ * @brief Gets the id of the last event that was published
+ *
+ * @return The event id, 0 if nothing has been published
+ */
+uint32_t
+attoHTTPSSELastID(void)
+{
+    return _attoHTTPSSELastID;
+}
+/**
+ * @brief Sets the reconnect time that is sent to new subscribers
+ *
+ * This is sent as a retry: field right after the headers.  It tells the
+ * browser how long to wait before it tries to connect again.
+ *
+ * @param retry The time in ms.  0 doesn't send it.
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPSSESetRetry(uint32_t retry)
+{
+    _attoHTTPSSERetry = retry;
+    return 1;
+}
+/**
+ * @brief Sets what happens to subscribers of a stream that fall behind
+ *
+ * Once a subscriber has more than highwater bytes waiting to go out to it,
+ * policy is used on it.  See ssepolicy_t.
+ *
+ * This needs ATTOHTTP_BULK_WRITE.  attoHTTPSetByte() returns 0 for an error,
+ * so it has no way to say a connection is full, and has to wait for each byte
+ * to go out.  That means one slow subscriber holds up the whole server.
+ * Without ATTOHTTP_BULK_WRITE this does nothing and returns 0, so a server
+ * that has to keep going with slow subscribers should check for that.
+ *
+ * @param stream    The stream, or SSE_ALL_STREAMS for all of them
+ * @param policy    The policy to use
+ * @param highwater The high water mark in bytes.  This can't be more than
+ *                  ATTOHTTP_SSE_RING_SIZE.
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPSSESetPolicy(int8_t stream, ssepolicy_t policy, uint16_t highwater)
+{
+#ifdef ATTOHTTP_BULK_WRITE
+    int8_t i;
+    if ((highwater == 0) || (highwater > ATTOHTTP_SSE_RING_SIZE)
+        || (stream < SSE_ALL_STREAMS) || (stream >= ATTOHTTP_SSE_STREAMS)) {
+        return 0;
+    }
+    for (i = 0; i < ATTOHTTP_SSE_STREAMS; i++) {
+        if ((stream == SSE_ALL_STREAMS) || (stream == i)) {
+            _attoHTTPSSEStreams[i].policy = policy;
+            _attoHTTPSSEStreams[i].highwater = highwater;
+        }
+    }
+    return 1;
+#else
+    // attoHTTPSetByte() can't say a connection is full, so there is nothing to apply this to
+    return 0;
+#endif
+}
+/**
+ * @brief Does the timed work for server sent events
+ *
+ * This should be called often, with a clock that counts up in ms.  It publishes
+ * anything in the queue if ATTOHTTP_SSE_QUEUE is set, flushes
+ * published events once the flush window is up, and keeps flushing to
+ * subscribers that couldn't take everything last time.  Subscribers that
+ * haven't been sent anything for ATTOHTTP_SSE_HEARTBEAT ms get a comment
+ * line, so that proxies and the browser don't give up on the connection.
+ *
+ * The flush window and the heartbeat are timed from when things were
+ * published and sent.  Without attoHTTPSSESetClock() that is the time from
+ * the last call to this, so they can come up to one poll late.
+ *
+ * @param now The time in ms.  It is fine for this to wrap around.
+ *
+ * @return The number of subscribers that have everything
+ */
+uint8_t
+attoHTTPSSEPoll(uint32_t now)
+{
+    int8_t i;
+    uint8_t ret = 0;
+    attoHTTPSSESubscriber_t *s;
+    _attoHTTPSSENow = now;
+#ifdef ATTOHTTP_SSE_QUEUE
+    attoHTTPSSEDrain();
+#endif
+    // Signed, since the clock can be a little ahead of now
+    if (_attoHTTPSSEBatch && ((int32_t)(now - _attoHTTPSSEBatchStart) < ATTOHTTP_SSE_FLUSH_WINDOW)) {
+        return 0;
+    }
+    _attoHTTPSSEBatch = 0;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        s = &_attoHTTPSSESubscribers[i];
+#if ATTOHTTP_SSE_HEARTBEAT > 0
+        if ((s->write != NULL) && (s->beat == 0) && (s->event == _attoHTTPSSENextID())
+            && ((int32_t)(now - s->last) >= ATTOHTTP_SSE_HEARTBEAT)) {
+            s->beat = sizeof(_attoHTTPSSEHeartbeat) - 1;
+        }
+#endif
+        ret += _attoHTTPSSEFlushOne(i);
+    }
+    return ret;
+}
+/**
+ * @brief Sets the clock that server sent events are timed with
+ *
+ * With this set, events are stamped with the time they are published, and
+ * subscribers with the time they were last sent something, instead of the
+ * time from the last attoHTTPSSEPoll().
+ *
+ * @param clock The function to call.  It has to be the same clock that is
+ *              given to attoHTTPSSEPoll().  NULL turns it off.
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPSSESetClock(attoHTTPSSEClockCallback clock)
+{
+    _attoHTTPSSEClock = clock;
+    return 1;
+}
+#ifdef ATTOHTTP_SSE_QUEUE
+/**
+ * @brief Puts an event in the publish queue
+ *
+ * This is the only server sent events function that is safe to call from
+ * other threads or interrupts.  It copies the event into a free slot and
+ * returns without waiting on anything.  The event is published by
+ * attoHTTPSSEDrain() on the thread that runs the server.
+ *
+ * Producers claim slots with a compare and swap on the queue head, so a
+ * producer that gets interrupted part way through never holds up the others.
+ * Events from one producer are published in the order they were queued.
+ *
+ * @param stream The stream to publish to, or SSE_ALL_STREAMS
+ * @param event  The event name
+ * @param elen   The length of the event name.  0 leaves it out.
+ * @param data   The event data
+ * @param dlen   The length of the data.  0 leaves it out.
+ *
+ * @return 1 on success, 0 if the queue is full or the event is bigger than
+ *         ATTOHTTP_SSE_QUEUE_EVENT_SIZE
+ */
+uint8_t
+attoHTTPSSEQueue(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen)
+{
+    attoHTTPSSEQueueSlot_t *slot;
+    uint32_t pos;
+    uint32_t seq;
+    if (((uint32_t)elen + dlen) > ATTOHTTP_SSE_QUEUE_EVENT_SIZE) {
+        return 0;
+    }
+    pos = atomic_load_explicit(&_attoHTTPSSEQueueHead, memory_order_relaxed);
+    for (;;) {
+        slot = &_attoHTTPSSEQueueSlots[pos & (ATTOHTTP_SSE_QUEUE_SLOTS - 1)];
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(
+                &_attoHTTPSSEQueueHead, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed
+            )) {
+                break;
+            }
+        } else if ((int32_t)(seq - pos) < 0) {
+            // The slot still has the event from the last time around
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&_attoHTTPSSEQueueHead, memory_order_relaxed);
+        }
+    }
+    slot->stream = stream;
+    slot->elen = elen;
+    slot->dlen = dlen;
+    memcpy(slot->buf, event, elen);
+    memcpy(&slot->buf[elen], data, dlen);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 1;
+}
+/**
+ * @brief Publishes the events that are waiting in the queue
+ *
+ * This must only be called from the thread that runs the server.
+ * attoHTTPSSEPoll() calls it, so it normally doesn't need to be called
+ * directly.  It stops at the first slot that a producer hasn't finished
+ * filling, and never does more than one pass around the queue.
+ *
+ * @return The number of events taken out of the queue
+ */
+uint8_t
+attoHTTPSSEDrain(void)
+{
+    attoHTTPSSEQueueSlot_t *slot;
+    uint8_t count = 0;
+    while (count < ATTOHTTP_SSE_QUEUE_SLOTS) {
+        slot = &_attoHTTPSSEQueueSlots[_attoHTTPSSEQueueTail & (ATTOHTTP_SSE_QUEUE_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != (_attoHTTPSSEQueueTail + 1)) {
+            break;
+        }
+        attoHTTPSSEPublishStream(
+            slot->stream, (char *)slot->buf, slot->elen, (char *)&slot->buf[slot->elen], slot->dlen
+        );
+        atomic_store_explicit(&slot->seq, _attoHTTPSSEQueueTail + ATTOHTTP_SSE_QUEUE_SLOTS, memory_order_release);
+        _attoHTTPSSEQueueTail++;
+        count++;
     }
-    return name_len == 0;
-
+    return count;
 }
+#endif
 /**
- * @brief This adds a page to the buffer at the given URL
+ * @brief Sends an event to every subscriber
  *
- * @param Callback The callback function to use.
+ * This publishes the event to every stream and flushes it right away.
+ * Subscribers that can't be written to are removed.
  *
- * @return 1 on success, 0 on failure
+ * @param event The event name
+ * @param elen  The length of the event name.  0 leaves it out.
+ * @param data  The event data
+ * @param dlen  The length of the data.  0 leaves it out.
+ *
+ * @return The number of subscribers that have everything
  */
 uint8_t
-attoHTTPDefaultREST(attoHTTPDefAPICallback Callback)
+attoHTTPSSEBroadcast(char *event, uint16_t elen, char *data, uint16_t dlen)
 {
-    uint8_t ret = 0;
-    if (_attoHTTPDefaultCallback == NULL) {
-        _attoHTTPDefaultCallback = Callback;
-        ret = 1;
-    }
-    return ret;
+    return attoHTTPSSEBroadcastStream(SSE_ALL_STREAMS, event, elen, data, dlen);
 }
 /**
- * @brief This sends out an event
+ * @brief Sends an event to every subscriber of a stream
  *
- * @param *write The first argument for attoHTTPSetByte.
+ * This publishes the event and flushes it right away.  Subscribers that
+ * can't be written to are removed.
  *
- * @return 1 on success, 0 on failure
+ * @param stream The stream to send to, or SSE_ALL_STREAMS
+ * @param event  The event name
+ * @param elen   The length of the event name.  0 leaves it out.
+ * @param data   The event data
+ * @param dlen   The length of the data.  0 leaves it out.
+ *
+ * @return The number of subscribers that have everything
  */
-uint16_t
-attoHTTPSendEvent(void *write, char *event, uint16_t elen, char *data, uint16_t dlen)
+uint8_t
+attoHTTPSSEBroadcastStream(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen)
 {
-    char *estr = "event:";
-    char *dstr = "data:";
-    uint16_t ret = 0;
-    uint8_t i;
-    if (elen > 0) {
-        for (i = 0; i < strlen(estr); i++) {
-            ret += attoHTTPSetByte(write, estr[i]);
-        }
-        while (elen-- > 0) {
-            ret += attoHTTPSetByte(write, *event++);
-        }
-        ret += attoHTTPSetByte(write, '\n');
-    }
-    if (dlen > 0) {
-        for (i = 0; i < strlen(dstr); i++) {
-            ret += attoHTTPSetByte(write, dstr[i]);
-        }
-        while (dlen-- > 0) {
-            ret += attoHTTPSetByte(write, *data++);
-        }
-        ret += attoHTTPSetByte(write, '\n');
+    if (!attoHTTPSSEPublishStream(stream, event, elen, data, dlen)) {
+        return 0;
     }
-    ret += attoHTTPSetByte(write, '\n');
-    return ret;
+    return attoHTTPSSEFlush();
 }
 /**
  * @brief This retrieves the next parameter in a URL string
@@ -1042,6 +5044,9 @@ attoHTTPParseURLParam(char *name, uint8_t name_len, char *value, uint8_t value_l
     char decode[3];
     int8_t ret;
     uint16_t count = 0;
+    if (_attoHTTPMethod == METHOD_GET) {
+        return _attoHTTPNextURLParam(name, name_len, value, value_len);
+    }
     do {
         ret = _attoHTTPParseURLParamChar(&c);
         if ((ret > 0) && (c != 0)) {
@@ -1054,10 +5059,19 @@ attoHTTPParseURLParam(char *name, uint8_t name_len, char *value, uint8_t value_l
             } else {
                 // This decodes the URL
                 if (c == '%') {
-                    _attoHTTPParseURLParamChar(&decode[0]);
-                    _attoHTTPParseURLParamChar(&decode[1]);
+                    decode[0] = c;
+                    decode[1] = 0;
                     decode[2] = 0;
-                    c = strtol(decode, NULL, 16);
+                    _attoHTTPParseURLParamChar(&decode[1]);
+                    _attoHTTPParseURLParamChar(&decode[2]);
+                    if (_attoHTTPURLDecodeC((uint8_t *)decode, (uint8_t *)&decode[3], (uint8_t *)&c) == 0) {
+                        _attoHTTP_param_error = 1;
+                        ret = 0;
+                        name_len = 1;
+                        break;
+                    }
+                } else if (c == '+') {
+                    c = ' ';
                 }
                 if (name_len > 0) {
                     count++;
@@ -1078,6 +5092,108 @@ attoHTTPParseURLParam(char *name, uint8_t name_len, char *value, uint8_t value_l
     return name_len == 0;
 
 }
+/**
+ * @brief Decodes a URL encoded buffer
+ *
+ * This decodes %XX escapes and turns '+' into a space, in a single pass.  The
+ * output can be the same buffer as the input, since decoding never makes
+ * the string longer.  The output is always NULL terminated.
+ *
+ * @param input  The buffer to decode
+ * @param ilen   The length of the input buffer
+ * @param output The output buffer
+ * @param olen   The length of the output buffer
+ *
+ * @return The number of characters in output, or -1 if a % escape was bad
+ */
+int32_t
+attoHTTPURLDecode(const uint8_t *input, uint16_t ilen, uint8_t *output, uint16_t olen)
+{
+    const uint8_t *end = input + ilen;
+    uint16_t o = 0;
+    uint8_t used;
+    if (olen == 0) {
+        return 0;
+    }
+    while ((input < end) && (o < (olen - 1))) {
+        used = _attoHTTPURLDecodeC(input, end, &output[o]);
+        if (used == 0) {
+            output[o] = 0;
+            return -1;
+        }
+        input += used;
+        o++;
+    }
+    output[o] = 0;
+    return o;
+}
+/**
+ * @brief Says if a parameter could not be decoded
+ *
+ * Parameters with a bad % escape are left out of the URL parameter index,
+ * and stop attoHTTPParseParam() for url encoded bodies.
+ *
+ * @return 1 if a bad parameter was found in this request, 0 otherwise
+ */
+uint8_t
+attoHTTPParamError(void)
+{
+    return _attoHTTP_param_error;
+}
+/**
+ * @brief Returns the number of parameters in the URL
+ *
+ * @return The number of parameters, up to ATTOHTTP_URL_PARAMS
+ */
+uint8_t
+attoHTTPURLParamCount(void)
+{
+    if (!_attoHTTP_url_indexed) {
+        _attoHTTPIndexURLParams();
+    }
+    return _attoHTTP_url_param_count;
+}
+/**
+ * @brief Returns a URL parameter by its position in the URL
+ *
+ * Unlike attoHTTPParseParam() this does not use anything up, so the
+ * parameters can be looked at as many times as needed, in any order.
+ *
+ * @param index The position of the parameter, starting at 0
+ *
+ * @return A pointer to the parameter, or NULL if there is no such parameter
+ */
+const attoHTTPParam_t *
+attoHTTPURLParamIndex(uint8_t index)
+{
+    if (index >= attoHTTPURLParamCount()) {
+        return NULL;
+    }
+    return &_attoHTTP_url_param[index];
+}
+/**
+ * @brief Looks up a URL parameter by name
+ *
+ * If the same name is in the URL more than once, the first one is returned.
+ *
+ * @param name The name of the parameter, NULL terminated
+ *
+ * @return The decoded value, "" if the parameter has no value, or NULL if
+ *         the parameter is not in the URL
+ */
+const char *
+attoHTTPGetURLParam(const char *name)
+{
+    uint8_t i;
+    uint16_t len = strlen(name);
+    const attoHTTPParam_t *param = _attoHTTP_url_param;
+    for (i = attoHTTPURLParamCount(); i > 0; i--, param++) {
+        if ((param->name_len == len) && (memcmp(param->name, name, len) == 0)) {
+            return (param->value != NULL) ? param->value : "";
+        }
+    }
+    return NULL;
+}
 /**
  * @brief This retrieves the next parameter.
  *
@@ -1136,6 +5252,222 @@ attoHTTPGetRawParamChar(char *c)
 {
     return _attoHTTPReadC((uint8_t *)c);
 }
+/**
+ * @brief Reads a block of the request body
+ *
+ * This will not read past the Content-Length that the client sent, so it
+ * returns as soon as the last byte of the body is in.  If the client didn't
+ * send a Content-Length, it reads until the client stops sending.
+ *
+ * If ATTOHTTP_BULK_READ is set, attoHTTPGetBytes() is used to read the data,
+ * otherwise it is read a byte at a time with attoHTTPGetByte().
+ *
+ * @param buf The buffer to read into
+ * @param len The number of bytes to read
+ *
+ * @return The number of bytes read.  Less than len means the body is done.
+ */
+uint16_t
+attoHTTPReadBody(uint8_t *buf, uint16_t len)
+{
+    uint16_t count = 0;
+#ifdef ATTOHTTP_BULK_READ
+    int16_t ret;
+    uint32_t want;
+    if ((len > 0) && (_attoHTTP_extra_c > 0)) {
+        buf[count++] = _attoHTTP_extra_c;
+        _attoHTTP_extra_c = -1;
+    }
+    if (_attoHTTP_expectContinue) {
+        _attoHTTPSendContinue();
+    }
+    while ((count < len) && !_attoHTTPBodyDone()) {
+#ifdef ATTOHTTP_DEADLINE
+        if (_attoHTTPExpired()) {
+            break;
+        }
+#endif
+        want = len - count;
+        if ((_attoHTTP_bodylength - _attoHTTP_bodyread) < want) {
+            want = _attoHTTP_bodylength - _attoHTTP_bodyread;
+        }
+        ret = attoHTTPGetBytes(_attoHTTP_read, &buf[count], want);
+        if (ret <= 0) {
+            break;
+        }
+        count += ret;
+        _attoHTTP_bodyread += ret;
+    }
+#else
+    while ((count < len) && (_attoHTTPReadC(&buf[count]) > 0)) {
+        count++;
+    }
+#endif
+    return count;
+}
+/**
+ * @brief Returns how much of the request body has not been read yet
+ *
+ * @return The number of bytes left, or ATTOHTTP_LENGTH_UNKNOWN if the client
+ *         didn't send a Content-Length
+ */
+uint32_t
+attoHTTPBodyLeft(void)
+{
+    if (_attoHTTP_bodylength == ATTOHTTP_LENGTH_UNKNOWN) {
+        return ATTOHTTP_LENGTH_UNKNOWN;
+    }
+    return _attoHTTP_bodylength - _attoHTTP_bodyread + ((_attoHTTP_extra_c > 0) ? 1 : 0);
+}
+/**
+ * @brief Streams the request body to an upload handler in blocks
+ *
+ * This is meant for things like firmware images that need to be written to
+ * flash as they come in.  Every block but the last is exactly size bytes,
+ * so they line up with flash pages if size is a multiple of the page size.
+ * The next block isn't read until the handler returns, so the handler can
+ * finish erasing or writing before more data comes in.
+ *
+ * If the client sent "Expect: 100-continue" it is told to go ahead here.
+ *
+ * @param handler The function to give the blocks to
+ * @param block   The buffer to read blocks into.  This should be aligned
+ *                however the handler needs it to be.
+ * @param size    The size of the block buffer
+ *
+ * @return The number of bytes uploaded, or -1 if the handler stopped it or
+ *         the client sent less than its Content-Length
+ */
+int32_t
+attoHTTPUpload(attoHTTPUploadCallback handler, uint8_t *block, uint16_t size)
+{
+    uint32_t offset = 0;
+    uint16_t len;
+    uint8_t last;
+    if ((handler == NULL) || (block == NULL) || (size == 0)) {
+        return -1;
+    }
+    do {
+        len = attoHTTPReadBody(block, size);
+        last = (len < size) || (attoHTTPBodyLeft() == 0);
+        if (!handler(block, len, offset, last)) {
+            return -1;
+        }
+        offset += len;
+    } while (!last);
+    if ((_attoHTTP_bodylength != ATTOHTTP_LENGTH_UNKNOWN) && (offset != _attoHTTP_bodylength)) {
+        return -1;
+    }
+    return offset;
+}
+/**
+ * @brief Parses a multipart/form-data body
+ *
+ * The parts are handed to the callbacks as they come in.  The body of each
+ * part is given to the data callback in chunks, so parts can be any size.
+ * Only ATTOHTTP_MULTIPART_BUFFER_SIZE bytes of the body are kept at a time,
+ * which by default is twice the longest delimiter ATTOHTTP_BOUNDARY_SIZE
+ * allows.  Header values longer than ATTOHTTP_HEADER_VALUE_SIZE are cut off.
+ * A body with more than 32767 parts is not parsed past that.
+ *
+ * @param header The callback for part headers.  Can be NULL.
+ * @param data   The callback for part bodies.  Can be NULL.
+ *
+ * @return The number of parts, or -1 if the body is not valid multipart
+ *         data, has too many parts, or a callback stopped it
+ */
+int16_t
+attoHTTPParseMultipart(attoHTTPMultipartHeaderCallback header, attoHTTPMultipartDataCallback data)
+{
+    attoHTTPMultipartBuffer_t mp;
+    uint8_t delim[ATTOHTTP_BOUNDARY_SIZE + 4];
+    uint8_t line[ATTOHTTP_HEADER_NAME_SIZE + ATTOHTTP_HEADER_VALUE_SIZE];
+    uint8_t *value;
+    uint16_t dlen, len;
+    int32_t found;
+    int16_t parts = 0;
+    uint8_t c[2];
+
+    if ((_attoHTTP_contenttype != MULTIPART_FORMDATA) || (_attoHTTP_boundary[0] == 0)) {
+        return -1;
+    }
+    dlen = snprintf((char *)delim, sizeof(delim), "\r\n--%s", _attoHTTP_boundary);
+    // The first delimiter doesn't have a CRLF in front of it, so give it one.
+    mp.buffer[0] = '\r';
+    mp.buffer[1] = '\n';
+    mp.start = 0;
+    mp.fill = 2;
+    mp.eof = 0;
+    // Throw away anything before the first delimiter
+    for (;;) {
+        _attoHTTPMultipartFill(&mp);
+        found = _attoHTTPMultipartFind(&mp, delim, dlen);
+        if (found >= 0) {
+            mp.start += found + dlen;
+            break;
+        } else if (mp.eof) {
+            return -1;
+        }
+        mp.start = mp.fill - (dlen - 1);
+    }
+    for (;;) {
+        // "--" after the delimiter means that was the last part
+        if (!_attoHTTPMultipartGetC(&mp, &c[0]) || !_attoHTTPMultipartGetC(&mp, &c[1])) {
+            return -1;
+        }
+        if ((c[0] == '-') && (c[1] == '-')) {
+            return parts;
+        }
+        if (parts == INT16_MAX) {
+            return -1;
+        }
+        // Anything else up to the end of the line is padding
+        if ((c[1] != '\n') && (_attoHTTPMultipartLine(&mp, line, sizeof(line)) < 0)) {
+            return -1;
+        }
+        // The headers
+        for (;;) {
+            if (_attoHTTPMultipartLine(&mp, line, sizeof(line)) < 0) {
+                return -1;
+            }
+            if (line[0] == 0) {
+                break;
+            }
+            value = (uint8_t *)strchr((char *)line, ':');
+            if (value == NULL) {
+                continue;
+            }
+            *value++ = 0;
+            while (isblank(*value)) {
+                value++;
+            }
+            if ((header != NULL) && !header(parts, (char *)line, (char *)value)) {
+                return -1;
+            }
+        }
+        // The body
+        for (;;) {
+            _attoHTTPMultipartFill(&mp);
+            found = _attoHTTPMultipartFind(&mp, delim, dlen);
+            if (found >= 0) {
+                if ((data != NULL) && !data(parts, &mp.buffer[mp.start], found, 1)) {
+                    return -1;
+                }
+                mp.start += found + dlen;
+                parts++;
+                break;
+            } else if (mp.eof) {
+                return -1;
+            }
+            // Keep anything that could be the start of the delimiter
+            len = mp.fill - mp.start - (dlen - 1);
+            if ((data != NULL) && !data(parts, &mp.buffer[mp.start], len, 0)) {
+                return -1;
+            }
+            mp.start += len;
+        }
+    }
+}
 /**
  * @brief This adds a page to the buffer at the given URL
  *
@@ -1155,13 +5487,18 @@ attoHTTPDefaultPage(const char *url, const uint8_t *page, uint32_t page_len, mim
         _attoHTTPDefaultPage.content = page;
         _attoHTTPDefaultPage.size = page_len;
         _attoHTTPDefaultPage.type = type;
+        _attoHTTPDefaultPage.auth = AUTH_REQUIRED;
+        _attoHTTPDefaultPage.stream = 0;
         strncpy(_attoHTTPDefaultPage.url, url, sizeof(_attoHTTPDefaultPage.url));
         ret = 1;
     }
     return ret;
 }
 /**
- * @brief This adds the server sent events url
+ * @brief This adds a server sent events url
+ *
+ * This is the same as attoHTTPSSEAddStream(), for code that only has the one
+ * stream.
  *
  * @param url The URL string to look for
  *
@@ -1170,41 +5507,153 @@ attoHTTPDefaultPage(const char *url, const uint8_t *page, uint32_t page_len, mim
 uint8_t
 attoHTTPServerSetEventsURL(const char *url)
 {
-    uint8_t ret = 0;
-    if (strlen(_attoHTTPServerSentEventsPage) == 0) {
-        strncpy(_attoHTTPServerSentEventsPage, url, sizeof(_attoHTTPServerSentEventsPage));
-        ret = 1;
-    }
-    return ret;
+    return (attoHTTPSSEAddStream(url) >= 0);
 }
 /**
- * @brief This adds the default page to the buffer at the given URL
+ * @brief Puts a page in the first empty page buffer
+ *
+ * Event stream pages go to stream 0 unless attoHTTPSSEAddStream() says
+ * otherwise.
  *
  * @param url      The URL string to look for
  * @param page     A pointer to the page data
  * @param page_len The length of the page data
  * @param type     The mimetype to use
  *
- * @return 1 on success, 0 on failure
+ * @return The page, or NULL if there is no room
  */
-uint8_t
-attoHTTPAddPage(const char *url, const uint8_t *page, uint32_t page_len, mimetypes_t type)
+static attoHTTPPage_t *
+_attoHTTPNewPage(const char *url, const uint8_t *page, uint32_t page_len, mimetypes_t type)
 {
     uint8_t i;
-    uint8_t ret = 0;
     for (i = 0; i < ATTOHTTP_PAGE_BUFFERS; i++) {
         if (_attoHTTPPageEmpty(_attoHTTPPages[i])) {
             // Page and page_len should get set first for testing reasons
             _attoHTTPPages[i].content = page;
             _attoHTTPPages[i].size = page_len;
             _attoHTTPPages[i].type = type;
+            _attoHTTPPages[i].auth = AUTH_REQUIRED;
+            _attoHTTPPages[i].stream = 0;
             strncpy((char *)_attoHTTPPages[i].url, (char *)url, sizeof(_attoHTTPPages[i].url));
-            ret = 1;
-            break;
+            return &_attoHTTPPages[i];
         }
     }
-    return ret;
+    return NULL;
+}
+/**
+ * @brief This adds a server sent events stream at the given URL
+ *
+ * The stream takes up one of the page buffers, and is found the same way
+ * as any other page.  Each stream has its own subscribers and back pressure
+ * policy.  Streams are numbered from 0 in the order they are added.
+ * Subscribers added with attoHTTPSSEAdd() outside of a request go to stream 0.
+ *
+ * @param url The URL string to look for
+ *
+ * @return The stream number, or -1 on failure
+ */
+int8_t
+attoHTTPSSEAddStream(const char *url)
+{
+    attoHTTPPage_t *page;
+    if (_attoHTTPSSEStreamCount >= ATTOHTTP_SSE_STREAMS) {
+        return -1;
+    }
+    page = _attoHTTPNewPage(url, _attoHTTPSSEStreamPage, 0, TEXT_EVENTSTREAM);
+    if (page == NULL) {
+        return -1;
+    }
+    page->stream = _attoHTTPSSEStreamCount;
+    return _attoHTTPSSEStreamCount++;
+}
+/**
+ * @brief This adds the default page to the buffer at the given URL
+ *
+ * @param url      The URL string to look for
+ * @param page     A pointer to the page data
+ * @param page_len The length of the page data
+ * @param type     The mimetype to use
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPAddPage(const char *url, const uint8_t *page, uint32_t page_len, mimetypes_t type)
+{
+    return (_attoHTTPNewPage(url, page, page_len, type) != NULL);
+}
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * @brief Sets whether a page needs authentication
+ *
+ * Pages need authentication when they are added.  Things like icons and
+ * style sheets can be set to AUTH_NONE, so browsers don't have to get a 401
+ * and try again for each one.  This works for the default page and server
+ * sent events streams too.
+ *
+ * @param url  The URL of the page
+ * @param auth The policy for the page
+ *
+ * @return 1 on success, 0 if there is no page at that URL
+ */
+uint8_t
+attoHTTPPageAuth(const char *url, authpolicy_t auth)
+{
+    uint8_t i;
+    if (!_attoHTTPPageEmpty(_attoHTTPDefaultPage)
+        && (strncmp(_attoHTTPDefaultPage.url, url, sizeof(_attoHTTPDefaultPage.url)) == 0)) {
+        _attoHTTPDefaultPage.auth = auth;
+        return 1;
+    }
+    for (i = 0; i < ATTOHTTP_PAGE_BUFFERS; i++) {
+        if (!_attoHTTPPageEmpty(_attoHTTPPages[i])
+            && (strncmp(_attoHTTPPages[i].url, url, sizeof(_attoHTTPPages[i].url)) == 0)) {
+            _attoHTTPPages[i].auth = auth;
+            return 1;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief Sets whether a REST route needs authentication
+ *
+ * REST routes need authentication unless they are set to AUTH_NONE here.
+ * Everything under the route is covered, so "/api/status" covers
+ * "/api/status" and "/api/status/1", but not "/api/statusbar".
+ *
+ * @param url  The start of the URLs that make up the route
+ * @param auth The policy for the route
+ *
+ * @return 1 on success, 0 if there is no room for another route
+ */
+uint8_t
+attoHTTPRESTAuth(const char *url, authpolicy_t auth)
+{
+    uint8_t i;
+    char *empty = NULL;
+    if ((url == NULL) || (url[0] == 0) || (strlen(url) >= ATTOHTTP_PAGE_URL_SIZE)) {
+        return 0;
+    }
+    for (i = 0; i < ATTOHTTP_AUTH_ROUTES; i++) {
+        if (strcmp(_attoHTTPAuthRoutes[i], url) == 0) {
+            if (auth != AUTH_NONE) {
+                _attoHTTPAuthRoutes[i][0] = 0;
+            }
+            return 1;
+        }
+        if ((empty == NULL) && (_attoHTTPAuthRoutes[i][0] == 0)) {
+            empty = _attoHTTPAuthRoutes[i];
+        }
+    }
+    if (auth != AUTH_NONE) {
+        return 1;
+    }
+    if (empty == NULL) {
+        return 0;
+    }
+    strcpy(empty, url);
+    return 1;
 }
+#endif
 /**
  * @brief This prints out the STATUS_OK message
  *
@@ -1224,6 +5673,9 @@ attoHTTPSendHeaders(void)
         }
 #ifdef ATTOHTTP_GZIP_PAGES
         chars += attoHTTPprint("Content-Encoding: gzip" HTTPEOL);
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+        chars += _attoHTTPSendSessionCookie();
 #endif
         chars += attoHTTPprint(HTTPEOL);
         _attoHTTP_headersSent = 1;
@@ -1251,6 +5703,9 @@ attoHTTPRESTSendHeaders(uint16_t code, char *type, char *headers)
         if (headers != NULL) {
             chars += attoHTTPprint(headers);
         }
+#ifdef ATTOHTTP_AUTH_SESSION
+        chars += _attoHTTPSendSessionCookie();
+#endif
         chars += attoHTTPprint(HTTPEOL);
         _attoHTTP_headersSent = 1;
     }
@@ -1271,18 +5726,98 @@ attoHTTPInit(void)
     uint8_t i;
     _attoHTTPInitRun();
     _attoHTTPDefaultPage.url[0] = 0;
-    _attoHTTPServerSentEventsPage[0] = 0;
+    _attoHTTPSSESubscribeCallback = NULL;
+    _attoHTTPSSEClock = NULL;
+    _attoHTTPSSEHead = 0;
+    _attoHTTPSSELastID = 0;
+    _attoHTTPSSERetry = 0;
+    _attoHTTPSSENow = 0;
+    _attoHTTPSSEBatchStart = 0;
+    _attoHTTPSSEBatch = 0;
+    _attoHTTPSSEStreamCount = 0;
+    for (i = 0; i < ATTOHTTP_SSE_STREAMS; i++) {
+        _attoHTTPSSEStreams[i].policy = SSE_DISCONNECT;
+        _attoHTTPSSEStreams[i].highwater = ATTOHTTP_SSE_HIGH_WATER;
+    }
+    for (i = 0; i < ATTOHTTP_SSE_HISTORY; i++) {
+        _attoHTTPSSEHistory[i].id = 0;
+        _attoHTTPSSEHistory[i].start = 0;
+        _attoHTTPSSEHistory[i].elen = 0;
+        _attoHTTPSSEHistory[i].name = 0;
+        _attoHTTPSSEHistory[i].superseded = 0;
+        _attoHTTPSSEHistory[i].stream = SSE_ALL_STREAMS;
+    }
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        _attoHTTPSSESubscribers[i].write = NULL;
+        _attoHTTPSSESubscribers[i].close = NULL;
+    }
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+    memset(_attoHTTPAuthUsers, 0, sizeof(_attoHTTPAuthUsers));
+    _attoHTTPAuthUserCount = 0;
+#endif
+#ifdef ATTOHTTP_DIGEST_AUTH
+    for (i = 0; i < ATTOHTTP_DIGEST_NONCES; i++) {
+        _attoHTTPDigestNonces[i].id = 0;
+        _attoHTTPDigestNonces[i].nc = 0;
+        _attoHTTPDigestNonces[i].used = 0;
+    }
+    _attoHTTPDigestEvicted = _attoHTTPDigestNonceID;
+    _attoHTTPDigestUses = 0;
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+    attoHTTPSessionClear();
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+    memset(_attoHTTPPeers, 0, sizeof(_attoHTTPPeers));
+    _attoHTTPPeerUses = 0;
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    for (i = 0; i < ATTOHTTP_REQUEST_CLASSES; i++) {
+        _attoHTTPQueueHead[i] = 0;
+        _attoHTTPQueueLen[i] = 0;
+    }
+    _attoHTTPQueueStreak = 0;
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+    for (i = 0; i < ATTOHTTP_AUTH_ROUTES; i++) {
+        _attoHTTPAuthRoutes[i][0] = 0;
+    }
+#endif
+#ifdef ATTOHTTP_WEBSOCKET
+    for (i = 0; i < ATTOHTTP_WEBSOCKET_ROUTES; i++) {
+        _attoHTTPWebSocketRoutes[i].url[0] = 0;
+        _attoHTTPWebSocketRoutes[i].callback = NULL;
+    }
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        _attoHTTPWebSockets[i].write = NULL;
+        _attoHTTPWebSockets[i].close = NULL;
+    }
+#endif
+#ifdef ATTOHTTP_SSE_QUEUE
+    for (i = 0; i < ATTOHTTP_SSE_QUEUE_SLOTS; i++) {
+        atomic_init(&_attoHTTPSSEQueueSlots[i].seq, i);
+    }
+    atomic_init(&_attoHTTPSSEQueueHead, 0);
+    _attoHTTPSSEQueueTail = 0;
+#endif
     _attoHTTPDefaultPage.content = NULL;
     _attoHTTPDefaultPage.size = 0;
     _attoHTTPDefaultPage.type = TEXT_HTML;
+    _attoHTTPDefaultPage.auth = AUTH_REQUIRED;
+    _attoHTTPDefaultPage.stream = 0;
     _attoHTTPDefaultCallback = NULL;
     for (i = 0; i < ATTOHTTP_PAGE_BUFFERS; i++) {
         _attoHTTPPages[i].url[0] = 0;
         _attoHTTPPages[i].content = NULL;
         _attoHTTPPages[i].size = 0;
         _attoHTTPPages[i].type = TEXT_HTML;
+        _attoHTTPPages[i].auth = AUTH_REQUIRED;
+        _attoHTTPPages[i].stream = 0;
     }
     attoHTTPAddPage("/favicon.ico", favicon_ico, favicon_ico_len, IMAGE_PNG);
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+    attoHTTPPageAuth("/favicon.ico", AUTH_NONE);
+#endif
 }
 
 /**
@@ -1293,6 +5828,20 @@ attoHTTPInit(void)
  * This will process one connection, start to finish, when it is run.
  * It should only be called if there is a connection to deal with.
  *
+ * If ATTOHTTP_DEADLINE is set, the client gets ATTOHTTP_DEADLINE_LINE ms
+ * from when this is called to send the request line, and
+ * ATTOHTTP_DEADLINE_HEADERS ms to send the headers.  The body then has to
+ * come in at ATTOHTTP_DEADLINE_BODY_RATE bytes a second, after
+ * ATTOHTTP_DEADLINE_LINE ms to get started.  A client that takes longer
+ * gets STATUS_REQUEST_TIMEOUT.
+ *
+ * That bounds each connection, not each client.  A slow client holds up the
+ * server for up to ATTOHTTP_DEADLINE_HEADERS ms with no body, and up to
+ * ATTOHTTP_DEADLINE_REQUEST ms (10 s by default) with a big one, plus one
+ * wait in attoHTTPGetByte() past that.  One that keeps opening slow
+ * connections one after another can keep the server busy.  That has to be
+ * handled with ATTOHTTP_RATE_LIMIT or ATTOHTTP_REQUEST_QUEUE.
+ *
  * @param read This will be sent as the first argument to the get
  *             data functions.  It could be anything.
  * @param write This will be sent as the first argument to the send
@@ -1317,11 +5866,34 @@ attoHTTPExecute(void *read, void *write)
     if (_attoHTTP_returnCode == STATUS_RUNKNOWN) {
         _attoHTTPParseURL();
         _attoHTTPParseVersion();
+#ifdef ATTOHTTP_DEADLINE
+        _attoHTTP_deadline = ATTOHTTP_DEADLINE_HEADERS;
+#endif
+        _attoHTTP_page = _attoHTTPMatchPage(_attoHTTP_url, _attoHTTP_url_len);
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+        // Public things don't look at credentials at all
+        _attoHTTP_authRequired = _attoHTTPAuthRequired();
+        if (!_attoHTTP_authRequired) {
+            _attoHTTPAuthenticated = 1;
+        }
+#endif
     }
     if (_attoHTTP_returnCode == STATUS_RUNKNOWN) {
         _attoHTTPParseHeaders();
     }
-    if (!_attoHTTPAuthenticated) {
+#ifdef ATTOHTTP_DEADLINE
+    _attoHTTP_deadline = _attoHTTPBodyDeadline();
+    if (_attoHTTP_timedOut) {
+        // What did come in can't be trusted, so don't act on any of it
+        _attoHTTP_returnCode = STATUS_REQUEST_TIMEOUT;
+    }
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+    if (_attoHTTP_authRequired && _attoHTTPAuthenticated && (_attoHTTP_session < 0) && (_attoHTTP_returnCode == STATUS_RUNKNOWN)) {
+        _attoHTTPSessionNew();
+    }
+#endif
+    if (!_attoHTTPAuthenticated && (_attoHTTP_returnCode != STATUS_REQUEST_TIMEOUT)) {
         _attoHTTP_returnCode = STATUS_UNAUTHORIZED;
     }
     if (_attoHTTP_returnCode == STATUS_RUNKNOWN) {
@@ -1334,6 +5906,12 @@ attoHTTPExecute(void *read, void *write)
             // Not found in the find page, so check the RESTful stuff
         }
     }
+#ifdef ATTOHTTP_DEADLINE
+    if (_attoHTTP_timedOut && (_attoHTTP_firstlineSent == 0)) {
+        // The body didn't all come in before the handler gave up on it
+        _attoHTTP_returnCode = STATUS_REQUEST_TIMEOUT;
+    }
+#endif
     if (_attoHTTP_returnCode == STATUS_RUNKNOWN) {
         _attoHTTP_returnCode = STATUS_INTERNAL_ERROR;
     }
@@ -1352,93 +5930,543 @@ attoHTTPExecute(void *read, void *write)
     return _attoHTTP_returnCode;
 
 }
-
-#ifdef ATTOHTTP_BASIC_AUTH
-uint8_t base64data[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+#ifdef ATTOHTTP_WEBSOCKET
 /**
- * @brief encodes a string as base64 RFC2045
+ * @brief This adds a URL that takes WebSocket upgrades
  *
- * @param input  The input string to use
- * @param ilen   The length of the input string
- * @param output The output string
- * @param olen   The length of the output buffer
+ * A GET to this URL with the upgrade headers from RFC 6455 gets back
+ * "101 Switching Protocols", and attoHTTPExecute() returns
+ * STATUS_SWITCHING_PROTOCOLS.  The connection should then be given to
+ * attoHTTPWebSocketAdd() instead of being closed.  Anything else sent to the
+ * URL gets a 400.
  *
- * @return number of characters in return string
+ * @param url      The URL string to look for
+ * @param callback The function to give the messages to
+ *
+ * @return 1 on success, 0 on failure
  */
-uint16_t
-attoHTTPBase64Encode(int8_t *input, uint16_t ilen, int8_t *output, uint16_t olen)
+uint8_t
+attoHTTPAddWebSocket(const char *url, attoHTTPWebSocketCallback callback)
 {
-    uint16_t i;
-    uint16_t o = 0;
+    uint8_t i;
+    if (callback == NULL) {
+        return 0;
+    }
+    for (i = 0; i < ATTOHTTP_WEBSOCKET_ROUTES; i++) {
+        if (_attoHTTPWebSocketRoutes[i].callback == NULL) {
+            strncpy(_attoHTTPWebSocketRoutes[i].url, url, sizeof(_attoHTTPWebSocketRoutes[i].url));
+            _attoHTTPWebSocketRoutes[i].callback = callback;
+            return 1;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief Keeps a connection open as a WebSocket
+ *
+ * This must be called right after attoHTTPExecute() returns
+ * STATUS_SWITCHING_PROTOCOLS, since the message callback comes from that
+ * request.  After that, attoHTTPWebSocketRead() should be called whenever
+ * there is something to read on the connection.
+ *
+ * @param read  The first argument for attoHTTPGetByte
+ * @param write The first argument for attoHTTPSetByte
+ * @param close This gets called when the connection is done.  Can be NULL.
+ *
+ * @return The WebSocket handle, or -1 on failure
+ */
+int8_t
+attoHTTPWebSocketAdd(void *read, void *write, attoHTTPWebSocketCloseCallback close)
+{
+    int8_t i;
+    attoHTTPWebSocket_t *w;
+    if ((write == NULL) || (_attoHTTP_wsCallback == NULL)) {
+        return -1;
+    }
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        w = &_attoHTTPWebSockets[i];
+        if (w->write == NULL) {
+            w->read = read;
+            w->write = write;
+            w->close = close;
+            w->callback = _attoHTTP_wsCallback;
+            w->state = _attoHTTPWS_HEADER;
+            w->opcode = 0;
+            w->fill = 0;
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+            w->deflate = _attoHTTP_wsDeflate;
+            w->compressed = 0;
+            w->takeover = ((_attoHTTP_wsDeflateFlags & _attoHTTPWS_NO_TAKEOVER) == 0);
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+            w->wfill = 0;
+#endif
+            _attoHTTP_wsDeflate = 0;
+#endif
+            _attoHTTP_wsCallback = NULL;
+            return i;
+        }
+    }
+    return -1;
+}
+/**
+ * @brief Drops a WebSocket connection without sending a close frame
+ *
+ * @param ws The WebSocket handle
+ *
+ * @return 1 if it was removed, 0 if there was nothing to remove
+ */
+uint8_t
+attoHTTPWebSocketRemove(int8_t ws)
+{
+    attoHTTPWebSocketCloseCallback close;
+    void *write;
+    if ((ws < 0) || (ws >= ATTOHTTP_WEBSOCKETS) || (_attoHTTPWebSockets[ws].write == NULL)) {
+        return 0;
+    }
+    close = _attoHTTPWebSockets[ws].close;
+    write = _attoHTTPWebSockets[ws].write;
+    _attoHTTPWebSockets[ws].write = NULL;
+    _attoHTTPWebSockets[ws].close = NULL;
+    if (close != NULL) {
+        close(write);
+    }
+    return 1;
+}
+/**
+ * @brief Counts the open WebSocket connections
+ *
+ * @return The number of connections
+ */
+uint8_t
+attoHTTPWebSocketCount(void)
+{
+    uint8_t i;
+    uint8_t count = 0;
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        if (_attoHTTPWebSockets[i].write != NULL) {
+            count++;
+        }
+    }
+    return count;
+}
+/**
+ * @brief Reads from a WebSocket connection
+ *
+ * This reads until one frame is done, or there is nothing more to read.  A
+ * frame can come in over as many calls as it needs to.  If nothing at all
+ * could be read, the client is taken to have gone away and the connection
+ * is removed.
+ *
+ * If ATTOHTTP_BULK_READ is set, payloads are read with attoHTTPGetBytes().
+ *
+ * @param ws The WebSocket handle
+ *
+ * @return 1 if a frame was done, 0 if more is needed, -1 if the connection
+ *         was closed
+ */
+int8_t
+attoHTTPWebSocketRead(int8_t ws)
+{
+    attoHTTPWebSocket_t *w;
+    uint8_t *dst;
     uint8_t c;
-    for (i = 0; i < ilen; i+= 3) {
-        if (o >= olen) break;
-        c = (input[i]>>2) & 0x3F;
-        output[o++] = base64data[c];
-        if (o >= olen) break;
-        c = (input[i]<< 4) & 0x3F;
-        if ((i + 1) < ilen) {
-            c |= (input[i+1]>>4) & 0x3F;
-            output[o++] = base64data[c];
-            if (o >= olen) break;
-            c = (input[i+1]<<2) & 0x3F;
-            if ((i + 2) < ilen) {
-                c |= (input[i+2]>>6) & 0x3F;
-                output[o++] = base64data[c];
-                if (o >= olen) break;
-                c = input[i+2] & 0x3F;
-                output[o++] = base64data[c];
+    int16_t ret;
+    uint16_t got = 0;
+    if ((ws < 0) || (ws >= ATTOHTTP_WEBSOCKETS) || (_attoHTTPWebSockets[ws].write == NULL)) {
+        return -1;
+    }
+    w = &_attoHTTPWebSockets[ws];
+    for (;;) {
+        if ((w->state == _attoHTTPWS_PAYLOAD) && (w->left == 0)) {
+            return _attoHTTPWebSocketFrame(ws);
+        }
+        if (w->state == _attoHTTPWS_PAYLOAD) {
+            if ((w->frame & 0x0F) >= WS_CLOSE) {
+                dst = &w->control[w->size - w->left];
             } else {
-                output[o++] = base64data[c];
-                if (o >= olen) break;
-                output[o++] = '=';
+                dst = &w->buffer[w->fill];
+            }
+#ifdef ATTOHTTP_BULK_READ
+            ret = attoHTTPGetBytes(w->read, dst, (uint16_t)w->left);
+#else
+            ret = attoHTTPGetByte(w->read, dst);
+#endif
+            if (ret <= 0) {
+                break;
             }
+            _attoHTTPWebSocketUnmask(dst, ret, w->mask, w->size - w->left);
+            w->left -= ret;
+            if ((w->frame & 0x0F) < WS_CLOSE) {
+                w->fill += ret;
+            }
+            got += ret;
         } else {
-            output[o++] = base64data[c];
-            if (o >= olen) break;
-            output[o++] = '=';
-            if (o >= olen) break;
-            output[o++] = '=';
+            ret = attoHTTPGetByte(w->read, &c);
+            if (ret <= 0) {
+                break;
+            }
+            got++;
+            if (!_attoHTTPWebSocketHeader(ws, c)) {
+                return -1;
+            }
         }
     }
-    if (o >= olen) {
-        o = olen - 1;
+    if (got == 0) {
+        attoHTTPWebSocketRemove(ws);
+        return -1;
     }
-    output[o] = 0;
-    return o;
+    return 0;
 }
 /**
- * @brief decodes a single character.
+ * @brief Sends a WebSocket frame
  *
- * @param c The character to decode
+ * Frames from the server are not masked.  If the write fails the connection
+ * is removed.
  *
- * @return The decoded char
+ * If permessage-deflate was set up, text and binary messages of at least
+ * ATTOHTTP_WEBSOCKET_DEFLATE_MIN bytes are compressed.  They are sent as they
+ * are if that doesn't make them smaller.
+ *
+ * @param ws     The WebSocket handle
+ * @param opcode The frame type
+ * @param data   The payload
+ * @param len    The length of the payload
+ *
+ * @return 1 on success, 0 on failure
  */
-int8_t
-_attoHTTPBase64DecodeChar(uint8_t c)
+uint8_t
+attoHTTPWebSocketSend(int8_t ws, wsopcode_t opcode, const uint8_t *data, uint16_t len)
 {
-    int8_t ret;
-    if ((c >= 'A') && (c <= 'Z')) {
-        ret = c - 'A';
-    } else if ((c >= 'a') && (c <= 'z')) {
-        ret = c - 'a' + 26;
-    } else if ((c >= '0') && (c <= '9')) {
-        ret = c - '0' + 52;
-    } else if (c == '+') {
-        ret = 62;
-    } else if (c == '/') {
-        ret = 63;
-    } else if (c == '=') {
-        ret = 64;
+    uint8_t header[4];
+    uint8_t hlen = 2;
+    void *write;
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    attoHTTPWebSocket_t *w;
+    uint16_t clen;
+#endif
+    if ((ws < 0) || (ws >= ATTOHTTP_WEBSOCKETS) || (_attoHTTPWebSockets[ws].write == NULL)) {
+        return 0;
+    }
+    write = _attoHTTPWebSockets[ws].write;
+    header[0] = 0x80 | (opcode & 0x0F);
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    w = &_attoHTTPWebSockets[ws];
+    if ((w->deflate != 0) && ((opcode == WS_TEXT) || (opcode == WS_BINARY))
+        && (len >= ATTOHTTP_WEBSOCKET_DEFLATE_MIN) && (len <= ATTOHTTP_WEBSOCKET_BUFFER_SIZE)) {
+        clen = _attoHTTPDeflate(w, data, len);
+        if (clen > 0) {
+            header[0] |= 0x40;
+            data = _attoHTTPDeflateOut;
+            len = clen;
+        }
+    }
+#endif
+    if (len < 126) {
+        header[1] = len;
     } else {
-        ret = 65;
+        header[1] = 126;
+        header[2] = (len >> 8) & 0xFF;
+        header[3] = len & 0xFF;
+        hlen = 4;
     }
-    return ret;
+    if (!_attoHTTPWebSocketWrite(write, header, hlen) || !_attoHTTPWebSocketWrite(write, data, len)) {
+        attoHTTPWebSocketRemove(ws);
+        return 0;
+    }
+    return 1;
+}
+/**
+ * @brief Sends a close frame, and removes the connection
+ *
+ * @param ws   The WebSocket handle
+ * @param code The status code from RFC 6455, or 0 to leave it out
+ *
+ * @return 1 if the connection was closed, 0 if it wasn't open
+ */
+uint8_t
+attoHTTPWebSocketClose(int8_t ws, uint16_t code)
+{
+    uint8_t payload[2];
+    if ((ws < 0) || (ws >= ATTOHTTP_WEBSOCKETS) || (_attoHTTPWebSockets[ws].write == NULL)) {
+        return 0;
+    }
+    payload[0] = (code >> 8) & 0xFF;
+    payload[1] = code & 0xFF;
+    attoHTTPWebSocketSend(ws, WS_CLOSE, payload, (code != 0) ? sizeof(payload) : 0);
+    attoHTTPWebSocketRemove(ws);
+    return 1;
+}
+#endif
+
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * @brief Works out HA1 for a user, the way the credential store keeps it
+ *
+ * HA1 is MD5(user:realm:password), with ATTOHTTP_AUTH_REALM as the realm.
+ * This can be used to make the HA1 values ahead of time, so that the
+ * passwords don't have to be kept on the device.
+ *
+ * @param user     The user name
+ * @param password The password
+ * @param ha1      Where to put the 16 byte HA1
+ *
+ * @return None
+ */
+void
+attoHTTPAuthHA1(const char *user, const char *password, uint8_t *ha1)
+{
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, user, strlen(user));
+    MD5_Update(&ctx, ":" ATTOHTTP_AUTH_REALM ":", sizeof(ATTOHTTP_AUTH_REALM) + 1);
+    MD5_Update(&ctx, password, strlen(password));
+    MD5_Final(ha1, &ctx);
+}
+/**
+ * @brief Adds a user to the credential store
+ *
+ * Once a user is added, Basic and Digest credentials are checked against the
+ * store.  If none are added, they go to attoHTTPWrapperCheckAuth() instead.
+ * Adding a user that is already there changes their HA1.  The store takes up
+ * to 3/4 of ATTOHTTP_AUTH_USERS users.
+ *
+ * @param user The user name
+ * @param ha1  The 16 byte HA1 for the user, from attoHTTPAuthHA1()
+ *
+ * @return 1 on success, 0 on failure
+ */
+uint8_t
+attoHTTPAuthAddUser(const char *user, const uint8_t *ha1)
+{
+    attoHTTPAuthUser_t *u;
+    uint32_t hash;
+    uint16_t slot;
+    if ((user == NULL) || (*user == 0) || (strlen(user) >= ATTOHTTP_AUTH_USER_SIZE)) {
+        return 0;
+    }
+    hash = _attoHTTPAuthHash(user);
+    u = _attoHTTPAuthFind(user, hash);
+    if (u == NULL) {
+        if (_attoHTTPAuthUserCount >= _attoHTTPAUTH_USERS_MAX) {
+            return 0;
+        }
+        slot = hash & (ATTOHTTP_AUTH_USERS - 1);
+        while (_attoHTTPAuthUsers[slot].user[0] != 0) {
+            slot = (slot + 1) & (ATTOHTTP_AUTH_USERS - 1);
+        }
+        u = &_attoHTTPAuthUsers[slot];
+        memcpy(u->user, user, strlen(user) + 1);
+        u->hash = hash;
+        _attoHTTPAuthUserCount++;
+    }
+    memcpy(u->ha1, ha1, sizeof(u->ha1));
+    return 1;
+}
+#endif
+#ifdef ATTOHTTP_DIGEST_AUTH
+/**
+ * @brief Sets the key that nonces are signed with
+ *
+ * This should be set to something random every time the server starts, so
+ * that nonces from before can't be used again.  If it isn't set, a key is
+ * made with attoHTTPGetRandom() when the first nonce is made.
+ *
+ * @param key The key
+ * @param len The length of the key
+ *
+ * @return None
+ */
+void
+attoHTTPDigestSecret(const uint8_t *key, uint8_t len)
+{
+    MD5_HMAC_Key(&_attoHTTPDigestKey, key, len);
+    _attoHTTPDigestKeyed = 1;
+}
+#endif
+#ifdef ATTOHTTP_AUTH_SESSION
+/**
+ * @brief Drops all of the sessions
+ *
+ * Everybody has to authenticate again after this.  It should be called
+ * when a password changes.
+ *
+ * @return None
+ */
+void
+attoHTTPSessionClear(void)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_AUTH_SESSIONS; i++) {
+        _attoHTTPSessions[i].valid = 0;
+        _attoHTTPSessions[i].used = 0;
+    }
+    _attoHTTPSessionUses = 0;
+}
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_WEBSOCKET)
+uint8_t base64data[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+/** The bit that says an entry in _attoHTTPBase64Table is a base64 digit */
+#define ATTOHTTP_BASE64_VALID 0x40
+/**
+ * @var This is a map of base64 digits to their value
+ *
+ * Digits are stored as their value with ATTOHTTP_BASE64_VALID set.  Everything
+ * else, '=' included, is 0, so ANDing the four entries of a group tells if the
+ * whole group is good in one test.
+ */
+static const uint8_t _attoHTTPBase64Table[256] = {
+    ['A'] = 0x40, ['B'] = 0x41, ['C'] = 0x42, ['D'] = 0x43, ['E'] = 0x44, ['F'] = 0x45, ['G'] = 0x46, ['H'] = 0x47,
+    ['I'] = 0x48, ['J'] = 0x49, ['K'] = 0x4A, ['L'] = 0x4B, ['M'] = 0x4C, ['N'] = 0x4D, ['O'] = 0x4E, ['P'] = 0x4F,
+    ['Q'] = 0x50, ['R'] = 0x51, ['S'] = 0x52, ['T'] = 0x53, ['U'] = 0x54, ['V'] = 0x55, ['W'] = 0x56, ['X'] = 0x57,
+    ['Y'] = 0x58, ['Z'] = 0x59, ['a'] = 0x5A, ['b'] = 0x5B, ['c'] = 0x5C, ['d'] = 0x5D, ['e'] = 0x5E, ['f'] = 0x5F,
+    ['g'] = 0x60, ['h'] = 0x61, ['i'] = 0x62, ['j'] = 0x63, ['k'] = 0x64, ['l'] = 0x65, ['m'] = 0x66, ['n'] = 0x67,
+    ['o'] = 0x68, ['p'] = 0x69, ['q'] = 0x6A, ['r'] = 0x6B, ['s'] = 0x6C, ['t'] = 0x6D, ['u'] = 0x6E, ['v'] = 0x6F,
+    ['w'] = 0x70, ['x'] = 0x71, ['y'] = 0x72, ['z'] = 0x73, ['0'] = 0x74, ['1'] = 0x75, ['2'] = 0x76, ['3'] = 0x77,
+    ['4'] = 0x78, ['5'] = 0x79, ['6'] = 0x7A, ['7'] = 0x7B, ['8'] = 0x7C, ['9'] = 0x7D, ['+'] = 0x7E, ['/'] = 0x7F,
+};
+#ifdef _attoHTTPBASE64_SSSE3
+/**
+ * @brief encodes 12 bytes as 16 base64 digits
+ *
+ * The bytes are spread out so every 32 bit lane holds one 3 byte group, the
+ * multiplies move each 6 bit index into its own byte, and the index is turned
+ * into ASCII by adding an offset looked up from which range it is in.
+ *
+ * @param in The 12 bytes in the low end of the register
+ *
+ * @return The 16 digits
+ */
+static inline __m128i
+_attoHTTPBase64EncodeSSSE3(__m128i in)
+{
+    __m128i t0, t1, range;
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    in = _mm_or_si128(t0, t1);
+    // 0 for 'a'-'z', 1-10 for the digits, 11 & 12 for "+/", 13 for 'A'-'Z'
+    range = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), in), _mm_set1_epi8(13)));
+    range = _mm_shuffle_epi8(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0), range);
+    return _mm_add_epi8(in, range);
+}
+/**
+ * @brief decodes 16 base64 digits into 12 bytes
+ *
+ * The digit is checked by looking up its high and low nibble in two tables
+ * whose bits only overlap for characters that aren't base64.  The high nibble
+ * then picks the offset that turns the character back into its 6 bit value,
+ * and the multiply-adds pack four of those into 3 bytes.
+ *
+ * @param in  The 16 digits
+ * @param out Where to put the 12 bytes (16 are written)
+ *
+ * @return 1 if all 16 were base64 digits, 0 otherwise
+ */
+static inline uint8_t
+_attoHTTPBase64DecodeSSSE3(__m128i in, uint8_t *out)
+{
+    const __m128i mask = _mm_set1_epi8(0x2F);
+    __m128i hi, lo, roll;
+    hi = _mm_and_si128(_mm_srli_epi32(in, 4), mask);
+    lo = _mm_shuffle_epi8(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A),
+                          _mm_and_si128(in, mask));
+    lo = _mm_and_si128(lo, _mm_shuffle_epi8(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10), hi));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(lo, _mm_setzero_si128())) != 0) {
+        return 0;
+    }
+    // '/' shares its high nibble with '+', so it gets moved down one slot
+    roll = _mm_shuffle_epi8(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0),
+                            _mm_add_epi8(_mm_cmpeq_epi8(in, mask), hi));
+    in = _mm_add_epi8(in, roll);
+    in = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    in = _mm_madd_epi16(in, _mm_set1_epi32(0x00011000));
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128((__m128i *)out, in);
+    return 1;
+}
+#endif
+#ifdef _attoHTTPBASE64_AVX2
+/**
+ * @brief encodes 24 bytes as 32 base64 digits
+ *
+ * This is _attoHTTPBase64EncodeSSSE3() on both 128 bit lanes at once.
+ *
+ * @param in The input.  28 bytes must be readable.
+ *
+ * @return The 32 digits
+ */
+static inline __m256i
+_attoHTTPBase64EncodeAVX2(const uint8_t *in)
+{
+    __m256i v, t0, t1, range;
+    v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+                                _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+    v = _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(
+                                   _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1)));
+    t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+    t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+    v = _mm256_or_si256(t0, t1);
+    range = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+    range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), v), _mm256_set1_epi8(13)));
+    range = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+                                    _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                                  '/' - 63, 'A', 0, 0)), range);
+    return _mm256_add_epi8(v, range);
+}
+/**
+ * @brief decodes 32 base64 digits into 24 bytes
+ *
+ * This is _attoHTTPBase64DecodeSSSE3() on both 128 bit lanes at once, with the
+ * two 12 byte halves pulled together at the end.
+ *
+ * @param in  The 32 digits
+ * @param out Where to put the 24 bytes (32 are written)
+ *
+ * @return 1 if all 32 were base64 digits, 0 otherwise
+ */
+static inline uint8_t
+_attoHTTPBase64DecodeAVX2(__m256i in, uint8_t *out)
+{
+    const __m256i mask = _mm256_set1_epi8(0x2F);
+    __m256i hi, lo, roll;
+    hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask);
+    lo = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+                                 _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                               0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A)),
+                             _mm256_and_si256(in, mask));
+    if (!_mm256_testz_si256(lo, _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+                                _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                              0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10)), hi))) {
+        return 0;
+    }
+    roll = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(
+                                   _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0)),
+                               _mm256_add_epi8(_mm256_cmpeq_epi8(in, mask), hi));
+    in = _mm256_add_epi8(in, roll);
+    in = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+    in = _mm256_madd_epi16(in, _mm256_set1_epi32(0x00011000));
+    in = _mm256_shuffle_epi8(in, _mm256_broadcastsi128_si256(
+                                     _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)));
+    in = _mm256_permutevar8x32_epi32(in, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)out, in);
+    return 1;
 }
+#endif
 /**
- * @brief decodes a string as base64 RFC2045
+ * @brief encodes a string as base64 RFC4648
  *
- * @param input  The input string to use
+ * Whole 3 byte groups are done without checking the output after every
+ * digit.  Only the last group, or the one that doesn't fit, is done one digit
+ * at a time.  If the output is too small the encoded string is cut off to
+ * fit.
+ *
+ * @param sinput The input string to use
  * @param ilen   The length of the input string
  * @param output The output string
  * @param olen   The length of the output buffer
@@ -1446,45 +6474,158 @@ _attoHTTPBase64DecodeChar(uint8_t c)
  * @return number of characters in return string
  */
 uint16_t
-attoHTTPBase64Decode(int8_t *input, uint16_t ilen, int8_t *output, uint16_t olen)
+attoHTTPBase64Encode(int8_t *sinput, uint16_t ilen, int8_t *output, uint16_t olen)
 {
-    int8_t c[4];
+    // Unsigned, so that the shifts don't drag the sign bit in
+    uint8_t *input = (uint8_t *)sinput;
+    uint8_t *out = (uint8_t *)output;
+    uint8_t tail[4];
+    uint16_t i = 0;
     uint16_t o = 0;
-    uint16_t i;
-    for (i = 0; i < ilen; i+=4) {
-        c[0] = _attoHTTPBase64DecodeChar(input[i]);
-        c[1] = (i+1 < ilen) ? _attoHTTPBase64DecodeChar(input[i+1]) : 65;
-        c[2] = (i+2 < ilen) ? _attoHTTPBase64DecodeChar(input[i+2]) : 65;
-        c[3] = (i+3 < ilen) ? _attoHTTPBase64DecodeChar(input[i+3]) : 65;
-        if (o >= olen) break;
-        if (c[1] < 64) {
-            output[o++] = ((c[0]<<2) & 0xFC) | ((c[1]>>4) & 0x03);
-            if (o >= olen) break;
-            if (c[2] < 64) {
-                output[o++] = ((c[1]<<4) & 0xF0) | (c[2]>>2 & 0x0F);
-                if (o >= olen) break;
-                if (c[3] < 64) {
-                    output[o++] = ((c[2]<<6) & 0xC0) | (c[3] & 0x3F);
-                    if (o >= olen) break;
-                } else {
-                    break;
-                }
-            } else {
-                break;
-            }
-        } else {
+    uint16_t end;
+    uint32_t w;
+    uint8_t n;
+    if (olen == 0) {
+        return 0;
+    }
+    // The last byte is for the terminator
+    end = olen - 1;
+#ifdef _attoHTTPBASE64_AVX2
+    for (; ((i + 28) <= ilen) && ((o + 32) <= end); i += 24, o += 32) {
+        _mm256_storeu_si256((__m256i *)&out[o], _attoHTTPBase64EncodeAVX2(&input[i]));
+    }
+#endif
+#ifdef _attoHTTPBASE64_SSSE3
+    for (; ((i + 16) <= ilen) && ((o + 16) <= end); i += 12, o += 16) {
+        _mm_storeu_si128((__m128i *)&out[o], _attoHTTPBase64EncodeSSSE3(_mm_loadu_si128((__m128i *)&input[i])));
+    }
+#endif
+    for (; ((i + 3) <= ilen) && ((o + 4) <= end); i += 3, o += 4) {
+        w = ((uint32_t)input[i] << 16) | ((uint32_t)input[i + 1] << 8) | input[i + 2];
+        out[o]     = base64data[(w >> 18) & 0x3F];
+        out[o + 1] = base64data[(w >> 12) & 0x3F];
+        out[o + 2] = base64data[(w >> 6) & 0x3F];
+        out[o + 3] = base64data[w & 0x3F];
+    }
+    if ((i < ilen) && (o < end)) {
+        w = (uint32_t)input[i] << 16;
+        if ((i + 1) < ilen) {
+            w |= (uint32_t)input[i + 1] << 8;
+        }
+        if ((i + 2) < ilen) {
+            w |= input[i + 2];
+        }
+        tail[0] = base64data[(w >> 18) & 0x3F];
+        tail[1] = base64data[(w >> 12) & 0x3F];
+        tail[2] = ((i + 1) < ilen) ? base64data[(w >> 6) & 0x3F] : '=';
+        tail[3] = ((i + 2) < ilen) ? base64data[w & 0x3F] : '=';
+        for (n = 0; (n < sizeof(tail)) && (o < end); n++) {
+            out[o++] = tail[n];
+        }
+    }
+    out[o] = 0;
+    return o;
+}
+/**
+ * @brief decodes a string as base64 RFC4648
+ *
+ * This is strict.  Padding is optional, but if it is there it has to finish
+ * off the last group of 4.  Anything that isn't a base64 digit, a '=' that
+ * isn't at the end, a lone digit at the end, or unused bits in the last digit
+ * that aren't 0 make the whole string bad.  If the output is too small the
+ * decoded string is cut off to fit, but all of the input is still checked.
+ *
+ * @param sinput The input string to use
+ * @param ilen   The length of the input string
+ * @param output The output string
+ * @param olen   The length of the output buffer
+ *
+ * @return number of characters in return string, 0 if the input is bad
+ */
+uint16_t
+attoHTTPBase64Decode(int8_t *sinput, uint16_t ilen, int8_t *output, uint16_t olen)
+{
+    // Unsigned, so that they can index the table
+    uint8_t *input = (uint8_t *)sinput;
+    uint8_t *out = (uint8_t *)output;
+    uint16_t len = ilen;
+    uint16_t i = 0;
+    uint16_t o = 0;
+    uint16_t end;
+    uint8_t c[4];
+    uint8_t n, k;
+    uint32_t w;
+    if (olen == 0) {
+        return 0;
+    }
+    end = olen - 1;
+    // Padding only ever finishes off a group of 4.  Any other '=' is bad below.
+    if (((len & 3) == 0) && (len > 0) && (input[len - 1] == '=')) {
+        len--;
+        if (input[len - 1] == '=') {
+            len--;
+        }
+    }
+    if ((len & 3) == 1) {
+        output[0] = 0;
+        return 0;
+    }
+#ifdef _attoHTTPBASE64_AVX2
+    for (; ((i + 32) <= len) && ((o + 32) <= end); i += 32, o += 24) {
+        if (!_attoHTTPBase64DecodeAVX2(_mm256_loadu_si256((__m256i *)&input[i]), &out[o])) {
+            break;
+        }
+    }
+#endif
+#ifdef _attoHTTPBASE64_SSSE3
+    for (; ((i + 16) <= len) && ((o + 16) <= end); i += 16, o += 12) {
+        if (!_attoHTTPBase64DecodeSSSE3(_mm_loadu_si128((__m128i *)&input[i]), &out[o])) {
+            break;
+        }
+    }
+#endif
+    // The groups that the vector code didn't do, and the one at the end
+    while (i < len) {
+        n = ((len - i) > 4) ? 4 : (len - i);
+        // A short group has at least 2 digits, and the missing ones count as 0
+        c[0] = _attoHTTPBase64Table[input[i]];
+        c[1] = _attoHTTPBase64Table[input[i + 1]];
+        c[2] = (n > 2) ? _attoHTTPBase64Table[input[i + 2]] : ATTOHTTP_BASE64_VALID;
+        c[3] = (n > 3) ? _attoHTTPBase64Table[input[i + 3]] : ATTOHTTP_BASE64_VALID;
+        if ((c[0] & c[1] & c[2] & c[3] & ATTOHTTP_BASE64_VALID) == 0) {
+            break;
+        }
+        w = ((uint32_t)(c[0] & 0x3F) << 18) | ((uint32_t)(c[1] & 0x3F) << 12)
+            | ((uint32_t)(c[2] & 0x3F) << 6) | (c[3] & 0x3F);
+        // In a short group the bits past the last byte have to be 0
+        if (((n == 2) && ((c[1] & 0x0F) != 0)) || ((n == 3) && ((c[2] & 0x03) != 0))) {
             break;
         }
+        i += n;
+        n--;    // The number of bytes this group holds
+        if ((o + 3) <= end) {
+            out[o]     = w >> 16;
+            out[o + 1] = w >> 8;
+            out[o + 2] = w;
+            o += n;
+        } else {
+            for (k = 0; (k < n) && (o < end); k++) {
+                out[o++] = w >> (16 - (8 * k));
+            }
+        }
     }
-    if (o >= olen) {
-        o = olen - 1;
+    if (i < len) {
+        o = 0;
     }
-    output[o] = 0;
+    out[o] = 0;
     return o;
 }
 #endif
 
-#if defined(ATTOHTTP_DIGEST_AUTH)
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
 # include "md5.c"
 #endif
+#if defined(ATTOHTTP_WEBSOCKET)
+# include "sha1.c"
+#endif
 
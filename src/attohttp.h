@@ -67,6 +67,92 @@
  * @return 1 if a character was read, 0 otherwise.
  *
  *
+ * @section char_fcts_gets attoHTTPGetBytes
+ * @subsection char_fcts_gets_prototype Prototype
+ * @code
+ * int16_t attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len);
+ * @endcode
+ *
+ * @subsection char_fcts_gets_explain Explaination
+ *
+ * This function only needs to be defined if ATTOHTTP_BULK_READ is set.  It
+ * is used to read the body of the request in blocks instead of one byte at
+ * a time.  It should return as soon as it has any data, and should never
+ * read more than len bytes.
+ *
+ * @param read This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to the execute routine.
+ * @param buf   The buffer to put the bytes in
+ * @param len   The most bytes to read
+ *
+ * @return The number of bytes read, 0 on timeout, -1 on error
+ *
+ *
+ * @section char_fcts_sets attoHTTPSetBytes
+ * @subsection char_fcts_sets_prototype Prototype
+ * @code
+ * int16_t attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len);
+ * @endcode
+ *
+ * @subsection char_fcts_sets_explain Explaination
+ *
+ * This function only needs to be defined if ATTOHTTP_BULK_WRITE is set.  It
+ * is used to send server sent events out of the event ring buffer in blocks
+ * instead of one byte at a time.  It may write less than len bytes if the
+ * connection can't take any more right now.  The rest will be sent the next
+ * time attoHTTPSSEFlush() is called.
+ *
+ * Slow subscribers can only be kept from holding up the server if this is
+ * used.  Without it, subscribers are written with attoHTTPSetByte(), which
+ * has no way to say that the connection is full, so each write waits until
+ * the subscriber takes the byte.  attoHTTPSSESetPolicy() fails in that case.
+ *
+ * @param write This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to attoHTTPSSEAdd().
+ * @param buf   The bytes to write
+ * @param len   The number of bytes in buf
+ *
+ * @return The number of bytes written, -1 on error
+ *
+ *
+ * @section char_fcts_millis attoHTTPGetMillis
+ * @subsection char_fcts_millis_prototype Prototype
+ * @code
+ * uint32_t attoHTTPGetMillis(void);
+ * @endcode
+ *
+ * @subsection char_fcts_millis_explain Explaination
+ *
+ * This function only needs to be defined if ATTOHTTP_DEADLINE is set.  It
+ * is used to time how long the client takes to send its request.  It must
+ * never go backwards, so it can't be a clock that gets set.  It is fine for
+ * it to roll over.
+ *
+ * @return The time in ms
+ *
+ *
+ * @section char_fcts_random attoHTTPGetRandom
+ * @subsection char_fcts_random_prototype Prototype
+ * @code
+ * void attoHTTPGetRandom(uint8_t *buf, uint8_t len);
+ * @endcode
+ *
+ * @subsection char_fcts_random_explain Explaination
+ *
+ * This function only needs to be defined if ATTOHTTP_AUTH_SESSION or
+ * ATTOHTTP_DIGEST_AUTH is set.  It makes the session cookies, and the Digest
+ * nonce key if attoHTTPDigestSecret() isn't called, so it has to come from a
+ * good random source, like a hardware random number generator.  If these can
+ * be guessed, anybody can get in without a password.
+ *
+ * @param buf   The buffer to fill with random bytes
+ * @param len   The number of bytes to put in buf
+ *
+ * @return None
+ *
+ *
  */
 #ifndef __ATTOHTTP_H__
 #define __ATTOHTTP_H__
@@ -97,6 +183,60 @@
 #ifndef ATTOHTTP_API_LEVELS
 # define ATTOHTTP_API_LEVELS 3
 #endif
+#ifndef ATTOHTTP_URL_PARAMS
+# define ATTOHTTP_URL_PARAMS 10
+#endif
+#ifndef ATTOHTTP_BOUNDARY_SIZE
+# define ATTOHTTP_BOUNDARY_SIZE 72
+#endif
+#ifndef ATTOHTTP_MULTIPART_BUFFER_SIZE
+# define ATTOHTTP_MULTIPART_BUFFER_SIZE (2 * (ATTOHTTP_BOUNDARY_SIZE + 4))
+#endif
+#ifndef ATTOHTTP_SSE_SUBSCRIBERS
+# define ATTOHTTP_SSE_SUBSCRIBERS 4
+#endif
+#ifndef ATTOHTTP_SSE_STREAMS
+# define ATTOHTTP_SSE_STREAMS 4
+#endif
+#ifndef ATTOHTTP_SSE_RING_SIZE
+# define ATTOHTTP_SSE_RING_SIZE 512
+#endif
+#ifndef ATTOHTTP_SSE_HISTORY
+# define ATTOHTTP_SSE_HISTORY 16
+#endif
+#ifndef ATTOHTTP_SSE_HIGH_WATER
+# define ATTOHTTP_SSE_HIGH_WATER ATTOHTTP_SSE_RING_SIZE
+#endif
+#ifndef ATTOHTTP_SSE_FLUSH_WINDOW
+# define ATTOHTTP_SSE_FLUSH_WINDOW 20
+#endif
+#ifndef ATTOHTTP_SSE_HEARTBEAT
+# define ATTOHTTP_SSE_HEARTBEAT 15000
+#endif
+#ifndef ATTOHTTP_SSE_QUEUE_SLOTS
+# define ATTOHTTP_SSE_QUEUE_SLOTS 16
+#endif
+#ifndef ATTOHTTP_SSE_QUEUE_EVENT_SIZE
+# define ATTOHTTP_SSE_QUEUE_EVENT_SIZE 128
+#endif
+#ifndef ATTOHTTP_WEBSOCKETS
+# define ATTOHTTP_WEBSOCKETS 2
+#endif
+#ifndef ATTOHTTP_WEBSOCKET_ROUTES
+# define ATTOHTTP_WEBSOCKET_ROUTES 2
+#endif
+#ifndef ATTOHTTP_WEBSOCKET_BUFFER_SIZE
+# define ATTOHTTP_WEBSOCKET_BUFFER_SIZE 256
+#endif
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_BITS
+# define ATTOHTTP_WEBSOCKET_DEFLATE_BITS 10
+#endif
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_CHAIN
+# define ATTOHTTP_WEBSOCKET_DEFLATE_CHAIN 8
+#endif
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_MIN
+# define ATTOHTTP_WEBSOCKET_DEFLATE_MIN 16
+#endif
 #ifndef ATTOHTTP_READ_TIMEOUT
 # define ATTOHTTP_READ_TIMEOUT 500
 #endif
@@ -106,6 +246,87 @@
 #ifndef ATTOHTTP_AUTH_ERROR_MSG
 # define ATTOHTTP_AUTH_ERROR_MSG "<!DOCTYPE html><html><head><title>Invalid Request</title></head><body><h1>Invalid Request</h1></body></html>"
 #endif
+#ifndef ATTOHTTP_AUTH_USERS
+# define ATTOHTTP_AUTH_USERS 8
+#endif
+#ifndef ATTOHTTP_AUTH_USER_SIZE
+# define ATTOHTTP_AUTH_USER_SIZE 32
+#endif
+#ifndef ATTOHTTP_DIGEST_NONCES
+# define ATTOHTTP_DIGEST_NONCES 8
+#endif
+#ifndef ATTOHTTP_DIGEST_NONCE_LIFETIME
+# define ATTOHTTP_DIGEST_NONCE_LIFETIME 300
+#endif
+#ifndef ATTOHTTP_DIGEST_CNONCE_SIZE
+# define ATTOHTTP_DIGEST_CNONCE_SIZE 64
+#endif
+#ifndef ATTOHTTP_AUTH_TIME
+# define ATTOHTTP_AUTH_TIME() ((uint32_t)time(NULL))
+#endif
+#ifndef ATTOHTTP_DIGEST_TIME
+# define ATTOHTTP_DIGEST_TIME() ATTOHTTP_AUTH_TIME()
+#endif
+#ifndef ATTOHTTP_AUTH_SESSIONS
+# define ATTOHTTP_AUTH_SESSIONS 16
+#endif
+#ifndef ATTOHTTP_AUTH_SESSION_LIFETIME
+# define ATTOHTTP_AUTH_SESSION_LIFETIME 900
+#endif
+#ifndef ATTOHTTP_AUTH_SESSION_COOKIE
+# define ATTOHTTP_AUTH_SESSION_COOKIE "attoHTTPSession"
+#endif
+#ifndef ATTOHTTP_AUTH_ROUTES
+# define ATTOHTTP_AUTH_ROUTES 4
+#endif
+#ifndef ATTOHTTP_RATE_PEERS
+# define ATTOHTTP_RATE_PEERS 16
+#endif
+#ifndef ATTOHTTP_RATE_BURST
+# define ATTOHTTP_RATE_BURST 10
+#endif
+#ifndef ATTOHTTP_RATE_PER_SEC
+# define ATTOHTTP_RATE_PER_SEC 5
+#endif
+#ifndef ATTOHTTP_RATE_CONNECTIONS
+# define ATTOHTTP_RATE_CONNECTIONS 2
+#endif
+#ifndef ATTOHTTP_RATE_RETRY_AFTER
+# define ATTOHTTP_RATE_RETRY_AFTER 1
+#endif
+#ifndef ATTOHTTP_SHED_CONNECTIONS
+# define ATTOHTTP_SHED_CONNECTIONS 16
+#endif
+#ifndef ATTOHTTP_SHED_QUEUE
+# define ATTOHTTP_SHED_QUEUE 4
+#endif
+#ifndef ATTOHTTP_SHED_BACKLOG
+# define ATTOHTTP_SHED_BACKLOG 16
+#endif
+#ifndef ATTOHTTP_SHED_RETRY_AFTER
+# define ATTOHTTP_SHED_RETRY_AFTER 5
+#endif
+#ifndef ATTOHTTP_REQUEST_QUEUE_API
+# define ATTOHTTP_REQUEST_QUEUE_API 4
+#endif
+#ifndef ATTOHTTP_REQUEST_QUEUE_STATIC
+# define ATTOHTTP_REQUEST_QUEUE_STATIC 4
+#endif
+#ifndef ATTOHTTP_REQUEST_QUEUE_STREAK
+# define ATTOHTTP_REQUEST_QUEUE_STREAK 8
+#endif
+#ifndef ATTOHTTP_DEADLINE_LINE
+# define ATTOHTTP_DEADLINE_LINE 2000
+#endif
+#ifndef ATTOHTTP_DEADLINE_HEADERS
+# define ATTOHTTP_DEADLINE_HEADERS 5000
+#endif
+#ifndef ATTOHTTP_DEADLINE_REQUEST
+# define ATTOHTTP_DEADLINE_REQUEST 10000
+#endif
+#ifndef ATTOHTTP_DEADLINE_BODY_RATE
+# define ATTOHTTP_DEADLINE_BODY_RATE 2048
+#endif
 
 #define HTTP_METHOD_GET "GET"
 #define HTTP_METHOD_PUT "PUT"
@@ -120,6 +341,11 @@
 
 #define HTTPEOL "\r\n"
 
+/** attoHTTPBodyLeft() returns this if the client didn't send a Content-Length */
+#define ATTOHTTP_LENGTH_UNKNOWN 0xFFFFFFFF
+/** Use this as the stream to publish to every server sent events stream */
+#define SSE_ALL_STREAMS -1
+
 
 #ifndef ATTOHTTP_PAGE_URL_SIZE
 #  define ATTOHTTP_PAGE_URL_SIZE 32
@@ -135,13 +361,17 @@
 typedef enum
 {
     STATUS_SERVERSENTEVENTS = 1,
+    STATUS_SWITCHING_PROTOCOLS = 101,
     STATUS_OK = 200,
     STATUS_ACCEPTED = 202,
     STATUS_UNSUPPORTED = 501,
     STATUS_BADREQUEST = 400,
     STATUS_UNAUTHORIZED = 401,
+    STATUS_REQUEST_TIMEOUT = 408,
     STATUS_INTERNAL_ERROR = 500,
+    STATUS_SERVICE_UNAVAILABLE = 503,
     STATUS_NOT_FOUND = 404,
+    STATUS_TOO_MANY_REQUESTS = 429,
     STATUS_RUNKNOWN = 510
 } returncode_t;
 /**
@@ -158,6 +388,21 @@ typedef enum
 } authtype_t;
 #define ATTOHTTP_AUTH_TYPES 2
 
+/**
+ * @brief The kind of request, for deciding which one to serve first
+ *
+ *  * `REQUEST_PENDING` Not enough of the request line is in yet.
+ *  * `REQUEST_API`     REST calls, server sent events, and WebSockets.
+ *  * `REQUEST_STATIC`  Pages, and anything that will only get an error.
+ */
+typedef enum
+{
+    REQUEST_PENDING = -1,
+    REQUEST_API = 0,
+    REQUEST_STATIC = 1
+} requestclass_t;
+#define ATTOHTTP_REQUEST_CLASSES 2
+
 /**
  * @brief These are the different HTTP methods
  *
@@ -199,23 +444,67 @@ typedef enum
     APPLICATION_JAVASCRIPT = 4,
     APPLICATION_XWWWFORMURLENCODED = 5,
     IMAGE_PNG = 6,
-    TEXT_EVENTSTREAM = 7
+    TEXT_EVENTSTREAM = 7,
+    MULTIPART_FORMDATA = 8
 
 } mimetypes_t;
 #define ATTOHTTP_MIME_TYPES 7
 
+/**
+ * @brief What to do with a server sent events subscriber that falls behind
+ *
+ * This is used when a subscriber has more than the high water mark of data
+ * waiting to go out to it.
+ *  * `SSE_DISCONNECT`  Drop the subscriber.
+ *  * `SSE_DROP_OLDEST` Skip the oldest events until it is under the mark.
+ *  * `SSE_COALESCE`    Skip events that have a newer event with the same name.
+ */
+typedef enum
+{
+    SSE_DISCONNECT,
+    SSE_DROP_OLDEST,
+    SSE_COALESCE
+} ssepolicy_t;
+/**
+ * @brief Whether a page or REST route needs authentication
+ *
+ * This only matters if ATTOHTTP_BASIC_AUTH or ATTOHTTP_DIGEST_AUTH is set.
+ *  * `AUTH_REQUIRED` The client has to authenticate.  This is the default.
+ *  * `AUTH_NONE`     Anybody can get it, and no credentials are checked.
+ */
+typedef enum
+{
+    AUTH_REQUIRED,
+    AUTH_NONE
+} authpolicy_t;
+/**
+ * @brief The WebSocket frame opcodes from RFC 6455
+ */
+typedef enum
+{
+    WS_CONTINUATION = 0x0,
+    WS_TEXT = 0x1,
+    WS_BINARY = 0x2,
+    WS_CLOSE = 0x8,
+    WS_PING = 0x9,
+    WS_PONG = 0xA
+} wsopcode_t;
+
 typedef returncode_t (*attoHTTPDefAPICallback)(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl);
 
 /**
  * @brief This keeps track of our pages
  *
- * This struct keeps track of pages and what to load for them.
+ * This struct keeps track of pages and what to load for them.  stream is
+ * the server sent events stream for TEXT_EVENTSTREAM pages.
  */
 typedef struct {
     char url[ATTOHTTP_PAGE_URL_SIZE];
     const uint8_t *content;
     uint32_t size;
     mimetypes_t type;
+    authpolicy_t auth;
+    int8_t stream;
 } attoHTTPPage_t;
 
 /**
@@ -230,6 +519,220 @@ typedef struct _attoHTTPRestAPI {
     mimetypes_t type;
 } attoHTTPRestAPI_t;
 
+/**
+ * @brief A single decoded URL parameter
+ *
+ * The name and value point back into the URL buffer, and are only valid
+ * for the request that is currently being served.  Both are NULL terminated.
+ * value is NULL if the parameter had no '=' in it.
+ */
+typedef struct {
+    const char *name;
+    const char *value;
+    uint16_t name_len;
+    uint16_t value_len;
+} attoHTTPParam_t;
+
+/**
+ * @brief Callback for each header of a multipart/form-data part
+ *
+ * @param part  The number of the part, starting at 0
+ * @param name  The header name, NULL terminated
+ * @param value The header value, NULL terminated
+ *
+ * @return 1 to keep going, 0 to stop parsing
+ */
+typedef uint8_t (*attoHTTPMultipartHeaderCallback)(uint16_t part, const char *name, const char *value);
+/**
+ * @brief Callback for the body of a multipart/form-data part
+ *
+ * This is called as many times as it takes to hand over the whole body of
+ * the part.  last is set on the final call for each part.
+ *
+ * @param part The number of the part, starting at 0
+ * @param data The data
+ * @param len  The number of bytes in data
+ * @param last 1 if this is the end of the part, 0 otherwise
+ *
+ * @return 1 to keep going, 0 to stop parsing
+ */
+typedef uint8_t (*attoHTTPMultipartDataCallback)(uint16_t part, const uint8_t *data, uint16_t len, uint8_t last);
+
+/**
+ * @brief Callback for uploaded data
+ *
+ * @param data   The block of data
+ * @param len    The number of bytes in data
+ * @param offset The number of bytes that came before this block
+ * @param last   1 if this is the last block, 0 otherwise
+ *
+ * @return 1 to keep going, 0 to stop the upload
+ */
+typedef uint8_t (*attoHTTPUploadCallback)(const uint8_t *data, uint16_t len, uint32_t offset, uint8_t last);
+
+/**
+ * @brief Callback to close the connection of a server sent events subscriber
+ *
+ * This is supplied by the wrapper when it adds a subscriber.  It is called
+ * when the subscriber is removed, either because a write to it failed or
+ * because attoHTTPSSERemove() was called.
+ *
+ * @param write The write handle that the subscriber was added with
+ *
+ * @return None
+ */
+typedef void (*attoHTTPSSECloseCallback)(void *write);
+/**
+ * @brief Callback for when a new server sent events subscriber shows up
+ *
+ * @param sub The handle of the new subscriber
+ *
+ * @return None
+ */
+typedef void (*attoHTTPSSESubscribeCallback)(int8_t sub);
+/**
+ * @brief Callback to get the time for server sent events
+ *
+ * @return The time in ms, on the same clock as given to attoHTTPSSEPoll()
+ */
+typedef uint32_t (*attoHTTPSSEClockCallback)(void);
+
+/**
+ * @brief This keeps track of a server sent events subscriber
+ *
+ * write is NULL if the slot is empty.  cursor is the count of bytes from
+ * the event ring buffer that have been sent to this subscriber.  event is
+ * the id of the event that cursor is in.  Everything from cursor to the
+ * head of the ring is this subscriber's queue.  last is the time anything
+ * was last sent to it, and beat is the number of heartbeat bytes that still
+ * need to go out.  stream is the stream that it subscribed to.
+ */
+typedef struct {
+    void *write;
+    attoHTTPSSECloseCallback close;
+    uint32_t cursor;
+    uint32_t event;
+    uint32_t last;
+    uint8_t beat;
+    int8_t stream;
+} attoHTTPSSESubscriber_t;
+
+/**
+ * @brief This keeps track of the settings for a server sent events stream
+ */
+typedef struct {
+    ssepolicy_t policy;
+    uint16_t highwater;
+} attoHTTPSSEStream_t;
+
+/**
+ * @brief This keeps track of where a published event is in the ring
+ *
+ * start is in the same units as the subscriber cursor.  The event name
+ * is name bytes past start, and elen long.  stream is the stream it was
+ * published to, or SSE_ALL_STREAMS.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t start;
+    uint16_t elen;
+    uint8_t name;
+    uint8_t superseded;
+    int8_t stream;
+} attoHTTPSSEHistory_t;
+
+#ifdef ATTOHTTP_WEBSOCKET
+/**
+ * @brief This gets called with each complete WebSocket message
+ *
+ * Fragmented messages are put back together before this is called.  data is
+ * only good until this returns.
+ *
+ * @param ws     The WebSocket handle
+ * @param opcode WS_TEXT or WS_BINARY
+ * @param data   The message
+ * @param len    The length of the message
+ */
+typedef void (*attoHTTPWebSocketCallback)(int8_t ws, wsopcode_t opcode, uint8_t *data, uint16_t len);
+/**
+ * @brief This gets called when a WebSocket connection is done
+ *
+ * @param write The write argument that was given to attoHTTPWebSocketAdd()
+ */
+typedef void (*attoHTTPWebSocketCloseCallback)(void *write);
+/**
+ * @brief A URL that takes WebSocket upgrades
+ */
+typedef struct {
+    char url[ATTOHTTP_PAGE_URL_SIZE];
+    attoHTTPWebSocketCallback callback;
+} attoHTTPWebSocketRoute_t;
+/**
+ * @brief This keeps track of an open WebSocket connection
+ *
+ * Frames are read a piece at a time, as the bytes come in.  state says which
+ * part of the frame header is next, and count how many bytes of that part are
+ * left.  left is how much of the payload hasn't been read yet.  Data frames are
+ * put together in buffer until the last fragment comes in, and control frames
+ * are put in control, since they can come in the middle of a fragmented message.
+ *
+ * If permessage-deflate was set up, deflate is the window bits used for
+ * messages to the client, and compressed says the message coming in needs to
+ * be inflated.  If takeover is set, window has the last bytes sent, so the
+ * next message can point back into them.
+ */
+typedef struct {
+    void *read;
+    void *write;
+    attoHTTPWebSocketCloseCallback close;
+    attoHTTPWebSocketCallback callback;
+    uint32_t left;
+    uint32_t size;
+    uint16_t fill;
+    uint8_t state;
+    uint8_t count;
+    uint8_t frame;
+    uint8_t opcode;
+    uint8_t mask[4];
+    uint8_t control[125];
+    uint8_t buffer[ATTOHTTP_WEBSOCKET_BUFFER_SIZE];
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    uint8_t deflate;
+    uint8_t compressed;
+    uint8_t takeover;
+#ifndef ATTOHTTP_WEBSOCKET_DEFLATE_NO_CONTEXT
+    uint16_t wfill;
+    uint8_t window[1 << ATTOHTTP_WEBSOCKET_DEFLATE_BITS];
+#endif
+#endif
+} attoHTTPWebSocket_t;
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+/**
+ * This is a user in the credential store.  Only HA1, the MD5 of
+ * "user:realm:password", is kept, so the password never has to be on the
+ * device.  hash is the hash of the user name, which picks the slot and saves
+ * comparing names that can't match.
+ */
+typedef struct {
+    char user[ATTOHTTP_AUTH_USER_SIZE];
+    uint8_t ha1[16];
+    uint32_t hash;
+} attoHTTPAuthUser_t;
+#endif
+#ifdef ATTOHTTP_DIGEST_AUTH
+/**
+ * This keeps track of the last nonce count used with one of our nonces.
+ * id is the number that was put in the nonce when it was made.  used says how
+ * long it has been since it was used, so the oldest one can be dropped.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t nc;
+    uint32_t used;
+} attoHTTPDigestNonce_t;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -247,10 +750,85 @@ uint16_t attoHTTPRESTSendHeaders(uint16_t code, char *type, char *headers);
 uint16_t attoHTTPFirstLine(uint16_t code);
 uint8_t attoHTTPParseParam(char *name, uint8_t name_len, char *value, uint8_t value_len);
 uint8_t attoHTTPGetRawParamChar(char *c);
+uint8_t attoHTTPURLParamCount(void);
+const attoHTTPParam_t *attoHTTPURLParamIndex(uint8_t index);
+const char *attoHTTPGetURLParam(const char *name);
+int32_t attoHTTPURLDecode(const uint8_t *input, uint16_t ilen, uint8_t *output, uint16_t olen);
+uint8_t attoHTTPParamError(void);
+uint16_t attoHTTPReadBody(uint8_t *buf, uint16_t len);
+uint32_t attoHTTPBodyLeft(void);
+int32_t attoHTTPUpload(attoHTTPUploadCallback handler, uint8_t *block, uint16_t size);
+int16_t attoHTTPParseMultipart(attoHTTPMultipartHeaderCallback header, attoHTTPMultipartDataCallback data);
 uint8_t attoHTTPServerSetEventsURL(const char *url);
+int8_t attoHTTPSSEAddStream(const char *url);
 uint16_t attoHTTPSendEvent(void *write, char *event, uint16_t elen, char *data, uint16_t dlen);
+int8_t attoHTTPSSEAdd(void *write, attoHTTPSSECloseCallback close);
+uint8_t attoHTTPSSERemove(int8_t sub);
+uint8_t attoHTTPSSECount(void);
+uint8_t attoHTTPSSESetSubscribeCallback(attoHTTPSSESubscribeCallback callback);
+uint16_t attoHTTPSSESend(int8_t sub, char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEBroadcast(char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEBroadcastStream(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEPublish(char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEPublishStream(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEFlush(void);
+uint16_t attoHTTPSSEPending(int8_t sub);
+uint32_t attoHTTPSSELastID(void);
+uint8_t attoHTTPSSESetRetry(uint32_t retry);
+uint8_t attoHTTPSSESetPolicy(int8_t stream, ssepolicy_t policy, uint16_t highwater);
+uint8_t attoHTTPSSEPoll(uint32_t now);
+uint8_t attoHTTPSSESetClock(attoHTTPSSEClockCallback clock);
+returncode_t attoHTTPReject(void *write, returncode_t code);
+#ifdef ATTOHTTP_SSE_QUEUE
+uint8_t attoHTTPSSEQueue(int8_t stream, char *event, uint16_t elen, char *data, uint16_t dlen);
+uint8_t attoHTTPSSEDrain(void);
+#endif
+
+#ifdef ATTOHTTP_WEBSOCKET
+uint8_t attoHTTPAddWebSocket(const char *url, attoHTTPWebSocketCallback callback);
+int8_t attoHTTPWebSocketAdd(void *read, void *write, attoHTTPWebSocketCloseCallback close);
+uint8_t attoHTTPWebSocketRemove(int8_t ws);
+uint8_t attoHTTPWebSocketCount(void);
+int8_t attoHTTPWebSocketRead(int8_t ws);
+uint8_t attoHTTPWebSocketSend(int8_t ws, wsopcode_t opcode, const uint8_t *data, uint16_t len);
+uint8_t attoHTTPWebSocketClose(int8_t ws, uint16_t code);
+#endif
 
-#ifdef ATTOHTTP_BASIC_AUTH
+#ifdef ATTOHTTP_LOAD_SHED
+uint8_t attoHTTPOverloaded(uint16_t queued, uint16_t held);
+#endif
+
+#ifdef ATTOHTTP_REQUEST_QUEUE
+requestclass_t attoHTTPClassify(const uint8_t *line, uint16_t len);
+uint8_t attoHTTPQueueAdd(void *conn, requestclass_t rclass);
+void *attoHTTPQueueNext(void);
+uint8_t attoHTTPQueueCount(void);
+#endif
+
+#ifdef ATTOHTTP_RATE_LIMIT
+uint8_t attoHTTPPeerOpen(uint32_t peer, uint32_t now);
+void attoHTTPPeerClose(uint32_t peer);
+#endif
+
+#ifdef ATTOHTTP_DIGEST_AUTH
+void attoHTTPDigestSecret(const uint8_t *key, uint8_t len);
+#endif
+
+#ifdef ATTOHTTP_AUTH_SESSION
+void attoHTTPSessionClear(void);
+#endif
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_DIGEST_AUTH)
+uint8_t attoHTTPPageAuth(const char *url, authpolicy_t auth);
+uint8_t attoHTTPRESTAuth(const char *url, authpolicy_t auth);
+void attoHTTPAuthHA1(const char *user, const char *password, uint8_t *ha1);
+uint8_t attoHTTPAuthAddUser(const char *user, const uint8_t *ha1);
+#endif
+
+#if defined(ATTOHTTP_BASIC_AUTH) || defined(ATTOHTTP_WEBSOCKET)
+/*
+ * These use SSSE3 or AVX2 when the compiler is targeting them (-mssse3,
+ * -mavx2, -march=native).  Define ATTOHTTP_BASE64_NO_SIMD to keep them scalar.
+ */
 uint16_t attoHTTPBase64Encode(int8_t *input, uint16_t ilen, int8_t *output, uint16_t olen);
 uint16_t attoHTTPBase64Decode(int8_t *input, uint16_t ilen, int8_t *output, uint16_t olen);
 
@@ -45,6 +45,8 @@
 #ifndef HAVE_OPENSSL
 
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 
 #include "md5.h"
 
@@ -73,13 +75,17 @@
  * SET reads 4 input bytes in little-endian byte order and stores them
  * in a properly aligned word in host byte order.
  *
- * The check for little-endian architectures that tolerate unaligned
- * memory accesses is just an optimization.  Nothing will break if it
- * doesn't work.
+ * On little-endian hosts where MD5_u32plus is exactly 32 bits the input
+ * already is the words.  Aligned input is read in place, and unaligned
+ * input is copied into ctx->block once per block, so the words never get
+ * put together a byte at a time.  That also keeps parts that can't do
+ * unaligned loads, like the Cortex-M0, on word loads.
  */
-#if defined(__i386__) || defined(__x86_64__) || defined(__vax__)
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && \
+	(UINT_MAX == 0xffffffff)
+#define MD5_WORDS
 #define SET(n) \
-	(*(MD5_u32plus *)&ptr[(n) * 4])
+	(words[(n)])
 #define GET(n) \
 	SET(n)
 #else
@@ -102,8 +108,15 @@ static const void *body(MD5_CTX *ctx, const void *data, unsigned long size)
 	const unsigned char *ptr;
 	MD5_u32plus a, b, c, d;
 	MD5_u32plus saved_a, saved_b, saved_c, saved_d;
+#ifdef MD5_WORDS
+	const MD5_u32plus *words;
+	int aligned;
+#endif
 
 	ptr = (const unsigned char *)data;
+#ifdef MD5_WORDS
+	aligned = ((uintptr_t)ptr & (sizeof(MD5_u32plus) - 1)) == 0;
+#endif
 
 	a = ctx->a;
 	b = ctx->b;
@@ -116,6 +129,15 @@ static const void *body(MD5_CTX *ctx, const void *data, unsigned long size)
 		saved_c = c;
 		saved_d = d;
 
+#ifdef MD5_WORDS
+		if (aligned) {
+			words = (const MD5_u32plus *)ptr;
+		} else {
+			memcpy(ctx->block, ptr, 64);
+			words = ctx->block;
+		}
+#endif
+
 /* Round 1 */
 		STEP(F, a, b, c, d, SET(0), 0xd76aa478, 7)
 		STEP(F, d, a, b, c, SET(1), 0xe8c7b756, 12)
@@ -301,3 +323,85 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 }
 
 #endif
+
+#include <string.h>
+
+#include "md5.h"
+
+/*
+ * The state after a pad block is all that is kept, and the block count is
+ * put back by hand.  With OpenSSL the whole context is kept instead, since
+ * its insides are named differently.
+ */
+#ifdef HAVE_OPENSSL
+#define HMAC_SAVE(state, ctx) \
+	(state) = (ctx);
+#define HMAC_LOAD(ctx, state) \
+	(ctx) = (state);
+#else
+#define HMAC_SAVE(state, ctx) \
+	(state)[0] = (ctx).a; \
+	(state)[1] = (ctx).b; \
+	(state)[2] = (ctx).c; \
+	(state)[3] = (ctx).d;
+#define HMAC_LOAD(ctx, state) \
+	(ctx).a = (state)[0]; \
+	(ctx).b = (state)[1]; \
+	(ctx).c = (state)[2]; \
+	(ctx).d = (state)[3]; \
+	(ctx).lo = 64; \
+	(ctx).hi = 0;
+#endif
+
+void MD5_HMAC_Key(MD5_HMAC_KEY *key, const void *secret, unsigned long size)
+{
+	unsigned char pad[64];
+	MD5_CTX ctx;
+	unsigned int i;
+
+	memset(pad, 0, sizeof(pad));
+	if (size > sizeof(pad)) {
+		MD5_Init(&ctx);
+		MD5_Update(&ctx, secret, size);
+		MD5_Final(pad, &ctx);
+	} else if (size) {
+		memcpy(pad, secret, size);
+	}
+
+	for (i = 0; i < sizeof(pad); i++)
+		pad[i] ^= 0x36;
+	MD5_Init(&ctx);
+	MD5_Update(&ctx, pad, sizeof(pad));
+	HMAC_SAVE(key->inner, ctx)
+
+	for (i = 0; i < sizeof(pad); i++)
+		pad[i] ^= 0x36 ^ 0x5c;
+	MD5_Init(&ctx);
+	MD5_Update(&ctx, pad, sizeof(pad));
+	HMAC_SAVE(key->outer, ctx)
+
+	memset(pad, 0, sizeof(pad));
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+void MD5_HMAC_Init(MD5_HMAC_CTX *ctx, const MD5_HMAC_KEY *key)
+{
+	ctx->key = key;
+	HMAC_LOAD(ctx->md5, key->inner)
+}
+
+void MD5_HMAC_Update(MD5_HMAC_CTX *ctx, const void *data, unsigned long size)
+{
+	MD5_Update(&ctx->md5, data, size);
+}
+
+void MD5_HMAC_Final(unsigned char *result, MD5_HMAC_CTX *ctx)
+{
+	const MD5_HMAC_KEY *key = ctx->key;
+
+	MD5_Final(result, &ctx->md5);
+	HMAC_LOAD(ctx->md5, key->outer)
+	MD5_Update(&ctx->md5, result, 16);
+	MD5_Final(result, &ctx->md5);
+	ctx->key = NULL;
+}
@@ -50,3 +50,31 @@ extern void MD5_Update(MD5_CTX *ctx, const void *data, unsigned long size);
 extern void MD5_Final(unsigned char *result, MD5_CTX *ctx);
 
 #endif
+
+#ifndef _MD5_HMAC_H
+#define _MD5_HMAC_H
+
+/*
+ * HMAC-MD5 (RFC 2104).  MD5_HMAC_Key() hashes the key's inner and outer
+ * pads once, and every MAC after that starts from those states, so it costs
+ * two fewer MD5 blocks than doing the pads each time.
+ */
+typedef struct {
+#ifdef HAVE_OPENSSL
+	MD5_CTX inner, outer;
+#else
+	MD5_u32plus inner[4], outer[4];
+#endif
+} MD5_HMAC_KEY;
+
+typedef struct {
+	MD5_CTX md5;
+	const MD5_HMAC_KEY *key;
+} MD5_HMAC_CTX;
+
+extern void MD5_HMAC_Key(MD5_HMAC_KEY *key, const void *secret, unsigned long size);
+extern void MD5_HMAC_Init(MD5_HMAC_CTX *ctx, const MD5_HMAC_KEY *key);
+extern void MD5_HMAC_Update(MD5_HMAC_CTX *ctx, const void *data, unsigned long size);
+extern void MD5_HMAC_Final(unsigned char *result, MD5_HMAC_CTX *ctx);
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * @file    src/sha1.c
+ * @brief   SHA-1 message digest (FIPS 180-4)
+ * @details
+ *
+ * This was written for attoHTTP straight from FIPS 180-4.  No code from any
+ * other SHA-1 implementation was used.  It is under the same license as the
+ * rest of attoHTTP.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/*
+ * This has the same interface as md5.c, which is the same as OpenSSL's.  It
+ * is only used for the WebSocket handshake, so it is written to be small
+ * rather than as fast as possible.  attohttp.c includes this file when
+ * ATTOHTTP_WEBSOCKET is set, so the names here are kept out of the way of
+ * the ones in md5.c.
+ */
+
+#ifndef HAVE_OPENSSL
+
+#include <string.h>
+
+#include "sha1.h"
+
+#define SHA1_ROL(x, n)			(((x) << (n)) | ((x) >> (32 - (n))))
+
+/*
+ * This reads 4 bytes in big-endian byte order.
+ */
+#define SHA1_GET(p) \
+	(((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+	((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+
+/*
+ * This processes one 64 byte block.  The message schedule is kept in a 16
+ * word ring instead of all 80 words.
+ */
+static void sha1_body(SHA1_CTX *ctx, const unsigned char *data)
+{
+	uint32_t w[16];
+	uint32_t a, b, c, d, e, f, k, t;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = SHA1_GET(&data[i * 4]);
+
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+
+	for (i = 0; i < 80; i++) {
+		if (i >= 16) {
+			t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+			w[i & 15] = SHA1_ROL(t, 1);
+		}
+		if (i < 20) {
+			f = d ^ (b & (c ^ d));
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (d & (b | c));
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		t = SHA1_ROL(a, 5) + f + e + k + w[i & 15];
+		e = d;
+		d = c;
+		c = SHA1_ROL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+}
+
+void SHA1_Init(SHA1_CTX *ctx)
+{
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->state[4] = 0xc3d2e1f0;
+
+	ctx->lo = 0;
+	ctx->hi = 0;
+}
+
+void SHA1_Update(SHA1_CTX *ctx, const void *data, unsigned long size)
+{
+	const unsigned char *ptr = (const unsigned char *)data;
+	uint32_t saved_lo;
+	unsigned long used, available;
+
+	saved_lo = ctx->lo;
+	if ((ctx->lo = (saved_lo + size) & 0x1fffffff) < saved_lo)
+		ctx->hi++;
+	ctx->hi += size >> 29;
+
+	used = saved_lo & 0x3f;
+
+	if (used) {
+		available = 64 - used;
+
+		if (size < available) {
+			memcpy(&ctx->buffer[used], ptr, size);
+			return;
+		}
+
+		memcpy(&ctx->buffer[used], ptr, available);
+		ptr += available;
+		size -= available;
+		sha1_body(ctx, ctx->buffer);
+	}
+
+	while (size >= 64) {
+		sha1_body(ctx, ptr);
+		ptr += 64;
+		size -= 64;
+	}
+
+	memcpy(ctx->buffer, ptr, size);
+}
+
+void SHA1_Final(unsigned char *result, SHA1_CTX *ctx)
+{
+	unsigned long used, available;
+	int i;
+
+	used = ctx->lo & 0x3f;
+
+	ctx->buffer[used++] = 0x80;
+
+	available = 64 - used;
+
+	if (available < 8) {
+		memset(&ctx->buffer[used], 0, available);
+		sha1_body(ctx, ctx->buffer);
+		used = 0;
+		available = 64;
+	}
+
+	memset(&ctx->buffer[used], 0, available - 8);
+
+	/* The length goes at the end in bits, big-endian */
+	ctx->hi = (ctx->hi << 3) | (ctx->lo >> 29);
+	ctx->lo <<= 3;
+	ctx->buffer[56] = ctx->hi >> 24;
+	ctx->buffer[57] = ctx->hi >> 16;
+	ctx->buffer[58] = ctx->hi >> 8;
+	ctx->buffer[59] = ctx->hi;
+	ctx->buffer[60] = ctx->lo >> 24;
+	ctx->buffer[61] = ctx->lo >> 16;
+	ctx->buffer[62] = ctx->lo >> 8;
+	ctx->buffer[63] = ctx->lo;
+
+	sha1_body(ctx, ctx->buffer);
+
+	for (i = 0; i < 5; i++) {
+		result[i * 4] = ctx->state[i] >> 24;
+		result[(i * 4) + 1] = ctx->state[i] >> 16;
+		result[(i * 4) + 2] = ctx->state[i] >> 8;
+		result[(i * 4) + 3] = ctx->state[i];
+	}
+
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+#undef SHA1_ROL
+#undef SHA1_GET
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * @file    src/sha1.h
+ * @brief   SHA-1 message digest (FIPS 180-4)
+ * @details
+ *
+ * This was written for attoHTTP straight from FIPS 180-4.  No code from any
+ * other SHA-1 implementation was used.  It is under the same license as the
+ * rest of attoHTTP.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifdef HAVE_OPENSSL
+#include <openssl/sha.h>
+#define SHA1_CTX SHA_CTX
+#define SHA1_DIGEST_LENGTH SHA_DIGEST_LENGTH
+#elif !defined(_SHA1_H)
+#define _SHA1_H
+
+#include <stdint.h>
+
+/** The length of a SHA-1 digest in bytes */
+#define SHA1_DIGEST_LENGTH 20
+
+typedef struct {
+	uint32_t state[5];
+	uint32_t lo, hi;
+	unsigned char buffer[64];
+} SHA1_CTX;
+
+extern void SHA1_Init(SHA1_CTX *ctx);
+extern void SHA1_Update(SHA1_CTX *ctx, const void *data, unsigned long size);
+extern void SHA1_Final(unsigned char *result, SHA1_CTX *ctx);
+
+#endif
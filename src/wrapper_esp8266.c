@@ -51,12 +51,18 @@
 // Listening connection stuff
 static struct espconn attoHTTPServer;
 static esp_tcp attoHTTPTcp;
+// This runs the timed server sent events work
+static os_timer_t attoHTTPSSETimer;
 
 typedef struct attoHTTPConnections {
     char *buffer;
     uint16_t length;
     uint16_t ptr;
     uint8_t active;
+    int8_t sse;
+#ifdef ATTOHTTP_RATE_LIMIT
+    uint32_t peer;
+#endif
 } attoHTTPConnections_t;
 
 attoHTTPConnections_t esp8266Connections[ATTO_MAX_CONN];
@@ -67,17 +73,69 @@ attoHTTPClearServerBuffer(attoHTTPConnections_t *conn)
     conn->active = 0;
     conn->length = 0;
     conn->ptr = 0;
+    conn->sse = -1;
+}
+
+/**
+ * @brief Closes a server sent events connection
+ *
+ * This is the close callback given to attoHTTPSSEAdd().
+ *
+ * @param write The espconn for the connection
+ *
+ * @return None
+ */
+void ICACHE_FLASH_ATTR
+attoHTTPSSEClosecb(void *write)
+{
+    struct espconn *conn = (struct espconn *)write;
+    attoHTTPConnections_t *cdata = conn->reverse;
+    if (cdata != NULL) {
+        cdata->sse = -1;
+        espconn_disconnect(conn);
+    }
+}
+
+/**
+ * @brief Clock for the server sent events
+ *
+ * @return The time in ms
+ */
+uint32_t ICACHE_FLASH_ATTR
+attoHTTPSSEClockcb(void)
+{
+    return system_get_time() / 1000;
+}
+/**
+ * @brief Timer callback for the server sent events
+ *
+ * @param arg Not used
+ *
+ * @return None
+ */
+void ICACHE_FLASH_ATTR
+attoHTTPSSETimercb(void *arg)
+{
+    attoHTTPSSEPoll(attoHTTPSSEClockcb());
 }
 
 void ICACHE_FLASH_ATTR
 attoHTTPDisconnectcb(void *arg)
 {
     struct espconn *conn = (struct espconn *)arg;
-    if (conn->reverse != NULL) {
-        attoHTTPClearServerBuffer(conn->reverse);
+    attoHTTPConnections_t *cdata = conn->reverse;
+    int8_t sub;
+    if (cdata != NULL) {
+        sub = cdata->sse;
+#ifdef ATTOHTTP_RATE_LIMIT
+        attoHTTPPeerClose(cdata->peer);
+#endif
+        attoHTTPClearServerBuffer(cdata);
+        // Clear this first so that the close callback doesn't disconnect again
+        conn->reverse = NULL;
+        attoHTTPSSERemove(sub);
     }
     espconn_disconnect(conn);
-    conn->reverse = NULL;
 }
 
 void ICACHE_FLASH_ATTR
@@ -91,23 +149,51 @@ attoHTTPRecvcb(void *arg, char *data, uint16_t len)
     cdata->buffer = data;
     cdata->length = len;
     cdata->ptr = 0;
-    attoHTTPExecute((void *)&conn, (void *)&conn);
+    if (attoHTTPExecute((void *)conn, (void *)conn) == STATUS_SERVERSENTEVENTS) {
+        // The espconn stays put until the disconnect callback, so it can be kept
+        cdata->sse = attoHTTPSSEAdd((void *)conn, attoHTTPSSEClosecb);
+        if (cdata->sse < 0) {
+            espconn_disconnect(conn);
+        }
+    }
 }
 
+/**
+ * @brief Takes in a new connection
+ *
+ * If ATTOHTTP_RATE_LIMIT is set, a client that is over its limit is hung up
+ * on without a 429.  Nothing has been sent yet at this point, and a 429
+ * sent here would be cut off by the disconnect.
+ *
+ * @param arg The espconn for the connection
+ *
+ * @return None
+ */
 void ICACHE_FLASH_ATTR
 attoHTTPConnectcb(void *arg)
 {
     struct espconn *conn = (struct espconn *)arg;
     uint16_t i;
+#ifdef ATTOHTTP_RATE_LIMIT
+    uint8_t *ip = conn->proto.tcp->remote_ip;
+    uint32_t peer = ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) | ((uint32_t)ip[2] << 8) | ip[3];
+#endif
     for (i = 0; i < ATTO_MAX_CONN; i++) {
         if (esp8266Connections[i].active == 0) {
             break;
         }
     }
-    if (i > ATTO_MAX_CONN) {
+    if ((i >= ATTO_MAX_CONN)
+#ifdef ATTOHTTP_RATE_LIMIT
+        || !attoHTTPPeerOpen(peer, attoHTTPSSEClockcb())
+#endif
+        ) {
         espconn_disconnect(conn);
         conn->reverse = NULL;
     } else {
+#ifdef ATTOHTTP_RATE_LIMIT
+        esp8266Connections[i].peer = peer;
+#endif
         //espconn's have a extra flag you can associate extra information with a connection.
         conn->reverse = &esp8266Connections[i];
 
@@ -133,6 +219,7 @@ attoHTTPWrapperInit(uint16_t port)
     uint16_t i;
 
     attoHTTPInit();
+    attoHTTPSSESetClock(attoHTTPSSEClockcb);
     attoHTTPServer.type = ESPCONN_TCP;
     attoHTTPServer.state = ESPCONN_NONE;
 
@@ -148,6 +235,10 @@ attoHTTPWrapperInit(uint16_t port)
     for (i = 0; i < ATTO_MAX_CONN; i++) {
         attoHTTPClearServerBuffer(&esp8266Connections[i]);
     }
+
+    os_timer_disarm(&attoHTTPSSETimer);
+    os_timer_setfn(&attoHTTPSSETimer, (os_timer_func_t *)attoHTTPSSETimercb, NULL);
+    os_timer_arm(&attoHTTPSSETimer, ATTOHTTP_SSE_FLUSH_WINDOW, 1);
 }
 /**
  * @brief The main function for the wrapper
@@ -174,6 +265,7 @@ attoHTTPWrapperMain(uint8_t setup)
 void ICACHE_FLASH_ATTR
 attoHTTPWrapperEnd(void)
 {
+    os_timer_disarm(&attoHTTPSSETimer);
 }
 
 /**
@@ -206,6 +298,33 @@ attoHTTPGetByte(void *read, uint8_t *byte) {
     cdata->ptr++;
     return 1;
 }
+/**
+ * @brief User function to get a block of bytes
+ *
+ * This is used to read the body of the request if ATTOHTTP_BULK_READ is set.
+ *
+ * @param read This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to the execute routine.
+ * @param buf   The buffer to put the bytes in
+ * @param len   The most bytes to read
+ *
+ * @return The number of bytes read, 0 if there are none
+ */
+int16_t
+attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len) {
+    struct espconn *conn = (struct espconn *)read;
+    if (conn->reverse == NULL) {
+        return 0;
+    }
+    attoHTTPConnections_t *cdata = conn->reverse;
+    if (len > (cdata->length - cdata->ptr)) {
+        len = cdata->length - cdata->ptr;
+    }
+    os_memcpy(buf, &cdata->buffer[cdata->ptr], len);
+    cdata->ptr += len;
+    return len;
+}
 /**
  * @brief User function to set a byte
  *
@@ -228,3 +347,31 @@ attoHTTPSetByte(void *write, uint8_t byte)
     }
     return (espconn_send(conn, &byte, 1) == 0);
 }
+/**
+ * @brief User function to set a block of bytes
+ *
+ * This is used to send server sent events if ATTOHTTP_BULK_WRITE is set.
+ *
+ * @param write This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to attoHTTPSSEAdd().
+ * @param buf   The bytes to write
+ * @param len   The number of bytes in buf
+ *
+ * @return The number of bytes written, -1 on error
+ */
+int16_t
+attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len)
+{
+    struct espconn *conn = (struct espconn *)write;
+    int8_t ret;
+    if (conn->reverse == NULL) {
+        return -1;
+    }
+    ret = espconn_send(conn, (uint8 *)buf, len);
+    if (ret == ESPCONN_MAXNUM) {
+        // The send buffer is full.  The rest goes out on the next flush.
+        return 0;
+    }
+    return (ret == 0) ? len : -1;
+}
@@ -40,7 +40,9 @@ extern "C" {
     void attoHTTPWrapperMain(uint8_t setup);
     void attoHTTPWrapperEnd(void);
     int16_t attoHTTPGetByte(void *read, uint8_t *byte);
+    int16_t attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len);
     uint16_t attoHTTPSetByte(void *write, uint8_t byte);
+    int16_t attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len);
 #ifdef __cplusplus
 }
 #endif
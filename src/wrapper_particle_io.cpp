@@ -37,6 +37,96 @@
 
 /** This is our unix socket */
 TCPServer *w_server;
+/** These are the clients that are held open for server sent events */
+TCPClient w_sse[ATTOHTTP_SSE_SUBSCRIBERS];
+/** This says which of w_sse are in use */
+uint8_t w_sse_used[ATTOHTTP_SSE_SUBSCRIBERS];
+#ifdef ATTOHTTP_RATE_LIMIT
+/** This is the address of the client that is being served */
+uint32_t w_peer;
+/** These are the addresses of the clients in w_sse */
+uint32_t w_sse_peer[ATTOHTTP_SSE_SUBSCRIBERS];
+#endif
+
+/**
+ * @brief Closes a server sent events client
+ *
+ * This is the close callback given to attoHTTPSSEAdd().
+ *
+ * @param write Pointer to the client in w_sse
+ *
+ * @return None
+ */
+static void
+attoHTTPWrapperSSEClose(void *write)
+{
+    TCPClient *client = (TCPClient *)write;
+    client->stop();
+    w_sse_used[client - w_sse] = 0;
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPPeerClose(w_sse_peer[client - w_sse]);
+#endif
+}
+/**
+ * @brief Keeps a client open for server sent events
+ *
+ * @param client The client
+ *
+ * @return 1 if the client was kept, 0 if it should be closed
+ */
+static uint8_t
+attoHTTPWrapperSSEKeep(TCPClient &client)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        if (w_sse_used[i] == 0) {
+            w_sse[i] = client;
+            w_sse_used[i] = 1;
+#ifdef ATTOHTTP_RATE_LIMIT
+            w_sse_peer[i] = w_peer;
+#endif
+            if (attoHTTPSSEAdd((void *)&w_sse[i], attoHTTPWrapperSSEClose) >= 0) {
+                return 1;
+            }
+            w_sse_used[i] = 0;
+            break;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief Serves a client, or turns it away
+ *
+ * If ATTOHTTP_RATE_LIMIT is set, a client that is over its limit is sent a
+ * 429 without its request being read.
+ *
+ * @param client The client
+ *
+ * @return None
+ */
+static void
+attoHTTPWrapperServe(TCPClient &client)
+{
+    returncode_t code;
+#ifdef ATTOHTTP_RATE_LIMIT
+    IPAddress ip = client.remoteIP();
+    w_peer = ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) | ((uint32_t)ip[2] << 8) | ip[3];
+    if (!attoHTTPPeerOpen(w_peer, millis())) {
+        attoHTTPReject((void *)&client, STATUS_TOO_MANY_REQUESTS);
+        client.flush();
+        client.stop();
+        return;
+    }
+#endif
+    code = attoHTTPExecute((void *)&client, (void *)&client);
+    client.flush();
+    if ((code != STATUS_SERVERSENTEVENTS) || !attoHTTPWrapperSSEKeep(client)) {
+        client.stop();
+#ifdef ATTOHTTP_RATE_LIMIT
+        attoHTTPPeerClose(w_peer);
+#endif
+    }
+}
 
 /**
  * @brief The init function for the wrapper
@@ -50,7 +140,12 @@ TCPServer *w_server;
 void
 attoHTTPWrapperInit(uint16_t port)
 {
+    uint8_t i;
     attoHTTPInit();
+    attoHTTPSSESetClock(attoHTTPGetMillis);
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        w_sse_used[i] = 0;
+    }
     w_server = new TCPServer(port);
     w_server->begin();
 }
@@ -69,10 +164,9 @@ attoHTTPWrapperMain(uint8_t setup)
 {
     TCPClient client = w_server->available();
     if (client) {
-        attoHTTPExecute((void *)&client, (void *)&client);
-        client.flush();
+        attoHTTPWrapperServe(client);
     }
-    client.stop();
+    attoHTTPSSEPoll(millis());
 
 }
 /**
@@ -85,6 +179,10 @@ attoHTTPWrapperMain(uint8_t setup)
 void
 attoHTTPWrapperEnd(void)
 {
+    int8_t i;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        attoHTTPSSERemove(i);
+    }
     delete w_server;
 }
 
@@ -108,7 +206,7 @@ int16_t
 attoHTTPGetByte(void *read, uint8_t *byte) {
     int16_t ret = 0;
     TCPClient *client = (TCPClient *)read;
-    uint32_t timeout = millis() + 1000;
+    uint32_t timeout = millis() + ATTOHTTP_READ_TIMEOUT;
     int c;
     if (client->connected()) {
         do {
@@ -125,6 +223,35 @@ attoHTTPGetByte(void *read, uint8_t *byte) {
     }
     return ret;
 }
+/**
+ * @brief User function to get a block of bytes
+ *
+ * This is used to read the body of the request if ATTOHTTP_BULK_READ is set.
+ *
+ * @param read This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to the execute routine.
+ * @param buf   The buffer to put the bytes in
+ * @param len   The most bytes to read
+ *
+ * @return The number of bytes read, 0 on timeout, -1 on error
+ */
+int16_t
+attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len) {
+    int16_t ret = 0;
+    TCPClient *client = (TCPClient *)read;
+    uint32_t timeout = millis() + ATTOHTTP_READ_TIMEOUT;
+    if (client->connected()) {
+        do {
+            if (client->available() > 0) {
+                ret = client->read(buf, len);
+            }
+        } while ((ret == 0) && (timeout > millis()));
+    } else {
+        ret = -1;
+    }
+    return ret;
+}
 /**
  * @brief User function to set a byte
  *
@@ -143,3 +270,36 @@ attoHTTPSetByte(void *write, uint8_t byte) {
     TCPClient *client = (TCPClient *)write;
     return client->write((const uint8_t *)&byte, 1);
 }
+/**
+ * @brief User function to set a block of bytes
+ *
+ * This is used to send server sent events if ATTOHTTP_BULK_WRITE is set.
+ *
+ * @param write This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to attoHTTPSSEAdd().
+ * @param buf   The bytes to write
+ * @param len   The number of bytes in buf
+ *
+ * @return The number of bytes written, -1 on error
+ */
+int16_t
+attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len) {
+    TCPClient *client = (TCPClient *)write;
+    if (!client->connected()) {
+        return -1;
+    }
+    return client->write(buf, len);
+}
+/**
+ * @brief User function to get the time
+ *
+ * This is used to time how long clients take to send their requests if
+ * ATTOHTTP_DEADLINE is set, and as the server sent events clock.
+ *
+ * @return The time in ms
+ */
+uint32_t
+attoHTTPGetMillis(void) {
+    return millis();
+}
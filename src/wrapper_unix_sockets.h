@@ -30,6 +30,11 @@
 #ifndef __WRAPPER_UNIX_SOCKETS_H__
 #define __WRAPPER_UNIX_SOCKETS_H__
 
+#if !defined(_DEFAULT_SOURCE) && !defined(_GNU_SOURCE)
+// struct tcp_info and friends are hidden under a strict -std=c11.  This only
+// takes if no system header has been included yet.
+# define _DEFAULT_SOURCE
+#endif
 #include <stdint.h>
 #include <inttypes.h>
 #include <netdb.h>
@@ -42,6 +47,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/un.h>
 #include <sys/time.h>
 #include <time.h>
@@ -51,8 +57,232 @@
 #ifdef __ATTOHTTP_H_DONE__
 // Done include this bit until the attohttp.h file has been included
 
+#if defined(ATTOHTTP_LOAD_SHED)
+/** Connections wait here, so they can be turned away instead of timing out */
+# define ATTOHTTP_LISTEN_BACKLOG ATTOHTTP_SHED_BACKLOG
+#elif defined(ATTOHTTP_REQUEST_QUEUE)
+/** Connections wait here until there is room to hold them */
+# define ATTOHTTP_LISTEN_BACKLOG (ATTOHTTP_REQUEST_QUEUE_API + ATTOHTTP_REQUEST_QUEUE_STATIC)
+#else
+# define ATTOHTTP_LISTEN_BACKLOG 1
+#endif
+#ifndef ATTOHTTP_REJECT_DRAIN
+/** The most bytes of a turned away request that are read and dropped */
+# define ATTOHTTP_REJECT_DRAIN 65536
+#endif
+
 /** This is our unix socket */
 int attoHTTPUnixSock;
+/** These are the sockets that are held open for server sent events */
+int16_t attoHTTPUnixSSESock[ATTOHTTP_SSE_SUBSCRIBERS];
+#ifdef ATTOHTTP_WEBSOCKET
+/** These are the sockets that are held open for WebSockets */
+int16_t attoHTTPUnixWSSock[ATTOHTTP_WEBSOCKETS];
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+/** This is the address of the client that is being served */
+uint32_t attoHTTPUnixPeer;
+/** These are the clients on the sockets in attoHTTPUnixSSESock */
+uint32_t attoHTTPUnixSSEPeer[ATTOHTTP_SSE_SUBSCRIBERS];
+#ifdef ATTOHTTP_WEBSOCKET
+/** These are the clients on the sockets in attoHTTPUnixWSSock */
+uint32_t attoHTTPUnixWSPeer[ATTOHTTP_WEBSOCKETS];
+#endif
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+/** The most sockets that can be held waiting to be served */
+#define ATTOHTTP_UNIX_HELD (ATTOHTTP_REQUEST_QUEUE_API + ATTOHTTP_REQUEST_QUEUE_STATIC)
+/** These are the sockets that are waiting to be served */
+int16_t attoHTTPUnixHeldSock[ATTOHTTP_UNIX_HELD];
+/** These are the bytes of the request line seen on each held socket, or -1 once it is in line */
+int16_t attoHTTPUnixHeldSeen[ATTOHTTP_UNIX_HELD];
+#ifdef ATTOHTTP_RATE_LIMIT
+/** These are the clients on the sockets in attoHTTPUnixHeldSock */
+uint32_t attoHTTPUnixHeldPeer[ATTOHTTP_UNIX_HELD];
+#endif
+/** These are the times in ms that the sockets in attoHTTPUnixHeldSock were accepted */
+uint32_t attoHTTPUnixHeldSince[ATTOHTTP_UNIX_HELD];
+#ifdef ATTOHTTP_DEADLINE
+/** The ms a held socket gets to send its request line */
+# define ATTOHTTP_UNIX_HOLD_LIMIT ATTOHTTP_DEADLINE_LINE
+#else
+/** The ms a held socket gets to send its request line, the same as a single read */
+# define ATTOHTTP_UNIX_HOLD_LIMIT ATTOHTTP_READ_TIMEOUT
+#endif
+#endif
+
+/**
+ * @brief Gets a time in ms that only ever counts up
+ *
+ * @return The time in ms
+ */
+static inline uint32_t
+attoHTTPWrapperMillis(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+#ifdef ATTOHTTP_DEADLINE
+/**
+ * @brief User function to get the time
+ *
+ * This is used to time how long clients take to send their requests.
+ *
+ * @return The time in ms
+ */
+static inline uint32_t
+attoHTTPGetMillis(void)
+{
+    return attoHTTPWrapperMillis();
+}
+#endif
+#ifdef ATTOHTTP_LOAD_SHED
+/**
+ * @brief Gets the number of connections waiting to be accepted
+ *
+ * This only works on Linux, and struct tcp_info needs _DEFAULT_SOURCE or
+ * _GNU_SOURCE.  This file defines _DEFAULT_SOURCE itself, so include it before
+ * any system headers, or build with -D_DEFAULT_SOURCE.  Otherwise this always
+ * returns 0, and only the connections already in flight are counted.
+ *
+ * @return The number of connections, or 0 if it can't be found out
+ */
+static inline uint16_t
+attoHTTPWrapperQueued(void)
+{
+#if defined(__linux__) && defined(TCP_INFO) && (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    // On a listening socket this is the accept queue
+    if (getsockopt(attoHTTPUnixSock, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        return info.tcpi_unacked;
+    }
+#endif
+    return 0;
+}
+/**
+ * @brief Gets the number of sockets held until their request line comes in
+ *
+ * The ones that are already in line are counted by attoHTTPOverloaded().
+ *
+ * @return The number of sockets
+ */
+static inline uint16_t
+attoHTTPWrapperHeld(void)
+{
+    uint16_t count = 0;
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+        if ((attoHTTPUnixHeldSock[i] >= 0) && (attoHTTPUnixHeldSeen[i] >= 0)) {
+            count++;
+        }
+    }
+#endif
+    return count;
+}
+#endif
+/**
+ * @brief Closes a server sent events socket
+ *
+ * This is the close callback given to attoHTTPSSEAdd().
+ *
+ * @param write Pointer to the socket in attoHTTPUnixSSESock
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperSSEClose(void *write)
+{
+    int16_t *sock = (int16_t *)write;
+#ifdef _DEBUG_
+    printf("Closing event connection on socket %d\r\n", *sock);
+#endif
+    close(*sock);
+    *sock = -1;
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPPeerClose(attoHTTPUnixSSEPeer[sock - attoHTTPUnixSSESock]);
+#endif
+}
+/**
+ * @brief Keeps a socket open for server sent events
+ *
+ * @param sock The socket
+ *
+ * @return 1 if the socket was kept, 0 if it should be closed
+ */
+static inline uint8_t
+attoHTTPWrapperSSEKeep(int16_t sock)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        if (attoHTTPUnixSSESock[i] < 0) {
+            attoHTTPUnixSSESock[i] = sock;
+#ifdef ATTOHTTP_RATE_LIMIT
+            attoHTTPUnixSSEPeer[i] = attoHTTPUnixPeer;
+#endif
+            if (attoHTTPSSEAdd((void *)&attoHTTPUnixSSESock[i], attoHTTPWrapperSSEClose) >= 0) {
+                return 1;
+            }
+            attoHTTPUnixSSESock[i] = -1;
+            break;
+        }
+    }
+    return 0;
+}
+#ifdef ATTOHTTP_WEBSOCKET
+/**
+ * @brief Closes a WebSocket socket
+ *
+ * This is the close callback given to attoHTTPWebSocketAdd().
+ *
+ * @param write Pointer to the socket in attoHTTPUnixWSSock
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperWSClose(void *write)
+{
+    int16_t *sock = (int16_t *)write;
+#ifdef _DEBUG_
+    printf("Closing WebSocket connection on socket %d\r\n", *sock);
+#endif
+    close(*sock);
+    *sock = -1;
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPPeerClose(attoHTTPUnixWSPeer[sock - attoHTTPUnixWSSock]);
+#endif
+}
+/**
+ * @brief Keeps a socket open as a WebSocket
+ *
+ * @param sock The socket
+ *
+ * @return 1 if the socket was kept, 0 if it should be closed
+ */
+static inline uint8_t
+attoHTTPWrapperWSKeep(int16_t sock)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        if (attoHTTPUnixWSSock[i] < 0) {
+            attoHTTPUnixWSSock[i] = sock;
+#ifdef ATTOHTTP_RATE_LIMIT
+            attoHTTPUnixWSPeer[i] = attoHTTPUnixPeer;
+#endif
+            // Sockets are freed when their WebSocket is removed, so the
+            // WebSocket handle is always the same as i.
+            if (attoHTTPWebSocketAdd((void *)&attoHTTPUnixWSSock[i], (void *)&attoHTTPUnixWSSock[i], attoHTTPWrapperWSClose) >= 0) {
+                return 1;
+            }
+            attoHTTPUnixWSSock[i] = -1;
+            break;
+        }
+    }
+    return 0;
+}
+#endif
 
 /**
  * @brief The end function for the wrapper
@@ -64,6 +294,28 @@ int attoHTTPUnixSock;
 static inline void
 attoHTTPWrapperEnd(void)
 {
+    int8_t i;
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    uint8_t j;
+#endif
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        attoHTTPSSERemove(i);
+    }
+#ifdef ATTOHTTP_WEBSOCKET
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        attoHTTPWebSocketRemove(i);
+    }
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    while (attoHTTPQueueNext() != NULL) {
+    }
+    for (j = 0; j < ATTOHTTP_UNIX_HELD; j++) {
+        if (attoHTTPUnixHeldSock[j] >= 0) {
+            close(attoHTTPUnixHeldSock[j]);
+            attoHTTPUnixHeldSock[j] = -1;
+        }
+    }
+#endif
     close(attoHTTPUnixSock);
 #ifdef _DEBUG_
     printf("Disconnected from socket %d\r\n", attoHTTPUnixSock);
@@ -83,10 +335,25 @@ static inline void
 attoHTTPWrapperInit(uint16_t port)
 {
     attoHTTPInit();
+    attoHTTPSSESetClock(attoHTTPWrapperMillis);
     struct sockaddr_in server;
     int t;
     int ret = -1;
+    uint8_t i;
     attoHTTPUnixSock = -1;
+    for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+        attoHTTPUnixSSESock[i] = -1;
+    }
+#ifdef ATTOHTTP_WEBSOCKET
+    for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+        attoHTTPUnixWSSock[i] = -1;
+    }
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+        attoHTTPUnixHeldSock[i] = -1;
+    }
+#endif
     if ((attoHTTPUnixSock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
         perror("Socket");
         exit(EXIT_FAILURE);
@@ -104,7 +371,7 @@ attoHTTPWrapperInit(uint16_t port)
         }
     }
     if (ret == 0) {
-        if (listen(attoHTTPUnixSock, 1) < 0) {
+        if (listen(attoHTTPUnixSock, ATTOHTTP_LISTEN_BACKLOG) < 0) {
             perror("listen");
             attoHTTPWrapperEnd();
             exit(EXIT_FAILURE);
@@ -118,6 +385,259 @@ attoHTTPWrapperInit(uint16_t port)
         exit(EXIT_FAILURE);
     }
 }
+/**
+ * @brief Serves a connection, and then closes it unless it is kept open
+ *
+ * @param sock The socket
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperServe(int16_t sock)
+{
+    returncode_t code = attoHTTPExecute((void *)&sock, (void *)&sock);
+    if (((code != STATUS_SERVERSENTEVENTS) || !attoHTTPWrapperSSEKeep(sock))
+#ifdef ATTOHTTP_WEBSOCKET
+        && ((code != STATUS_SWITCHING_PROTOCOLS) || !attoHTTPWrapperWSKeep(sock))
+#endif
+        ) {
+#ifdef _DEBUG_
+        printf("Closing connection on socket %d\r\n", sock);
+#endif
+        close(sock);
+#ifdef ATTOHTTP_RATE_LIMIT
+        attoHTTPPeerClose(attoHTTPUnixPeer);
+#endif
+    }
+}
+/**
+ * @brief Closes a socket that was turned away without reading its request
+ *
+ * Closing a socket with unread data makes Linux send a RST instead of a FIN,
+ * and the client can throw away the rejection before it reads it.  This
+ * sends the FIN first, then drops whatever of the request has already come
+ * in, up to ATTOHTTP_REJECT_DRAIN bytes.  It never waits, since turning
+ * clients away has to stay cheap when the server is overloaded.  Anything
+ * the client sends after this can still get a RST.
+ *
+ * @param sock The socket
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperRejectClose(int16_t sock)
+{
+    char buf[256];
+    uint32_t count = 0;
+    ssize_t ret;
+
+    shutdown(sock, SHUT_WR);
+    while ((count < ATTOHTTP_REJECT_DRAIN) && ((ret = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0)) {
+        count += ret;
+    }
+    close(sock);
+}
+#ifdef ATTOHTTP_REQUEST_QUEUE
+/**
+ * @brief Closes a held socket without serving it
+ *
+ * @param i    The index in attoHTTPUnixHeldSock
+ * @param code The rejection to send, or STATUS_RUNKNOWN to send nothing
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperDrop(uint8_t i, returncode_t code)
+{
+    attoHTTPReject((void *)&attoHTTPUnixHeldSock[i], code);
+#ifdef _DEBUG_
+    printf("Dropping connection on socket %d\r\n", attoHTTPUnixHeldSock[i]);
+#endif
+    attoHTTPWrapperRejectClose(attoHTTPUnixHeldSock[i]);
+    attoHTTPUnixHeldSock[i] = -1;
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPPeerClose(attoHTTPUnixHeldPeer[i]);
+#endif
+}
+/**
+ * @brief Holds a new socket until its request line comes in
+ *
+ * If there is no room to hold it, it is sent a 503 and closed.
+ *
+ * @param sock The socket
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperHold(int16_t sock)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+        if (attoHTTPUnixHeldSock[i] < 0) {
+            break;
+        }
+    }
+    if (i == ATTOHTTP_UNIX_HELD) {
+        attoHTTPReject((void *)&sock, STATUS_SERVICE_UNAVAILABLE);
+        attoHTTPWrapperRejectClose(sock);
+#ifdef ATTOHTTP_RATE_LIMIT
+        attoHTTPPeerClose(attoHTTPUnixPeer);
+#endif
+        return;
+    }
+    attoHTTPUnixHeldSock[i] = sock;
+    attoHTTPUnixHeldSeen[i] = 0;
+    attoHTTPUnixHeldSince[i] = attoHTTPWrapperMillis();
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPUnixHeldPeer[i] = attoHTTPUnixPeer;
+#endif
+}
+/**
+ * @brief Checks if a socket can be read from without waiting
+ *
+ * @param sock The socket
+ *
+ * @return 1 if it can, 0 otherwise
+ */
+static inline uint8_t
+attoHTTPWrapperReadable(int16_t sock)
+{
+    struct timeval timeout = {0, 0};
+    fd_set active;
+    FD_ZERO(&active);
+    FD_SET(sock, &active);
+    return (select(sock + 1, &active, NULL, NULL, &timeout) > 0);
+}
+/**
+ * @brief Checks if there is room to hold another socket
+ *
+ * @return 1 if there is room, 0 otherwise
+ */
+static inline uint8_t
+attoHTTPWrapperHeldRoom(void)
+{
+    uint8_t i;
+    for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+        if (attoHTTPUnixHeldSock[i] < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+/**
+ * @brief Puts held sockets in line once their request line is in, and serves one
+ *
+ * The request line is peeked at, so attoHTTPExecute() still reads all of
+ * it.  A socket that has sent part of a request line is left out of
+ * select(), since it would always be readable, and is looked at again each
+ * time through.  A socket that hasn't sent its request line
+ * ATTOHTTP_UNIX_HOLD_LIMIT ms after it was accepted is sent a 408 and
+ * closed, so idle or slow clients can't take up all of the places.
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperSchedule(void)
+{
+    uint8_t line[ATTOHTTP_URL_BUFFER_SIZE + 16];
+    requestclass_t rclass;
+    int16_t *held;
+    int16_t sock;
+    ssize_t len;
+    uint8_t i;
+    uint32_t now = attoHTTPWrapperMillis();
+    for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+        if ((attoHTTPUnixHeldSock[i] < 0) || (attoHTTPUnixHeldSeen[i] < 0)) {
+            continue;
+        }
+        if ((uint32_t)(now - attoHTTPUnixHeldSince[i]) >= ATTOHTTP_UNIX_HOLD_LIMIT) {
+            attoHTTPWrapperDrop(i, STATUS_REQUEST_TIMEOUT);
+            continue;
+        }
+        len = recv(attoHTTPUnixHeldSock[i], line, sizeof(line), MSG_PEEK | MSG_DONTWAIT);
+        if (len <= 0) {
+            if ((len == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))) {
+                // They hung up before sending anything we could use
+                attoHTTPWrapperDrop(i, STATUS_RUNKNOWN);
+            }
+            continue;
+        }
+        attoHTTPUnixHeldSeen[i] = len;
+        rclass = attoHTTPClassify(line, len);
+        if ((rclass == REQUEST_PENDING) && (len == sizeof(line))) {
+            // Too much junk in front of the URL to be an API request
+            rclass = REQUEST_STATIC;
+        }
+        if (rclass == REQUEST_PENDING) {
+            continue;
+        }
+        if (attoHTTPQueueAdd((void *)&attoHTTPUnixHeldSock[i], rclass)) {
+            attoHTTPUnixHeldSeen[i] = -1;
+        } else {
+            attoHTTPWrapperDrop(i, STATUS_SERVICE_UNAVAILABLE);
+        }
+    }
+    held = (int16_t *)attoHTTPQueueNext();
+    if (held != NULL) {
+        sock = *held;
+        *held = -1;
+#ifdef ATTOHTTP_RATE_LIMIT
+        attoHTTPUnixPeer = attoHTTPUnixHeldPeer[held - attoHTTPUnixHeldSock];
+#endif
+        attoHTTPWrapperServe(sock);
+    }
+}
+#endif
+/**
+ * @brief Accepts a connection, and serves it, holds it, or turns it away
+ *
+ * @return None
+ */
+static inline void
+attoHTTPWrapperAccept(void)
+{
+    socklen_t size;
+    struct sockaddr_in clientname;
+    int16_t newSock;
+    returncode_t code;
+    // Connection request on original socket.
+    size = sizeof(clientname);
+    newSock = accept(attoHTTPUnixSock, (struct sockaddr *) &clientname, &size);
+    if (newSock < 0) {
+        perror("accept");
+        exit(EXIT_FAILURE);
+    }
+#ifdef _DEBUG_
+    printf("New connection on socket %d\r\n", newSock);
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+    attoHTTPUnixPeer = ntohl(clientname.sin_addr.s_addr);
+#endif
+    // Anything turned away here is turned away before it is read
+    code = STATUS_RUNKNOWN;
+#ifdef ATTOHTTP_LOAD_SHED
+    if (attoHTTPOverloaded(attoHTTPWrapperQueued(), attoHTTPWrapperHeld())) {
+        code = attoHTTPReject((void *)&newSock, STATUS_SERVICE_UNAVAILABLE);
+    }
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+    if ((code == STATUS_RUNKNOWN) && !attoHTTPPeerOpen(attoHTTPUnixPeer, attoHTTPWrapperMillis())) {
+        code = attoHTTPReject((void *)&newSock, STATUS_TOO_MANY_REQUESTS);
+    }
+#endif
+    if (code != STATUS_RUNKNOWN) {
+#ifdef _DEBUG_
+        printf("Turned away connection on socket %d\r\n", newSock);
+#endif
+        attoHTTPWrapperRejectClose(newSock);
+    } else {
+#ifdef ATTOHTTP_REQUEST_QUEUE
+        attoHTTPWrapperHold(newSock);
+#else
+        attoHTTPWrapperServe(newSock);
+#endif
+    }
+}
 /**
  * @brief The main function for the wrapper
  *
@@ -131,15 +651,48 @@ attoHTTPWrapperInit(uint16_t port)
 static inline void
 attoHTTPWrapperMain(uint8_t setup)
 {
-    socklen_t size;
-    struct sockaddr_in clientname;
     fd_set active;
-    int16_t newSock;
+    struct timeval timeout;
+    struct timeval *wait = NULL;
     int ret;
+#if defined(ATTOHTTP_WEBSOCKET) || defined(ATTOHTTP_REQUEST_QUEUE)
+    uint8_t i;
+#endif
     if (attoHTTPUnixSock > 0) {
         FD_ZERO(&active);
         FD_SET(attoHTTPUnixSock, &active);
-        if ((ret = select(FD_SETSIZE, &active, NULL, NULL, NULL)) < 0) {
+#ifdef ATTOHTTP_WEBSOCKET
+        for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+            if (attoHTTPUnixWSSock[i] >= 0) {
+                FD_SET(attoHTTPUnixWSSock[i], &active);
+            }
+        }
+#endif
+        // Wake up in time to flush server sent events if anyone is listening
+        timeout.tv_sec = ATTOHTTP_SSE_FLUSH_WINDOW / 1000;
+        timeout.tv_usec = (ATTOHTTP_SSE_FLUSH_WINDOW % 1000) * 1000;
+        if (attoHTTPSSECount() > 0) {
+            wait = &timeout;
+        }
+#ifdef ATTOHTTP_REQUEST_QUEUE
+        for (i = 0; i < ATTOHTTP_UNIX_HELD; i++) {
+            if ((attoHTTPUnixHeldSock[i] >= 0) && (attoHTTPUnixHeldSeen[i] == 0)) {
+                FD_SET(attoHTTPUnixHeldSock[i], &active);
+                // Check back to see if it has run out of time
+                wait = &timeout;
+            } else if ((attoHTTPUnixHeldSock[i] >= 0) && (attoHTTPUnixHeldSeen[i] > 0)) {
+                // Part of a request line is in, so check back for the rest
+                wait = &timeout;
+            }
+        }
+        if (attoHTTPQueueCount() > 0) {
+            // Someone is waiting to be served, so don't wait
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 0;
+            wait = &timeout;
+        }
+#endif
+        if ((ret = select(FD_SETSIZE, &active, NULL, NULL, wait)) < 0) {
             if (errno != EINTR) {
                 perror("select");
                 exit(EXIT_FAILURE);
@@ -147,22 +700,25 @@ attoHTTPWrapperMain(uint8_t setup)
         }
 
         if ((ret > 0) && FD_ISSET(attoHTTPUnixSock, &active)) {
-            // Connection request on original socket.
-            size = sizeof(clientname);
-            newSock = accept(attoHTTPUnixSock, (struct sockaddr *) &clientname, &size);
-            if (newSock < 0) {
-                perror("accept");
-                exit(EXIT_FAILURE);
+            attoHTTPWrapperAccept();
+#ifdef ATTOHTTP_REQUEST_QUEUE
+            // Take in everyone who is waiting, so they can be served in order
+            while (attoHTTPWrapperHeldRoom() && attoHTTPWrapperReadable(attoHTTPUnixSock)) {
+                attoHTTPWrapperAccept();
             }
-#ifdef _DEBUG_
-            printf("New connection on socket %d\r\n", newSock);
 #endif
-            attoHTTPExecute((void *)&newSock, (void *)&newSock);
-#ifdef _DEBUG_
-            printf("Closing connection on socket %d\r\n", newSock);
+        }
+#ifdef ATTOHTTP_REQUEST_QUEUE
+        attoHTTPWrapperSchedule();
 #endif
-            close(newSock);
+#ifdef ATTOHTTP_WEBSOCKET
+        for (i = 0; i < ATTOHTTP_WEBSOCKETS; i++) {
+            if ((ret > 0) && (attoHTTPUnixWSSock[i] >= 0) && FD_ISSET(attoHTTPUnixWSSock[i], &active)) {
+                attoHTTPWebSocketRead(i);
+            }
         }
+#endif
+        attoHTTPSSEPoll(attoHTTPWrapperMillis());
     }
 
 }
@@ -175,7 +731,8 @@ attoHTTPWrapperMain(uint8_t setup)
  * get bytes from any source.
  *
  * This function should only return when it has something (ret == 1), when it
- * timed out waiting for something (ret == 0), or when there was an error (ret == -1)
+ * timed out waiting for something (ret == 0), or when there was an error (ret == -1).
+ * It waits ATTOHTTP_READ_TIMEOUT ms at most.
  *
  * @param read This is whatever it needs to be.  Could be a socket, or an object,
  *              or something totally different.  It will be called with whatever
@@ -188,7 +745,7 @@ static inline int8_t
 attoHTTPGetByte(void *read, uint8_t *byte) {
     int16_t sock = *(int16_t *)read;
     int16_t ret = 0;
-    struct timeval timeout = {1, 0};
+    struct timeval timeout = {ATTOHTTP_READ_TIMEOUT / 1000, (ATTOHTTP_READ_TIMEOUT % 1000) * 1000};
 
     fd_set active;
     if (sock > 0) {
@@ -223,6 +780,52 @@ attoHTTPGetByte(void *read, uint8_t *byte) {
     }
     return ret;
 }
+/**
+ * @brief User function to get a block of bytes
+ *
+ * This is used to read the body of the request if ATTOHTTP_BULK_READ is set.
+ *
+ * @param read This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to the execute routine.
+ * @param buf   The buffer to put the bytes in
+ * @param len   The most bytes to read
+ *
+ * @return The number of bytes read, 0 on timeout, -1 on error
+ */
+static inline int16_t
+attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len) {
+    int16_t sock = *(int16_t *)read;
+    int16_t ret = 0;
+    struct timeval timeout = {ATTOHTTP_READ_TIMEOUT / 1000, (ATTOHTTP_READ_TIMEOUT % 1000) * 1000};
+
+    fd_set active;
+    if (len > INT16_MAX) {
+        // Anything more wouldn't fit in the return value
+        len = INT16_MAX;
+    }
+    if (sock > 0) {
+        FD_ZERO(&active);
+        FD_SET(sock, &active);
+        do {
+            ret = select(FD_SETSIZE, &active, NULL, NULL, &timeout);
+            if (ret < 0) {
+                if (errno != EINTR) {
+                    perror("select");
+                    close(sock);
+                    exit(errno);
+                }
+            } else if ((ret > 0) && FD_ISSET(sock, &active)) {
+                ret = recv(sock, buf, len, 0);
+                if ((ret < 0) && (errno != EINTR)) {
+                    ret = -1;
+                    break;
+                }
+            }
+        } while (ret < 0);
+    }
+    return ret;
+}
 /**
  * @brief User function to set a byte
  *
@@ -254,5 +857,40 @@ attoHTTPSetByte(void *write, uint8_t byte) {
     return ret;
 }
 
+/**
+ * @brief User function to set a block of bytes
+ *
+ * This is used to send server sent events if ATTOHTTP_BULK_WRITE is set.
+ *
+ * @param write This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to attoHTTPSSEAdd().
+ * @param buf   The bytes to write
+ * @param len   The number of bytes in buf
+ *
+ * @return The number of bytes written, -1 on error
+ */
+static inline int16_t
+attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len) {
+    int16_t ret;
+    int16_t sock = *(int16_t *)write;
+    if (len > INT16_MAX) {
+        // Anything more wouldn't fit in the return value
+        len = INT16_MAX;
+    }
+    while ((ret = send(sock, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0) {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            // The socket is full.  The rest goes out on the next flush.
+            return 0;
+        } else if (errno != EINTR) {
+#ifdef __DEBUG__
+            perror("Send");
+#endif
+            return -1;
+        }
+    }
+    return ret;
+}
+
 
 #endif // #ifndef __ATTOHTTP_H__
@@ -57,6 +57,27 @@
  */
 #define ATTOHTTP_BASIC_AUTH
 
+/**
+ * @brief If this flag is set, a cookie is given out after authentication
+ *
+ * Requests with a good cookie don't have to be authenticated again.
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_AUTH_SESSION
+
+#define ATTOHTTP_AUTH_USERS 256
+
+/**
+ * @brief The time in seconds, for the session cookies
+ *
+ * The tests set the time themselves.
+ *
+ * Defaults to time(NULL)
+ */
+extern uint32_t TestTime;
+#define ATTOHTTP_AUTH_TIME() TestTime
+
 /**
  * @brief User function to get a byte
  *
@@ -85,6 +106,18 @@ uint16_t attoHTTPGetByte(void *read, uint8_t *byte);
  * @return 1 if a character was read, 0 otherwise.
  */
 uint16_t attoHTTPSetByte(void *write, uint8_t byte);
+/**
+ * @brief User function to get random bytes
+ *
+ * This function must be defined by the user if ATTOHTTP_AUTH_SESSION is set.
+ * It makes the session cookies.
+ *
+ * @param buf The buffer to fill
+ * @param len The number of bytes to fill it with
+ *
+ * @return None
+ */
+void attoHTTPGetRandom(uint8_t *buf, uint8_t len);
 /**
  * @brief Checks the Auth, based on what is given in the Authorization header
  *
@@ -33,6 +33,8 @@
 
 uint8_t *TestWriteString, *TestReadString;
 uint16_t TestWriteCount, TestReadCount;
+uint32_t TestTime;
+uint8_t TestRandom;
 
 FCT_BGN()
 {
@@ -48,6 +50,7 @@ TestInit(void)
     TestReadString = NULL;
     TestWriteCount = 0;
     TestReadCount = 0;
+    TestTime = 1700000000;
 }
 
 
@@ -69,6 +72,15 @@ attoHTTPGetByte(void *extra, uint8_t *byte)
     return (*byte == 0) ? 0 : 1;
 }
 
+void
+attoHTTPGetRandom(uint8_t *buf, uint8_t len)
+{
+    // Not random at all, so the tests know what cookie to expect
+    while (len-- > 0) {
+        *buf++ = TestRandom++;
+    }
+}
+
 uint16_t
 attoHTTPSetByte(void *extra, uint8_t byte)
 {
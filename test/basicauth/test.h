@@ -34,6 +34,9 @@
 
 void TestInit(void);
 
+extern uint32_t TestTime;
+extern uint8_t TestRandom;
+
 #define NewConnection() TestInit()
 #endif
 
@@ -57,6 +57,16 @@
  */
 #define ATTOHTTP_DIGEST_AUTH
 
+/**
+ * @brief The time in seconds, for the digest nonces
+ *
+ * The tests set the time themselves.
+ *
+ * Defaults to time(NULL)
+ */
+extern uint32_t TestTime;
+#define ATTOHTTP_DIGEST_TIME() TestTime
+
 /**
  * @brief User function to get a byte
  *
@@ -85,6 +95,18 @@ uint16_t attoHTTPGetByte(void *read, uint8_t *byte);
  * @return 1 if a character was read, 0 otherwise.
  */
 uint16_t attoHTTPSetByte(void *write, uint8_t byte);
+/**
+ * @brief User function to get random bytes
+ *
+ * This function must be defined by the user if ATTOHTTP_DIGEST_AUTH is set.
+ * It makes the nonce key if attoHTTPDigestSecret() isn't called.
+ *
+ * @param buf The buffer to fill
+ * @param len The number of bytes to fill it with
+ *
+ * @return None
+ */
+void attoHTTPGetRandom(uint8_t *buf, uint8_t len);
 /**
  * @brief Checks the Auth, based on what is given in the Authorization header
  *
@@ -34,6 +34,8 @@
 
 void TestInit(void);
 
+extern uint8_t TestRandom;
+
 #define NewConnection() TestInit()
 #endif
 
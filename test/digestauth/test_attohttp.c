@@ -32,8 +32,18 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <string.h>
+#include <time.h>
 #include "attohttp.h"
+#include "md5.h"
 #include "test.h"
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+# define TestCycles() __rdtsc()
+# define CYCLES "cycles"
+#else
+# define TestCycles() TestNow()
+# define CYCLES "ns"
+#endif
 
 #define TEST_AUTH_1 "asdf1234567890asdf"
 #define TEST_AUTH_TOO_LONG "01234567891123456789212345678931234567894123456789512345678961234567897123456789"
@@ -49,16 +59,148 @@ int8_t attoHTTPWrapperCheckAuth(uint8_t auth, int8_t *cred)
     return 0;
 }
 
+extern uint8_t _attoHTTPDigestKeyed;
+
 static const uint8_t default_content[] = "Default";
 static const char default_return[] = "HTTP/1.0 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: 8\r\n\r\nDefault";
 
 #define WRITE_BUFFER_SIZE 2048
 #define CheckUnsupported(ret) fct_xchk((ret == STATUS_UNSUPPORTED), "Return was not 'STATUS_UNSUPPORTED'"); fct_chk_eq_str("HTTP/1.0 501 Not Implemented\r\n", write_buffer)
-#define CheckUnauthorized(ret) fct_xchk((ret == STATUS_UNAUTHORIZED), "Return was not 'STATUS_UNAUTHORIZED'"); fct_chk_eq_str("HTTP/1.0 401 Unauthorized\r\nWWW-Authenticate: Digest realm=\"" ATTOHTTP_AUTH_REALM "\",qop=\"auth,auth-int\",nonce=\"" ATTOHTTP_AUTH_REALM "\",opaque=\"" ATTOHTTP_AUTH_REALM "\"\r\n\r\n" ATTOHTTP_AUTH_ERROR_MSG, write_buffer)
+#define CHALLENGE_START "HTTP/1.0 401 Unauthorized\r\nWWW-Authenticate: Digest realm=\"" ATTOHTTP_AUTH_REALM "\",qop=\"auth\",algorithm=MD5,nonce=\""
+#define CHALLENGE_END "\",opaque=\"" ATTOHTTP_AUTH_REALM "\"\r\n\r\n" ATTOHTTP_AUTH_ERROR_MSG
+#define CHALLENGE_STALE "\",opaque=\"" ATTOHTTP_AUTH_REALM "\",stale=true\r\n\r\n" ATTOHTTP_AUTH_ERROR_MSG
+#define NONCE_SIZE 48
+#define CheckChallenge(ret, end) fct_xchk((ret == STATUS_UNAUTHORIZED), "Return was not 'STATUS_UNAUTHORIZED'"); fct_xchk((strncmp(CHALLENGE_START, write_buffer, strlen(CHALLENGE_START)) == 0), "Challenge start was wrong"); fct_chk_eq_str(end, &write_buffer[strlen(CHALLENGE_START) + NONCE_SIZE])
+#define CheckUnauthorized(ret) CheckChallenge(ret, CHALLENGE_END)
+#define CheckStale(ret) CheckChallenge(ret, CHALLENGE_STALE)
 #define CheckNotFound(ret) fct_xchk((ret == STATUS_NOT_FOUND), "Return was not 'STATUS_NOT_FOUND'"); fct_chk_eq_str("HTTP/1.0 404 Not Found\r\n", write_buffer)
 #define CheckDefault(ret) fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'"); fct_chk_eq_str(default_return, write_buffer)
 #define CheckRet(expect, value) fct_xchk((expect == value), "Expected %d got %d", expect, value)
 char write_buffer[WRITE_BUFFER_SIZE];
+static char nonce[NONCE_SIZE + 1];
+static char request[1024];
+static const char *cnonce = "0a4f113b";
+
+/**
+ * @brief Writes bytes out as lower case hex
+ */
+static void
+TestHex(const uint8_t *in, uint8_t len, char *out)
+{
+    while (len-- > 0) {
+        out += sprintf(out, "%02x", *in++);
+    }
+}
+/**
+ * @brief Asks for a page without credentials, and keeps the nonce from the challenge
+ *
+ * @return 1 if there was a nonce, 0 otherwise
+ */
+static uint8_t
+TestGetNonce(void)
+{
+    char *start;
+    TestInit();
+    memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+    attoHTTPExecute((void *)"GET /index.html HTTP/1.0\r\n\r\n", (void *)write_buffer);
+    start = strstr(write_buffer, "nonce=\"");
+    if (start == NULL) {
+        return 0;
+    }
+    memcpy(nonce, start + 7, NONCE_SIZE);
+    nonce[NONCE_SIZE] = 0;
+    TestInit();
+    memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+    return 1;
+}
+/**
+ * @brief Builds a request with a Digest Authorization header, the way a browser would
+ *
+ * @return The request
+ */
+static const char *
+TestDigestRequest(const char *url, const char *uri, const char *user, const char *password, const char *nonce, uint32_t nc)
+{
+    MD5_CTX ctx;
+    uint8_t digest[16];
+    char ha1[33], ha2[33], response[33], count[9];
+    snprintf(count, sizeof(count), "%08" PRIx32, nc);
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, user, strlen(user));
+    MD5_Update(&ctx, ":" ATTOHTTP_AUTH_REALM ":", strlen(ATTOHTTP_AUTH_REALM) + 2);
+    MD5_Update(&ctx, password, strlen(password));
+    MD5_Final(digest, &ctx);
+    TestHex(digest, 16, ha1);
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, "GET:", 4);
+    MD5_Update(&ctx, uri, strlen(uri));
+    MD5_Final(digest, &ctx);
+    TestHex(digest, 16, ha2);
+    MD5_Init(&ctx);
+    MD5_Update(&ctx, ha1, 32);
+    MD5_Update(&ctx, ":", 1);
+    MD5_Update(&ctx, nonce, strlen(nonce));
+    MD5_Update(&ctx, ":", 1);
+    MD5_Update(&ctx, count, 8);
+    MD5_Update(&ctx, ":", 1);
+    MD5_Update(&ctx, cnonce, strlen(cnonce));
+    MD5_Update(&ctx, ":auth:", 6);
+    MD5_Update(&ctx, ha2, 32);
+    MD5_Final(digest, &ctx);
+    TestHex(digest, 16, response);
+    snprintf(
+        request, sizeof(request),
+        "GET %s HTTP/1.0\r\nAccept: text/html\r\nAuthorization: Digest username=\"%s\", realm=\"" ATTOHTTP_AUTH_REALM "\", "
+        "nonce=\"%s\", uri=\"%s\", algorithm=MD5, response=\"%s\", opaque=\"" ATTOHTTP_AUTH_REALM "\", "
+        "qop=auth, nc=%s, cnonce=\"%s\"\r\n\r\n",
+        url, user, nonce, uri, response, count, cnonce
+    );
+    return request;
+}
+/**
+ * @brief Runs a request
+ *
+ * @return The return code
+ */
+static returncode_t
+TestRun(const char *req)
+{
+    TestInit();
+    memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+    return attoHTTPExecute((void *)req, (void *)write_buffer);
+}
+/**
+ * @brief The monotonic clock in ns, for hosts without a cycle counter
+ */
+static inline uint64_t
+TestNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+/**
+ * @brief Checks an MD5 against the hex that it should be
+ */
+static uint8_t
+TestDigestIs(const uint8_t *digest, const char *expect)
+{
+    char hex[33];
+    TestHex(digest, 16, hex);
+    return strcmp(hex, expect) == 0;
+}
+/**
+ * @brief Adds the test user
+ */
+static void
+TestAddUser(void)
+{
+    uint8_t ha1[16];
+    attoHTTPDigestSecret((const uint8_t *)"0123456789abcdef", 16);
+    attoHTTPAuthHA1("Mufasa", "Circle Of Life", ha1);
+    attoHTTPAuthAddUser("Mufasa", ha1);
+    attoHTTPAddPage("/index.html", default_content, sizeof(default_content), TEXT_HTML);
+}
 
 FCTMF_FIXTURE_SUITE_BGN(test_attohttp)
 {
@@ -172,6 +314,437 @@ FCTMF_FIXTURE_SUITE_BGN(test_attohttp)
         CheckUnauthorized(ret);
     }
     FCT_TEST_END()
+    /**
+     * @brief This tests that every challenge gets its own nonce
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestChallenge) {
+        char first[NONCE_SIZE + 1];
+        uint8_t ha1[16];
+        const uint8_t expect[16] = {
+            0x93, 0x9e, 0x75, 0x78, 0xed, 0x9e, 0x3c, 0x51, 0x8a, 0x45, 0x2a, 0xce, 0xe7, 0x63, 0xbc, 0xe9
+        };
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        memcpy(first, nonce, sizeof(first));
+        fct_xchk(TestGetNonce(), "No nonce");
+        fct_xchk((strcmp(first, nonce) != 0), "The nonce was the same twice");
+        fct_xchk((strncmp(first, nonce, 8) == 0), "The time was different");
+        // MD5("Mufasa:testrealm@host.com:Circle Of Life") from RFC 2617
+        fct_xchk((attoHTTPAuthAddUser("", ha1) == 0), "Added an empty user");
+        MD5_CTX ctx;
+        MD5_Init(&ctx);
+        MD5_Update(&ctx, "Mufasa:testrealm@host.com:Circle Of Life", 40);
+        MD5_Final(ha1, &ctx);
+        fct_xchk((memcmp(ha1, expect, sizeof(ha1)) == 0), "MD5 didn't match RFC 2617");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests good credentials, and that a nonce count can't be used twice
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestGoodAuth) {
+        returncode_t ret;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckDefault(ret);
+        ret = TestRun(TestDigestRequest("/index.html?a=1", "/index.html?a=1", "Mufasa", "Circle Of Life", nonce, 2));
+        CheckDefault(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 2));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 7));
+        CheckDefault(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a random nonce key is made if none was set
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestRandomKey) {
+        returncode_t ret;
+        uint8_t ha1[16];
+        char old[NONCE_SIZE + 1];
+        _attoHTTPDigestKeyed = 0;
+        TestRandom = 0;
+        attoHTTPAuthHA1("Mufasa", "Circle Of Life", ha1);
+        attoHTTPAuthAddUser("Mufasa", ha1);
+        attoHTTPAddPage("/index.html", default_content, sizeof(default_content), TEXT_HTML);
+        fct_xchk(TestGetNonce(), "No nonce");
+        fct_xchk((TestRandom == 32), "Got %d random bytes, not 32", TestRandom);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckDefault(ret);
+        fct_xchk((TestRandom == 32), "The key was made again");
+        // A different key, like after a restart, doesn't take the old nonces
+        strcpy(old, nonce);
+        _attoHTTPDigestKeyed = 0;
+        fct_xchk(TestGetNonce(), "No nonce");
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", old, 2));
+        CheckUnauthorized(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that all of a key longer than 64 bytes is used
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestLongKey) {
+        returncode_t ret;
+        uint8_t key[100];
+        char old[NONCE_SIZE + 1];
+        TestAddUser();
+        memset(key, 'k', sizeof(key));
+        attoHTTPDigestSecret(key, sizeof(key));
+        fct_xchk(TestGetNonce(), "No nonce");
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckDefault(ret);
+        // Only the last byte is different, so the nonce has to stop working
+        strcpy(old, nonce);
+        key[sizeof(key) - 1] = 'K';
+        attoHTTPDigestSecret(key, sizeof(key));
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", old, 2));
+        CheckUnauthorized(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests credentials that are wrong
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestBadAuth) {
+        returncode_t ret;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Simba", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/other.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        // The query is part of the target, so a response for one query can't be used for another
+        ret = TestRun(TestDigestRequest("/index.html?a=2", "/index.html?a=1", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html?a=1", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html?a=1", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        nonce[0] = (nonce[0] == '1') ? '2' : '1';
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+        CheckUnauthorized(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", "1234", 1));
+        CheckUnauthorized(ret);
+        ret = TestRun("GET /index.html HTTP/1.0\r\nAuthorization: Digest username=\"Mufasa\", realm=\"" ATTOHTTP_AUTH_REALM "\"\r\n\r\n");
+        CheckUnauthorized(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests Digest headers that are a lot longer than ATTOHTTP_HEADER_VALUE_SIZE
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestLongHeader) {
+        returncode_t ret;
+        char url[200];
+        char other[200];
+        char req[1024];
+        char *ptr;
+        const char *rest;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        // A long query is still part of the uri that is hashed
+        memset(url, 'q', sizeof(url));
+        memcpy(url, "/index.html?a=", 14);
+        url[sizeof(url) - 1] = 0;
+        ret = TestRun(TestDigestRequest(url, url, "Mufasa", "Circle Of Life", nonce, 1));
+        fct_xchk((strlen(request) > (3 * ATTOHTTP_HEADER_VALUE_SIZE)), "The request isn't long enough");
+        CheckDefault(ret);
+        // Even past what fits in the URL buffer
+        strcpy(other, url);
+        other[sizeof(url) - 2] = 'r';
+        ret = TestRun(TestDigestRequest(other, url, "Mufasa", "Circle Of Life", nonce, 2));
+        CheckUnauthorized(ret);
+        other[sizeof(url) - 2] = 0;
+        ret = TestRun(TestDigestRequest(other, url, "Mufasa", "Circle Of Life", nonce, 2));
+        CheckUnauthorized(ret);
+        // Parameters we don't know about are skipped, even long ones, and quoted values can be escaped
+        TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 2);
+        ptr = strstr(request, "username=");
+        rest = strstr(request, "realm=");
+        snprintf(
+            req, sizeof(req), "%.*sextra=\"%s\", username=\"Muf\\asa\", %s",
+            (int)(ptr - request), request, url, rest
+        );
+        ret = TestRun(req);
+        CheckDefault(ret);
+        // A parameter can only be there once
+        TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 3);
+        snprintf(req, sizeof(req), "%.*sqop=auth, %s", (int)(ptr - request), request, ptr);
+        ret = TestRun(req);
+        CheckUnauthorized(ret);
+        // The longest cnonce that fits, then one that doesn't
+        memset(url, 'c', sizeof(url));
+        url[ATTOHTTP_DIGEST_CNONCE_SIZE - 1] = 0;
+        cnonce = url;
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 4));
+        CheckDefault(ret);
+        url[ATTOHTTP_DIGEST_CNONCE_SIZE - 1] = 'c';
+        url[ATTOHTTP_DIGEST_CNONCE_SIZE] = 0;
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 5));
+        cnonce = "0a4f113b";
+        CheckUnauthorized(ret);
+        // Basic still goes to the wrapper
+        ret = TestRun("GET /index.html HTTP/1.0\r\nAccept: text/html\r\nAuthorization: Basic " TEST_AUTH_1 "\r\n\r\n");
+        CheckDefault(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that old nonces are stale
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestStale) {
+        returncode_t ret;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1);
+        TestInit();
+        TestTime += ATTOHTTP_DIGEST_NONCE_LIFETIME + 1;
+        ret = attoHTTPExecute((void *)request, (void *)write_buffer);
+        CheckStale(ret);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        // Right at the end of its life it still works
+        TestTime += ATTOHTTP_DIGEST_NONCE_LIFETIME;
+        ret = attoHTTPExecute((void *)request, (void *)write_buffer);
+        CheckDefault(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests nonces that fall out of the nonce count table
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestNonceTable) {
+        returncode_t ret;
+        char first[NONCE_SIZE + 1];
+        uint8_t i;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        memcpy(first, nonce, sizeof(first));
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", first, 1));
+        CheckDefault(ret);
+        for (i = 0; i < ATTOHTTP_DIGEST_NONCES; i++) {
+            fct_xchk(TestGetNonce(), "No nonce");
+            ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 1));
+            CheckDefault(ret);
+        }
+        // The first one got pushed out, so it has to be stale
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", first, 2));
+        CheckStale(ret);
+        ret = TestRun(TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, 2));
+        CheckDefault(ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This times requests with digest authentication
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDigestAuthCost) {
+        struct timespec start, end;
+        uint32_t i;
+        uint64_t took;
+        uint8_t good = 1;
+        const uint32_t count = 20000;
+        TestAddUser();
+        fct_xchk(TestGetNonce(), "No nonce");
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 1; i <= count; i++) {
+            TestInit();
+            good &= (attoHTTPExecute((void *)"GET /index.html HTTP/1.0\r\nAccept: text/html\r\nAuthorization: Basic " TEST_AUTH_1 "\r\n\r\n", (void *)write_buffer) == STATUS_OK);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        took = ((end.tv_sec - start.tv_sec) * 1000000000ULL) + end.tv_nsec - start.tv_nsec;
+        printf("\nBasic through the wrapper: %" PRIu64 " ns/request\n", took / count);
+        took = 0;
+        for (i = 1; i <= count; i++) {
+            TestDigestRequest("/index.html", "/index.html", "Mufasa", "Circle Of Life", nonce, i);
+            TestInit();
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            good &= (attoHTTPExecute((void *)request, (void *)write_buffer) == STATUS_OK);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            took += ((end.tv_sec - start.tv_sec) * 1000000000ULL) + end.tv_nsec - start.tv_nsec;
+        }
+        printf("Digest: %" PRIu64 " ns/request\n", took / count);
+        fct_xchk(good, "A request failed");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief The RFC 1321 test suite, at every alignment and a byte at a time
+     */
+    FCT_TEST_BGN(testMD5Vectors) {
+        static const struct {
+            const char *msg;
+            const char *md5;
+        } vectors[] = {
+            { "", "d41d8cd98f00b204e9800998ecf8427e" },
+            { "a", "0cc175b9c0f1b6a831c399e269772661" },
+            { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+            { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+            { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+            { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+            { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+        };
+        uint8_t buf[96];
+        uint8_t digest[16];
+        MD5_CTX ctx;
+        size_t len, j;
+        uint8_t i, off;
+        for (i = 0; i < (sizeof(vectors) / sizeof(vectors[0])); i++) {
+            len = strlen(vectors[i].msg);
+            for (off = 0; off < 4; off++) {
+                memcpy(&buf[off], vectors[i].msg, len);
+                MD5_Init(&ctx);
+                MD5_Update(&ctx, &buf[off], len);
+                MD5_Final(digest, &ctx);
+                fct_xchk(TestDigestIs(digest, vectors[i].md5), "'%s' at offset %u", vectors[i].msg, off);
+            }
+            MD5_Init(&ctx);
+            for (j = 0; j < len; j++) {
+                MD5_Update(&ctx, &vectors[i].msg[j], 1);
+            }
+            MD5_Final(digest, &ctx);
+            fct_xchk(TestDigestIs(digest, vectors[i].md5), "'%s' a byte at a time", vectors[i].msg);
+        }
+    }
+    FCT_TEST_END()
+    /**
+     * @brief The RFC 2202 HMAC-MD5 test cases
+     */
+    FCT_TEST_BGN(testHMACMD5Vectors) {
+        static const struct {
+            uint8_t key;
+            uint8_t keylen;
+            const char *data;
+            uint8_t datalen;
+            const char *mac;
+        } vectors[] = {
+            { 0x0b, 16, "Hi There", 8, "9294727a3638bb1c13f48ef8158bfc9d" },
+            { 0, 4, "what do ya want for nothing?", 28, "750c783e6ab0b503eaa86e310a5db738" },
+            { 0xaa, 16, NULL, 50, "56be34521d144c88dbb8c733f0e8b3f6" },
+            { 0x01, 25, NULL, 50, "697eaf0aca3a3aea3a75164746ffaa79" },
+            { 0x0c, 16, "Test With Truncation", 20, "56461ef2342edc00f9bab995690efd4c" },
+            { 0xaa, 80, "Test Using Larger Than Block-Size Key - Hash Key First", 54, "6b1ab7fe4bd7bf8f0b62e6ce61b9d0cd" },
+            { 0xaa, 80, "Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data", 73, "6f630fad67cda0ee1fb1f562db3aa53e" },
+        };
+        MD5_HMAC_KEY key;
+        MD5_HMAC_CTX ctx;
+        uint8_t secret[80];
+        uint8_t data[50];
+        uint8_t mac[16];
+        uint8_t i, j;
+        for (i = 0; i < (sizeof(vectors) / sizeof(vectors[0])); i++) {
+            for (j = 0; j < vectors[i].keylen; j++) {
+                // Case 4 counts up from 1, the rest repeat one byte
+                secret[j] = (vectors[i].keylen == 25) ? j + 1 : vectors[i].key;
+            }
+            if (vectors[i].key == 0) {
+                memcpy(secret, "Jefe", 4);
+            }
+            if (vectors[i].data == NULL) {
+                memset(data, (vectors[i].key == 0xaa) ? 0xdd : 0xcd, sizeof(data));
+            } else {
+                memcpy(data, vectors[i].data, (vectors[i].datalen < sizeof(data)) ? vectors[i].datalen : sizeof(data));
+            }
+            MD5_HMAC_Key(&key, secret, vectors[i].keylen);
+            MD5_HMAC_Init(&ctx, &key);
+            if (vectors[i].data == NULL) {
+                MD5_HMAC_Update(&ctx, data, vectors[i].datalen);
+            } else {
+                MD5_HMAC_Update(&ctx, vectors[i].data, vectors[i].datalen);
+            }
+            MD5_HMAC_Final(mac, &ctx);
+            fct_xchk(TestDigestIs(mac, vectors[i].mac), "Case %u", i + 1);
+            // The key can be used again, and in pieces
+            MD5_HMAC_Init(&ctx, &key);
+            for (j = 0; j < vectors[i].datalen; j++) {
+                MD5_HMAC_Update(&ctx, (vectors[i].data == NULL) ? (const void *)&data[j] : (const void *)&vectors[i].data[j], 1);
+            }
+            MD5_HMAC_Final(mac, &ctx);
+            fct_xchk(TestDigestIs(mac, vectors[i].mac), "Case %u a byte at a time", i + 1);
+        }
+    }
+    FCT_TEST_END()
+    /**
+     * @brief How many cycles a byte MD5 takes, and what a nonce MAC costs
+     */
+    FCT_TEST_BGN(testMD5Cost) {
+        static const uint16_t sizes[] = { 64, 1024, 8192 };
+        static uint8_t buf[8192 + 1];
+        MD5_HMAC_KEY key;
+        MD5_HMAC_CTX hctx;
+        MD5_CTX ctx;
+        uint8_t pad[64];
+        uint8_t digest[16];
+        uint64_t start, took;
+        uint32_t i, count;
+        uint8_t s, off, j;
+        for (i = 0; i < sizeof(buf); i++) {
+            buf[i] = i;
+        }
+        for (s = 0; s < (sizeof(sizes) / sizeof(sizes[0])); s++) {
+            count = (1024 * 1024) / sizes[s];
+            for (off = 0; off < 2; off++) {
+                start = TestCycles();
+                for (i = 0; i < count; i++) {
+                    MD5_Init(&ctx);
+                    MD5_Update(&ctx, &buf[off], sizes[s]);
+                    MD5_Final(digest, &ctx);
+                }
+                took = TestCycles() - start;
+                printf("%sMD5 %u bytes%s: %.2f " CYCLES "/byte", (off == 0) ? "\n" : ", ",
+                       sizes[s], (off == 0) ? "" : " unaligned", (double)took / ((double)count * sizes[s]));
+            }
+        }
+        count = 100000;
+        MD5_HMAC_Key(&key, "0123456789abcdef", 16);
+        start = TestCycles();
+        for (i = 0; i < count; i++) {
+            MD5_HMAC_Init(&hctx, &key);
+            MD5_HMAC_Update(&hctx, buf, 8);
+            MD5_HMAC_Final(digest, &hctx);
+        }
+        took = TestCycles() - start;
+        printf("\nHMAC-MD5 of a nonce: %" PRIu64 " " CYCLES, took / count);
+        // What it cost when the pads were done every time
+        start = TestCycles();
+        for (i = 0; i < count; i++) {
+            memset(pad, 0, sizeof(pad));
+            memcpy(pad, "0123456789abcdef", 16);
+            for (j = 0; j < sizeof(pad); j++) {
+                pad[j] ^= 0x36;
+            }
+            MD5_Init(&ctx);
+            MD5_Update(&ctx, pad, sizeof(pad));
+            MD5_Update(&ctx, buf, 8);
+            MD5_Final(digest, &ctx);
+            for (j = 0; j < sizeof(pad); j++) {
+                pad[j] ^= 0x36 ^ 0x5C;
+            }
+            MD5_Init(&ctx);
+            MD5_Update(&ctx, pad, sizeof(pad));
+            MD5_Update(&ctx, digest, 16);
+            MD5_Final(digest, &ctx);
+        }
+        took = TestCycles() - start;
+        printf(", %" PRIu64 " " CYCLES " with the pads every time\n", took / count);
+    }
+    FCT_TEST_END()
 
 }
 FCTMF_FIXTURE_SUITE_END();
@@ -50,6 +50,76 @@
  */
 #undef ATTOHTTP_GZIP_PAGES
 
+/**
+ * @brief If this flag is set, the body is read in blocks with attoHTTPGetBytes
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_BULK_READ
+
+/**
+ * @brief If this flag is set, server sent events are written with attoHTTPSetBytes
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_BULK_WRITE
+
+/**
+ * @brief If this flag is set, other threads can queue server sent events with attoHTTPSSEQueue
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_SSE_QUEUE
+
+/**
+ * @brief If this flag is set, URLs can be upgraded to WebSockets
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_WEBSOCKET
+
+/**
+ * @brief If this flag is set, WebSockets can use permessage-deflate
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_WEBSOCKET_DEFLATE
+
+/**
+ * @brief If this flag is set, each client gets a limited number of requests and connections
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_RATE_LIMIT
+
+/**
+ * @brief If this flag is set, new connections are turned away when the server is too busy
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_LOAD_SHED
+
+/**
+ * @brief Connections are turned away when this many are in flight
+ *
+ * Defaults to 16 if not set
+ */
+#define ATTOHTTP_SHED_CONNECTIONS 4
+
+/**
+ * @brief If this flag is set, connections can be put in line by the kind of request
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_REQUEST_QUEUE
+
+/**
+ * @brief If this flag is set, clients only get so long to send their request
+ *
+ * Defaults to not set
+ */
+#define ATTOHTTP_DEADLINE
+
 /**
  * @brief User function to get a byte
  *
@@ -78,6 +148,42 @@ uint16_t attoHTTPGetByte(void *read, uint8_t *byte);
  * @return 1 if a character was read, 0 otherwise.
  */
 uint16_t attoHTTPSetByte(void *write, uint8_t byte);
+/**
+ * @brief User function to get a block of bytes
+ *
+ * This function must be defined by the user if ATTOHTTP_BULK_READ is set.
+ *
+ * @param read This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to the execute routine.
+ * @param buf   The buffer to put the bytes in
+ * @param len   The most bytes to read
+ *
+ * @return The number of bytes read, 0 on timeout, -1 on error
+ */
+int16_t attoHTTPGetBytes(void *read, uint8_t *buf, uint16_t len);
+/**
+ * @brief User function to set a block of bytes
+ *
+ * This function must be defined by the user if ATTOHTTP_BULK_WRITE is set.
+ *
+ * @param write This is whatever it needs to be.  Could be a socket, or an object,
+ *              or something totally different.  It will be called with whatever
+ *              extra argument was given to attoHTTPSSEAdd().
+ * @param buf   The bytes to write
+ * @param len   The number of bytes in buf
+ *
+ * @return The number of bytes written, -1 on error
+ */
+int16_t attoHTTPSetBytes(void *write, const uint8_t *buf, uint16_t len);
+/**
+ * @brief User function to get the time
+ *
+ * This function must be defined by the user if ATTOHTTP_DEADLINE is set.
+ *
+ * @return The time in ms.  It must never go backwards.
+ */
+uint32_t attoHTTPGetMillis(void);
 
 
 #endif // #ifndef __ATTOHTTP_CONFIG_H__
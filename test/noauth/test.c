@@ -31,8 +31,10 @@
 #include <inttypes.h>
 #include "test.h"
 
-uint8_t *TestWriteString, *TestReadString;
+uint8_t *TestWriteString, *TestReadString, *TestWriteFail, *TestWriteFull;
 uint32_t TestWriteCount, TestReadCount;
+uint32_t TestMillis, TestMillisStep;
+uint16_t TestWriteChunk, TestWriteRoom, TestReadLength;
 
 FCT_BGN()
 {
@@ -42,6 +44,12 @@ FCT_BGN()
     FCTMF_SUITE_CALL(test_attohttpAPI);
     FCTMF_SUITE_CALL(test_attohttpParams);
     FCTMF_SUITE_CALL(test_attohttpstress);
+    FCTMF_SUITE_CALL(test_attohttpmultipart);
+    FCTMF_SUITE_CALL(test_attohttpupload);
+    FCTMF_SUITE_CALL(test_attohttpwebsocket);
+    FCTMF_SUITE_CALL(test_attohttpratelimit);
+    FCTMF_SUITE_CALL(test_attohttprequestqueue);
+    FCTMF_SUITE_CALL(test_attohttpdeadline);
 }
 FCT_END();
 
@@ -51,18 +59,40 @@ TestInit(void)
 {
     TestWriteString = NULL;
     TestReadString = NULL;
+    TestWriteFail = NULL;
+    TestWriteFull = NULL;
+    TestWriteChunk = 0;
+    TestWriteRoom = 0;
     TestWriteCount = 0;
     TestReadCount = 0;
+    TestReadLength = 0;
+    TestMillis = 0;
+    TestMillisStep = 0;
 }
 
 
+uint32_t
+attoHTTPGetMillis(void)
+{
+    return TestMillis;
+}
+
 uint16_t
 attoHTTPGetByte(void *extra, uint8_t *byte)
 {
+    // Every read takes this long, like a client that sends slowly
+    TestMillis += TestMillisStep;
     if (TestReadString == NULL) {
         TestReadString = (uint8_t *)extra;
     }
-    if ((TestReadString != NULL) && (byte != NULL)) {
+    if ((TestReadLength > 0) && (byte != NULL)) {
+        // Binary data, that might have 0 in it
+        if (TestReadCount >= TestReadLength) {
+            return 0;
+        }
+        *byte = TestReadString[TestReadCount++];
+        return 1;
+    } else if ((TestReadString != NULL) && (byte != NULL)) {
         *byte = TestReadString[TestReadCount];
         if ((*byte > 0) || (TestReadCount < 10)) {
             // If we get the end of string, just keep returning it.
@@ -74,16 +104,61 @@ attoHTTPGetByte(void *extra, uint8_t *byte)
     return (*byte == 0) ? 0 : 1;
 }
 
+int16_t
+attoHTTPGetBytes(void *extra, uint8_t *buf, uint16_t len)
+{
+    uint16_t count = 0;
+    TestMillis += TestMillisStep;
+    if (TestReadString == NULL) {
+        TestReadString = (uint8_t *)extra;
+    }
+    while ((count < len) && ((TestReadLength > 0) ? (TestReadCount < TestReadLength) : (TestReadString[TestReadCount] != 0))) {
+        buf[count++] = TestReadString[TestReadCount++];
+    }
+    return count;
+}
+
 uint16_t
 attoHTTPSetByte(void *extra, uint8_t byte)
 {
+    uint8_t *other;
+    if ((extra != NULL) && (extra == TestWriteFail)) {
+        return 0;
+    }
     if (TestWriteString == NULL) {
         TestWriteString = (uint8_t *)extra;
     }
-    if (TestWriteString != NULL) {
+    if ((extra != NULL) && (extra != TestWriteString)) {
+        // Any other buffer gets added to the end of what is already in it
+        other = (uint8_t *)extra;
+        other[strlen((char *)other)] = byte;
+    } else if (TestWriteString != NULL) {
         TestWriteString[TestWriteCount] = byte;
         TestWriteCount++;
     }
     return 1;
 }
 
+int16_t
+attoHTTPSetBytes(void *extra, const uint8_t *buf, uint16_t len)
+{
+    uint16_t count = 0;
+    if ((extra != NULL) && (extra == TestWriteFail)) {
+        return -1;
+    }
+    if ((extra != NULL) && (extra == TestWriteFull)) {
+        // This one only has TestWriteRoom bytes left before it is full
+        if (len > TestWriteRoom) {
+            len = TestWriteRoom;
+        }
+        TestWriteRoom -= len;
+    }
+    if ((TestWriteChunk > 0) && (len > TestWriteChunk)) {
+        // This acts like a socket that can only take so much at a time
+        len = TestWriteChunk;
+    }
+    while (count < len) {
+        count += attoHTTPSetByte(extra, buf[count]);
+    }
+    return count;
+}
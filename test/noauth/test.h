@@ -34,7 +34,10 @@
 
 void TestInit(void);
 
-extern uint8_t *TestWriteString, *TestReadString;
+extern uint8_t *TestWriteString, *TestReadString, *TestWriteFail, *TestWriteFull;
+extern uint16_t TestWriteChunk, TestWriteRoom, TestReadLength;
+extern uint32_t TestWriteCount, TestReadCount;
+extern uint32_t TestMillis, TestMillisStep;
 
 #define NewConnection() TestInit()
 #endif
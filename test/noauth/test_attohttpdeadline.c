@@ -0,0 +1,194 @@
+/**
+ * @file    test/test_attohttpdeadline.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define WRITE_BUFFER_SIZE 1024
+
+static const char timeout_return[] = "HTTP/1.0 408 Request Timeout\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+static const uint8_t index_content[] = "<html></html>";
+
+static char write_buffer[WRITE_BUFFER_SIZE];
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttpdeadline)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPInit();
+        attoHTTPAddPage("/index.html", index_content, sizeof(index_content) - 1, TEXT_HTML);
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests the rejection that is sent to a client that took too long
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRejectRequestTimeout) {
+        returncode_t ret;
+        ret = attoHTTPReject((void *)write_buffer, STATUS_REQUEST_TIMEOUT);
+        fct_xchk((ret == STATUS_REQUEST_TIMEOUT), "Return was not 'STATUS_REQUEST_TIMEOUT' (%d)", ret);
+        fct_chk_eq_str(timeout_return, write_buffer);
+        fct_xchk((TestReadCount == 0), "Read %d bytes", (int)TestReadCount);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a request that comes in on time, while the clock rolls over
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDeadlineInTime) {
+        returncode_t ret;
+        TestMillis = 0xFFFFFFF0;
+        TestMillisStep = 1;
+        ret = attoHTTPExecute(
+            (void *)"GET /index.html HTTP/1.0\r\nHost: device.local\r\n\r\n",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK' (%d)", ret);
+        fct_xchk((TestMillis < 0xFFFFFFF0), "The clock didn't roll over");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a client sending its request line a byte at a time
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDeadlineRequestLine) {
+        returncode_t ret;
+        TestMillisStep = 900;
+        ret = attoHTTPExecute(
+            (void *)"GET /index.html HTTP/1.0\r\n\r\n",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_REQUEST_TIMEOUT), "Return was not 'STATUS_REQUEST_TIMEOUT' (%d)", ret);
+        fct_chk_eq_str("HTTP/1.0 408 Request Timeout\r\n", write_buffer);
+        fct_xchk((TestReadCount <= ((ATTOHTTP_DEADLINE_LINE / 900) + 1)), "Read %d bytes", (int)TestReadCount);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a client that never stops sending headers
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDeadlineHeaders) {
+        returncode_t ret;
+        char read_buffer[2048];
+        char pad[1201];
+        memset(pad, 'a', sizeof(pad) - 1);
+        pad[sizeof(pad) - 1] = 0;
+        snprintf(read_buffer, sizeof(read_buffer), "GET /index.html HTTP/1.0\r\nX-Pad: %s\r\n\r\n", pad);
+        TestMillisStep = 5;
+        ret = attoHTTPExecute(
+            (void *)read_buffer,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_REQUEST_TIMEOUT), "Return was not 'STATUS_REQUEST_TIMEOUT' (%d)", ret);
+        fct_chk_eq_str("HTTP/1.0 408 Request Timeout\r\n", write_buffer);
+        fct_xchk((TestReadCount <= ((ATTOHTTP_DEADLINE_HEADERS / 5) + 1)), "Read %d bytes", (int)TestReadCount);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a body that doesn't all come in before the whole request is due
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDeadlineBody) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            uint16_t len;
+            len = attoHTTPReadBody(block, sizeof(block));
+            fct_xchk((len == 8), "Read %d not 8", len);
+            // The rest of the body is a long time coming
+            TestMillis += ATTOHTTP_DEADLINE_REQUEST;
+            len = attoHTTPReadBody(block, sizeof(block));
+            fct_xchk((len == 0), "Read %d not 0", len);
+            return STATUS_BADREQUEST;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.0\r\nContent-Length: 16\r\n\r\n0123456789abcdef",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_REQUEST_TIMEOUT), "Return was not 'STATUS_REQUEST_TIMEOUT' (%d)", ret);
+        fct_chk_eq_str("HTTP/1.0 408 Request Timeout\r\n", write_buffer);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a short body that comes in slower than ATTOHTTP_DEADLINE_BODY_RATE
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testDeadlineBodyRate) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            uint16_t len;
+            len = attoHTTPReadBody(block, sizeof(block));
+            fct_xchk((len == 8), "Read %d not 8", len);
+            // 16 bytes should be in long before this
+            TestMillis += ATTOHTTP_DEADLINE_LINE + 100;
+            len = attoHTTPReadBody(block, sizeof(block));
+            fct_xchk((len == 0), "Read %d not 0", len);
+            return STATUS_BADREQUEST;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.0\r\nContent-Length: 16\r\n\r\n0123456789abcdef",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_REQUEST_TIMEOUT), "Return was not 'STATUS_REQUEST_TIMEOUT' (%d)", ret);
+        fct_chk_eq_str("HTTP/1.0 408 Request Timeout\r\n", write_buffer);
+        fct_xchk(((ATTOHTTP_DEADLINE_LINE + 100) < ATTOHTTP_DEADLINE_REQUEST), "Deadline %d is too short for this test", ATTOHTTP_DEADLINE_REQUEST);
+    }
+    FCT_TEST_END()
+}
+FCTMF_FIXTURE_SUITE_END();
@@ -0,0 +1,314 @@
+/**
+ * @file    test/test_attohttpmultipart.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define WRITE_BUFFER_SIZE 1024
+#define BOUNDARY "----WebKitFormBoundary7MA4YWxkTrZu0gW"
+#define MULTIPART_HEADERS "POST /upload HTTP/1.0\r\nContent-Type: multipart/form-data; boundary=" BOUNDARY "\r\n\r\n"
+
+char write_buffer[WRITE_BUFFER_SIZE];
+
+char part_headers[512];
+char part_data[4][1200];
+uint16_t part_len[4];
+uint16_t part_calls;
+uint8_t part_last[4];
+
+uint8_t
+testMultipartHeader(uint16_t part, const char *name, const char *value)
+{
+    char *end = &part_headers[strlen(part_headers)];
+    snprintf(end, sizeof(part_headers) - (end - part_headers), "%d:%s=%s|", part, name, value);
+    return 1;
+}
+
+uint8_t
+testMultipartData(uint16_t part, const uint8_t *data, uint16_t len, uint8_t last)
+{
+    if ((part < 4) && ((part_len[part] + len) < sizeof(part_data[part]))) {
+        memcpy(&part_data[part][part_len[part]], data, len);
+        part_len[part] += len;
+        part_last[part] = last;
+    }
+    part_calls++;
+    return 1;
+}
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttpmultipart)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        memset(part_headers, 0, sizeof(part_headers));
+        memset(part_data, 0, sizeof(part_data));
+        memset(part_len, 0, sizeof(part_len));
+        memset(part_last, 0, sizeof(part_last));
+        part_calls = 0;
+        attoHTTPInit();
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests a form with a field and a file
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartTwoParts) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(testMultipartHeader, testMultipartData);
+            fct_xchk((parts == 2), "Parts was %d not 2", parts);
+            fct_chk_eq_str(
+                "0:Content-Disposition=form-data; name=\"name\"|"
+                "1:Content-Disposition=form-data; name=\"file\"; filename=\"a.txt\"|"
+                "1:Content-Type=text/plain|",
+                part_headers
+            );
+            fct_chk_eq_str("value", part_data[0]);
+            fct_chk_eq_str("line 1\r\nline 2\r\n--not the boundary\r\n", part_data[1]);
+            fct_xchk((part_last[0] == 1) && (part_last[1] == 1), "Last was not set");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)MULTIPART_HEADERS
+                "--" BOUNDARY "\r\n"
+                "Content-Disposition: form-data; name=\"name\"\r\n\r\n"
+                "value\r\n"
+                "--" BOUNDARY "\r\n"
+                "Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+                "Content-Type: text/plain\r\n\r\n"
+                "line 1\r\nline 2\r\n--not the boundary\r\n\r\n"
+                "--" BOUNDARY "--\r\n",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a part that is much bigger than the buffer
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartBigPart) {
+        returncode_t ret;
+        char read_buffer[2048];
+        char big[1025];
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(NULL, testMultipartData);
+            fct_xchk((parts == 1), "Parts was %d not 1", parts);
+            fct_xchk((part_len[0] == 1024), "Length was %d not 1024", part_len[0]);
+            fct_xchk((memcmp(part_data[0], big, 1024) == 0), "Data didn't match");
+            fct_xchk((part_calls > 1), "Data was not given in chunks");
+            fct_xchk((part_last[0] == 1), "Last was not set");
+            return STATUS_OK;
+        }
+        uint16_t i;
+        for (i = 0; i < 1024; i++) {
+            // Lots of things that look like the start of the delimiter
+            big[i] = "\r\n--ab"[i % 6];
+        }
+        big[1024] = 0;
+        snprintf(read_buffer, sizeof(read_buffer), MULTIPART_HEADERS "preamble\r\n--" BOUNDARY "\r\nContent-Disposition: form-data; name=\"fw\"\r\n\r\n%s\r\n--" BOUNDARY "--", big);
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)read_buffer,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests more parts than fit in a uint8_t
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartManyParts) {
+        returncode_t ret;
+        static char read_buffer[16384];
+        uint16_t last_part = 0;
+
+        uint8_t countData(uint16_t part, const uint8_t *data, uint16_t len, uint8_t last)
+        {
+            last_part = part;
+            return 1;
+        }
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(NULL, countData);
+            fct_xchk((parts == 300), "Parts was %d not 300", parts);
+            fct_xchk((last_part == 299), "Last part was %d not 299", last_part);
+            return STATUS_OK;
+        }
+        uint16_t i;
+        int len;
+        len = snprintf(read_buffer, sizeof(read_buffer), MULTIPART_HEADERS);
+        for (i = 0; i < 300; i++) {
+            len += snprintf(&read_buffer[len], sizeof(read_buffer) - len, "--" BOUNDARY "\r\n\r\n%d\r\n", i);
+        }
+        snprintf(&read_buffer[len], sizeof(read_buffer) - len, "--" BOUNDARY "--");
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)read_buffer,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a quoted boundary
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartQuotedBoundary) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(NULL, testMultipartData);
+            fct_xchk((parts == 1), "Parts was %d not 1", parts);
+            fct_chk_eq_str("abc", part_data[0]);
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"POST /upload HTTP/1.0\r\nContent-Type: multipart/form-data; boundary=\"xyz\"\r\n\r\n"
+                "--xyz\r\n\r\nabc\r\n--xyz--\r\n",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a body that stops before the last delimiter
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartTruncated) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(NULL, testMultipartData);
+            fct_xchk((parts == -1), "Parts was %d not -1", parts);
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)MULTIPART_HEADERS "--" BOUNDARY "\r\n\r\nabc\r\n--" BOUNDARY,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a callback stopping the parse
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartCallbackStops) {
+        returncode_t ret;
+
+        uint8_t stopHeader(uint16_t part, const char *name, const char *value)
+        {
+            return 0;
+        }
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(stopHeader, testMultipartData);
+            fct_xchk((parts == -1), "Parts was %d not -1", parts);
+            fct_xchk((part_calls == 0), "Data callback was called");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)MULTIPART_HEADERS "--" BOUNDARY "\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\nabc\r\n--" BOUNDARY "--",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a body that isn't multipart
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testMultipartWrongContentType) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            int16_t parts;
+            parts = attoHTTPParseMultipart(testMultipartHeader, testMultipartData);
+            fct_xchk((parts == -1), "Parts was %d not -1", parts);
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"POST /upload HTTP/1.0\r\nContent-Type: application/x-www-form-urlencoded\r\n\r\nhello=1",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+
+}
+FCTMF_FIXTURE_SUITE_END();
@@ -44,6 +44,7 @@ static const char default_return[] = "HTTP/1.0 200 OK\r\nContent-Type: text/html
 
 
 char write_buffer[WRITE_BUFFER_SIZE];
+extern uint32_t TestReadCount;
 
 FCTMF_FIXTURE_SUITE_BGN(test_attohttpParams)
 {
@@ -555,6 +556,359 @@ FCTMF_FIXTURE_SUITE_BGN(test_attohttpParams)
         fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
     }
     FCT_TEST_END()
+    /**
+     * @brief This tests looking up URL params by name, out of order
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETParamsByName) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            fct_xchk((attoHTTPURLParamCount() == 4), "Count was %d not 4", attoHTTPURLParamCount());
+            fct_chk_eq_str("{here And There}", attoHTTPGetURLParam("goodbye"));
+            fct_chk_eq_str("1", attoHTTPGetURLParam("hello"));
+            fct_chk_eq_str("", attoHTTPGetURLParam("flag"));
+            fct_chk_eq_str("a b", attoHTTPGetURLParam("c d"));
+            fct_xchk((attoHTTPGetURLParam("hell") == NULL), "'hell' was found");
+            fct_xchk((attoHTTPGetURLParam("missing") == NULL), "'missing' was found");
+            // Look again to make sure nothing was used up
+            fct_chk_eq_str("1", attoHTTPGetURLParam("hello"));
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"GET /l?hello=%31&goodbye=%7Bhere%20And%20There%7d&flag&c%20d=a+b HTTP/1.0\r\nAccept: application/json\r\n\r\n",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests looking up URL params by position
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETParamsByIndex) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            const attoHTTPParam_t *param;
+            param = attoHTTPURLParamIndex(1);
+            fct_xchk((param != NULL), "Param 1 was NULL");
+            if (param != NULL) {
+                fct_chk_eq_str("goodbye", param->name);
+                fct_chk_eq_str("hereAndThere", param->value);
+                fct_xchk((param->name_len == 7), "name_len was %d", param->name_len);
+                fct_xchk((param->value_len == 12), "value_len was %d", param->value_len);
+            }
+            param = attoHTTPURLParamIndex(0);
+            fct_xchk((param != NULL), "Param 0 was NULL");
+            if (param != NULL) {
+                fct_chk_eq_str("hello", param->name);
+                fct_chk_eq_str("1", param->value);
+            }
+            fct_xchk((attoHTTPURLParamIndex(2) == NULL), "Param 2 was not NULL");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"GET /level1?&hello=1&&goodbye=hereAndThere HTTP/1.0\r\nAccept: application/json\r\n\r\n",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests mixing name lookups with attoHTTPParseParam
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETParamsByNameThenParse) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            char name[40];
+            char value[40];
+
+            fct_chk_eq_str("hereAndThere", attoHTTPGetURLParam("goodbye"));
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 1), "Return was not 1");
+            fct_chk_eq_str("hello", name);
+            fct_chk_eq_str("1", value);
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 1), "Return was not 1");
+            fct_chk_eq_str("goodbye", name);
+            fct_chk_eq_str("hereAndThere", value);
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 0), "Return was not 0");
+            fct_chk_eq_str("1", attoHTTPGetURLParam("hello"));
+
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"GET /level1?hello=1&goodbye=hereAndThere HTTP/1.0\r\nAccept: application/json\r\n\r\n",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a URL with no parameters
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETParamsNone) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            fct_xchk((attoHTTPURLParamCount() == 0), "Count was not 0");
+            fct_xchk((attoHTTPGetURLParam("hello") == NULL), "'hello' was found");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"GET /level1 HTTP/1.0\r\nAccept: application/json\r\n\r\n",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests bad % escapes in the URL
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETParamsBadEscape) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            fct_xchk((attoHTTPURLParamCount() == 2), "Count was %d not 2", attoHTTPURLParamCount());
+            fct_xchk((attoHTTPParamError() == 1), "Error was not set");
+            fct_chk_eq_str("1", attoHTTPGetURLParam("hello"));
+            fct_xchk((attoHTTPGetURLParam("bad") == NULL), "'bad' was found");
+            fct_chk_eq_str("3", attoHTTPGetURLParam("last"));
+            fct_xchk((attoHTTPGetURLParam("end") == NULL), "'end' was found");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"GET /l?hello=1&bad=%zz&last=3&end=%4 HTTP/1.0\r\nAccept: application/json\r\n\r\n",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests '+' and bad % escapes in a url encoded body
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testPOSTParamsPlusAndBadEscape) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            char name[40];
+            char value[40];
+
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 1), "Return was not 1");
+            fct_chk_eq_str("hello", name);
+            fct_chk_eq_str("here and there", value);
+            fct_xchk((attoHTTPParamError() == 0), "Error was set");
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 0), "Return was not 0");
+            fct_xchk((attoHTTPParamError() == 1), "Error was not set");
+
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"POST /level1 HTTP/1.0\r\nAccept: application/json\r\nContent-Type: application/x-www-form-urlencoded\r\n\r\nhello=here+and%20there&goodbye=%G1",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests decoding a whole buffer
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testURLDecode) {
+        int32_t ret;
+        uint8_t input[] = "%7Bhere+And%20There%7d%e2%82%AC";
+        uint8_t output[40];
+        ret = attoHTTPURLDecode(input, strlen((char *)input), output, sizeof(output));
+        fct_xchk((ret == 19), "Return was %d not 19", ret);
+        fct_chk_eq_str("{here And There}\xe2\x82\xac", (char *)output);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests decoding a whole buffer in place
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testURLDecodeInPlace) {
+        int32_t ret;
+        uint8_t input[] = "a%20b+c";
+        ret = attoHTTPURLDecode(input, strlen((char *)input), input, sizeof(input));
+        fct_xchk((ret == 5), "Return was %d not 5", ret);
+        fct_chk_eq_str("a b c", (char *)input);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests decoding a buffer with bad escapes
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testURLDecodeBadEscape) {
+        uint8_t output[40];
+        fct_xchk((attoHTTPURLDecode((uint8_t *)"ab%2", 4, output, sizeof(output)) == -1), "Short escape was not caught");
+        fct_xchk((attoHTTPURLDecode((uint8_t *)"ab%2g", 5, output, sizeof(output)) == -1), "Bad escape was not caught");
+        fct_xchk((attoHTTPURLDecode((uint8_t *)"%%41", 4, output, sizeof(output)) == -1), "Bad escape was not caught");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests decoding into a buffer that is too small
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testURLDecodeOutputBufferTooSmall) {
+        int32_t ret;
+        uint8_t output[4];
+        ret = attoHTTPURLDecode((uint8_t *)"%41%42%43%44", 12, output, sizeof(output));
+        fct_xchk((ret == 3), "Return was %d not 3", ret);
+        fct_chk_eq_str("ABC", (char *)output);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that url encoded params stop at the Content-Length
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testPOSTParamsContentLength) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            char name[40];
+            char value[40];
+
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 1), "Return was not 1");
+            fct_chk_eq_str("hello", name);
+            fct_chk_eq_str("1", value);
+            ret = attoHTTPParseParam(name, 40, value, 40);
+            fct_xchk((ret == 0), "Return was not 0");
+            fct_xchk((attoHTTPBodyLeft() == 0), "Body left was not 0");
+
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"POST /level1 HTTP/1.0\r\nContent-Length: 7\r\nContent-Type: application/x-www-form-urlencoded\r\n\r\nhello=1&goodbye=hereAndThere",
+                              (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests reading the body in a block
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testPOSTReadBody) {
+        returncode_t ret;
+        char read_buffer[] = "POST /level1 HTTP/1.0\r\nContent-Length: 10\r\n\r\n0123456789Extra";
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t buf[40];
+            uint16_t len;
+
+            fct_xchk((attoHTTPBodyLeft() == 10), "Body left was not 10");
+            len = attoHTTPReadBody(buf, 4);
+            fct_xchk((len == 4), "Length was %d not 4", len);
+            fct_xchk((memcmp(buf, "0123", 4) == 0), "Data was wrong");
+            len = attoHTTPReadBody(buf, sizeof(buf));
+            fct_xchk((len == 6), "Length was %d not 6", len);
+            fct_xchk((memcmp(buf, "456789", 6) == 0), "Data was wrong");
+            fct_xchk((attoHTTPBodyLeft() == 0), "Body left was not 0");
+            len = attoHTTPReadBody(buf, sizeof(buf));
+            fct_xchk((len == 0), "Length was %d not 0", len);
+            // Nothing past the body was read
+            fct_xchk((TestReadCount == (strlen(read_buffer) - 5)), "Read %d bytes", TestReadCount);
+
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)read_buffer,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests reading the body with no Content-Length
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testPOSTReadBodyNoLength) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t buf[40];
+            uint16_t len;
+
+            fct_xchk((attoHTTPBodyLeft() == ATTOHTTP_LENGTH_UNKNOWN), "Body left was not unknown");
+            len = attoHTTPReadBody(buf, sizeof(buf));
+            fct_xchk((len == 15), "Length was %d not 15", len);
+            fct_xchk((memcmp(buf, "0123456789Extra", 15) == 0), "Data was wrong");
+
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"POST /level1 HTTP/1.0\r\n\r\n0123456789Extra",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a bad Content-Length
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testPOSTBadContentLength) {
+        returncode_t ret;
+        ret = attoHTTPExecute(
+            (void *)"POST /level1 HTTP/1.0\r\nContent-Length: 12a\r\n\r\n0123456789Extra",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_BADREQUEST), "Return was not 'STATUS_BADREQUEST'");
+        fct_chk_eq_str("HTTP/1.0 400 Bad Request\r\n", write_buffer);
+    }
+    FCT_TEST_END()
 
 
 }
@@ -0,0 +1,243 @@
+/**
+ * @file    test/test_attohttpratelimit.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define WRITE_BUFFER_SIZE 256
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#define PEER 0x0A000001
+#define OTHER_PEER 0x0A000002
+
+static const char reject_return[] = "HTTP/1.0 429 Too Many Requests\r\nRetry-After: " XSTR(ATTOHTTP_RATE_RETRY_AFTER) "\r\nContent-Length: 0\r\n\r\n";
+static const char shed_return[] = "HTTP/1.0 503 Service Unavailable\r\nRetry-After: " XSTR(ATTOHTTP_SHED_RETRY_AFTER) "\r\nContent-Length: 0\r\n\r\n";
+
+static char write_buffer[WRITE_BUFFER_SIZE];
+
+/**
+ * @brief Opens and closes connections from a peer until it is turned away
+ *
+ * @return The number of connections that were let in
+ */
+static uint32_t
+TestPeerDrain(uint32_t peer, uint32_t now)
+{
+    uint32_t count = 0;
+    while ((count < 100000) && attoHTTPPeerOpen(peer, now)) {
+        attoHTTPPeerClose(peer);
+        count++;
+    }
+    return count;
+}
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttpratelimit)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPInit();
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests the rejection that is sent before anything is read
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRejectTooManyRequests) {
+        returncode_t ret;
+        ret = attoHTTPReject((void *)write_buffer, STATUS_TOO_MANY_REQUESTS);
+        fct_xchk((ret == STATUS_TOO_MANY_REQUESTS), "Return was not 'STATUS_TOO_MANY_REQUESTS' (%d)", ret);
+        fct_chk_eq_str(reject_return, write_buffer);
+        fct_xchk((TestReadCount == 0), "Read %d bytes", (int)TestReadCount);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ret = attoHTTPReject((void *)write_buffer, STATUS_OK);
+        fct_xchk((ret == STATUS_RUNKNOWN), "Return was not 'STATUS_RUNKNOWN' (%d)", ret);
+        fct_xchk((TestWriteCount == 0), "Wrote %d bytes", (int)TestWriteCount);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the rejection that is sent when the server is too busy
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRejectServiceUnavailable) {
+        returncode_t ret;
+        ret = attoHTTPReject((void *)write_buffer, STATUS_SERVICE_UNAVAILABLE);
+        fct_xchk((ret == STATUS_SERVICE_UNAVAILABLE), "Return was not 'STATUS_SERVICE_UNAVAILABLE' (%d)", ret);
+        fct_chk_eq_str(shed_return, write_buffer);
+        fct_xchk((TestReadCount == 0), "Read %d bytes", (int)TestReadCount);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the overload detector
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testOverloaded) {
+        static char sub_buffer[2][WRITE_BUFFER_SIZE];
+        fct_xchk((attoHTTPOverloaded(0, 0) == 0), "Overloaded with nothing going on");
+        fct_xchk((attoHTTPOverloaded(ATTOHTTP_SHED_QUEUE - 1, 0) == 0), "Overloaded with a short queue");
+        fct_xchk((attoHTTPOverloaded(ATTOHTTP_SHED_QUEUE, 0) == 1), "Not overloaded with a full queue");
+        // So do connections waiting for their request line
+        fct_xchk((attoHTTPOverloaded(0, ATTOHTTP_SHED_CONNECTIONS - 1) == 0), "Overloaded with 1 less than the limit held");
+        fct_xchk((attoHTTPOverloaded(0, ATTOHTTP_SHED_CONNECTIONS) == 1), "Not overloaded with the limit held");
+        // Connections held open count too
+        attoHTTPSSEAdd((void *)sub_buffer[0], NULL);
+        attoHTTPSSEAdd((void *)sub_buffer[1], NULL);
+        fct_xchk((attoHTTPOverloaded(0, 0) == 0), "Overloaded with 2 in flight");
+        fct_xchk((attoHTTPOverloaded(ATTOHTTP_SHED_CONNECTIONS - 3, 0) == 0), "Overloaded with 1 less than the limit in flight");
+        fct_xchk((attoHTTPOverloaded(ATTOHTTP_SHED_CONNECTIONS - 2, 0) == 1), "Not overloaded with the limit in flight");
+        attoHTTPSSERemove(0);
+        attoHTTPSSERemove(1);
+        fct_xchk((attoHTTPOverloaded(ATTOHTTP_SHED_CONNECTIONS - 2, 0) == 0), "Still overloaded after they closed");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a peer gets a burst, and then refills at the set rate
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRateLimitBurst) {
+        uint32_t now = 5000;
+        uint32_t count;
+        count = TestPeerDrain(PEER, now);
+        fct_xchk((count == ATTOHTTP_RATE_BURST), "Burst was %u not %u", (unsigned)count, (unsigned)ATTOHTTP_RATE_BURST);
+        // Just short of one request
+        now += (1000 / ATTOHTTP_RATE_PER_SEC) - 1;
+        fct_xchk((attoHTTPPeerOpen(PEER, now) == 0), "Let in before the bucket refilled");
+        now += 1;
+        count = TestPeerDrain(PEER, now);
+        fct_xchk((count == 1), "Let in %u after one refill", (unsigned)count);
+        // A long time later the bucket is full, but not over full
+        now += 3600000;
+        count = TestPeerDrain(PEER, now);
+        fct_xchk((count == ATTOHTTP_RATE_BURST), "Refilled to %u not %u", (unsigned)count, (unsigned)ATTOHTTP_RATE_BURST);
+        // The clock wrapping around doesn't matter
+        now = 0xFFFFFFFF - 10;
+        TestPeerDrain(PEER, now);
+        now += 1000;
+        count = TestPeerDrain(PEER, now);
+        fct_xchk((count == ATTOHTTP_RATE_PER_SEC), "Let in %u after the clock wrapped", (unsigned)count);
+        // Other peers have their own buckets
+        count = TestPeerDrain(OTHER_PEER, now);
+        fct_xchk((count == ATTOHTTP_RATE_BURST), "Other peer got %u", (unsigned)count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the cap on connections a peer can have open at once
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRateLimitConnections) {
+        uint32_t i;
+        for (i = 0; i < ATTOHTTP_RATE_CONNECTIONS; i++) {
+            fct_xchk((attoHTTPPeerOpen(PEER, 100) == 1), "Connection %u was turned away", (unsigned)i);
+        }
+        fct_xchk((attoHTTPPeerOpen(PEER, 100) == 0), "Let in too many connections");
+        fct_xchk((attoHTTPPeerOpen(OTHER_PEER, 100) == 1), "Other peer was turned away");
+        attoHTTPPeerClose(PEER);
+        fct_xchk((attoHTTPPeerOpen(PEER, 100) == 1), "Closed connection was not given back");
+        // Closing more than was opened doesn't give extra connections
+        for (i = 0; i < 10; i++) {
+            attoHTTPPeerClose(PEER);
+        }
+        attoHTTPPeerClose(0x7F000001);
+        for (i = 0; i < ATTOHTTP_RATE_CONNECTIONS; i++) {
+            fct_xchk((attoHTTPPeerOpen(PEER, 100000) == 1), "Connection %u was turned away", (unsigned)i);
+        }
+        fct_xchk((attoHTTPPeerOpen(PEER, 100000) == 0), "Let in too many connections");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that old peers are dropped, but busy ones are kept
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRateLimitEviction) {
+        uint32_t i;
+        uint32_t count;
+        // This one stays busy the whole time
+        fct_xchk((attoHTTPPeerOpen(PEER, 100) == 1), "Busy peer was turned away");
+        // This one has an empty bucket, and then gets forgotten
+        TestPeerDrain(OTHER_PEER, 100);
+        for (i = 0; i < 1000; i++) {
+            if (attoHTTPPeerOpen(0xC0A80000 + i, 100)) {
+                attoHTTPPeerClose(0xC0A80000 + i);
+            }
+        }
+        count = TestPeerDrain(OTHER_PEER, 100);
+        fct_xchk((count == ATTOHTTP_RATE_BURST), "Forgotten peer got %u not %u", (unsigned)count, (unsigned)ATTOHTTP_RATE_BURST);
+        for (i = 1; i < ATTOHTTP_RATE_CONNECTIONS; i++) {
+            fct_xchk((attoHTTPPeerOpen(PEER, 100) == 1), "Busy peer was turned away");
+        }
+        fct_xchk((attoHTTPPeerOpen(PEER, 100) == 0), "Busy peer was forgotten");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests what happens when every slot has a connection open
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRateLimitFull) {
+        uint32_t i;
+        for (i = 0; i < 1000; i++) {
+            if (!attoHTTPPeerOpen(0xC0A80000 + i, 100)) {
+                break;
+            }
+        }
+        fct_xchk((i >= ATTOHTTP_RATE_PEERS / 4), "Only %u peers fit", (unsigned)i);
+        fct_xchk((i <= ATTOHTTP_RATE_PEERS), "%u peers fit in %u slots", (unsigned)i, (unsigned)ATTOHTTP_RATE_PEERS);
+        fct_xchk((attoHTTPPeerOpen(0xC0A80000 + i, 100) == 0), "Let in with no room");
+        // Once everyone is done there is room again
+        while (i > 0) {
+            i--;
+            attoHTTPPeerClose(0xC0A80000 + i);
+        }
+        fct_xchk((attoHTTPPeerOpen(0xC0A80000 + 1000, 100) == 1), "No room after they closed");
+    }
+    FCT_TEST_END()
+
+}
+FCTMF_FIXTURE_SUITE_END();
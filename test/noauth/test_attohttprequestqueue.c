@@ -0,0 +1,169 @@
+/**
+ * @file    test/test_attohttprequestqueue.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define CheckClass(line, expect) fct_xchk((attoHTTPClassify((const uint8_t *)(line), sizeof(line) - 1) == (expect)), "'%s' was not " #expect, line)
+
+static const uint8_t page_content[] = "Page";
+static int conns[ATTOHTTP_REQUEST_QUEUE_API + ATTOHTTP_REQUEST_QUEUE_STATIC + 2];
+
+static returncode_t
+TestREST(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+{
+    return STATUS_OK;
+}
+#ifdef ATTOHTTP_WEBSOCKET
+static void
+TestWSMessage(int8_t ws, wsopcode_t opcode, uint8_t *data, uint16_t len)
+{
+}
+#endif
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttprequestqueue)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        attoHTTPInit();
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests sorting requests by their request line
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testClassify) {
+        char longurl[ATTOHTTP_URL_BUFFER_SIZE + 8] = "GET /";
+        attoHTTPAddPage("/index.html", page_content, sizeof(page_content), TEXT_HTML);
+        attoHTTPServerSetEventsURL("/events");
+        // Without a REST callback, anything that isn't a page is a 404
+        CheckClass("GET /api/status HTTP/1.1\r\n", REQUEST_STATIC);
+        attoHTTPDefaultREST(TestREST);
+        CheckClass("GET /index.html HTTP/1.1\r\n", REQUEST_STATIC);
+        CheckClass("GET /index.html?v=2 HTTP/1.0\r\n", REQUEST_STATIC);
+        CheckClass("GET /favicon.ico HTTP/1.1\r\n", REQUEST_STATIC);
+        CheckClass("\r\nGET  /index.html\r\n", REQUEST_STATIC);
+        CheckClass("GET /events HTTP/1.1\r\n", REQUEST_API);
+        CheckClass("POST /api/status HTTP/1.1\r\n", REQUEST_API);
+        CheckClass("GET /index.htm HTTP/1.1\r\n", REQUEST_API);
+#ifdef ATTOHTTP_WEBSOCKET
+        attoHTTPAddWebSocket("/ws", TestWSMessage);
+        CheckClass("GET /ws HTTP/1.1\r\n", REQUEST_API);
+#endif
+        // Not enough to tell yet
+        CheckClass("", REQUEST_PENDING);
+        CheckClass("\r\n", REQUEST_PENDING);
+        CheckClass("GET", REQUEST_PENDING);
+        CheckClass("GET ", REQUEST_PENDING);
+        CheckClass("GET /index.html", REQUEST_PENDING);
+        // URLs that are too long are cut off, like attoHTTPExecute() does
+        memset(&longurl[5], 'a', sizeof(longurl) - 6);
+        longurl[sizeof(longurl) - 1] = 0;
+        fct_xchk((attoHTTPClassify((uint8_t *)longurl, strlen(longurl)) == REQUEST_API), "Long URL was not classified");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that API requests go first, and each class stays in order
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testQueueOrder) {
+        uint8_t i;
+        fct_xchk((attoHTTPQueueNext() == NULL), "Empty queue gave a connection");
+        fct_xchk((attoHTTPQueueAdd(&conns[0], REQUEST_STATIC) == 1), "Static add failed");
+        fct_xchk((attoHTTPQueueAdd(&conns[1], REQUEST_STATIC) == 1), "Static add failed");
+        fct_xchk((attoHTTPQueueAdd(&conns[2], REQUEST_API) == 1), "API add failed");
+        fct_xchk((attoHTTPQueueAdd(&conns[3], REQUEST_API) == 1), "API add failed");
+        fct_xchk((attoHTTPQueueAdd(&conns[4], REQUEST_PENDING) == 0), "Pending add worked");
+        fct_xchk((attoHTTPQueueAdd(NULL, REQUEST_API) == 0), "NULL add worked");
+        fct_xchk((attoHTTPQueueCount() == 4), "Count was %u not 4", attoHTTPQueueCount());
+        fct_xchk((attoHTTPQueueNext() == &conns[2]), "First API request wasn't first");
+        fct_xchk((attoHTTPQueueNext() == &conns[3]), "Second API request wasn't second");
+        fct_xchk((attoHTTPQueueNext() == &conns[0]), "First static request wasn't third");
+        fct_xchk((attoHTTPQueueAdd(&conns[4], REQUEST_API) == 1), "API add failed");
+        fct_xchk((attoHTTPQueueNext() == &conns[4]), "Late API request didn't go ahead");
+        fct_xchk((attoHTTPQueueNext() == &conns[1]), "Second static request wasn't last");
+        fct_xchk((attoHTTPQueueNext() == NULL), "Empty queue gave a connection");
+        fct_xchk((attoHTTPQueueCount() == 0), "Count was %u not 0", attoHTTPQueueCount());
+        // Each class has its own limit, and the rings wrap around
+        for (i = 0; i < ATTOHTTP_REQUEST_QUEUE_STATIC; i++) {
+            fct_xchk((attoHTTPQueueAdd(&conns[i], REQUEST_STATIC) == 1), "Static add %u failed", i);
+        }
+        fct_xchk((attoHTTPQueueAdd(&conns[i], REQUEST_STATIC) == 0), "Static add over the limit worked");
+        for (i = 0; i < ATTOHTTP_REQUEST_QUEUE_API; i++) {
+            fct_xchk((attoHTTPQueueAdd(&conns[i], REQUEST_API) == 1), "API add %u failed", i);
+        }
+        fct_xchk((attoHTTPQueueAdd(&conns[i], REQUEST_API) == 0), "API add over the limit worked");
+        for (i = 0; i < ATTOHTTP_REQUEST_QUEUE_API; i++) {
+            fct_xchk((attoHTTPQueueNext() == &conns[i]), "API request %u out of order", i);
+        }
+        for (i = 0; i < ATTOHTTP_REQUEST_QUEUE_STATIC; i++) {
+            fct_xchk((attoHTTPQueueNext() == &conns[i]), "Static request %u out of order", i);
+        }
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that static requests still get served under steady API traffic
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testQueueStreak) {
+        uint16_t i;
+        attoHTTPQueueAdd(&conns[0], REQUEST_STATIC);
+        for (i = 0; i < ATTOHTTP_REQUEST_QUEUE_STREAK; i++) {
+            attoHTTPQueueAdd(&conns[1], REQUEST_API);
+            fct_xchk((attoHTTPQueueNext() == &conns[1]), "API request %u didn't go first", i);
+        }
+        attoHTTPQueueAdd(&conns[1], REQUEST_API);
+        fct_xchk((attoHTTPQueueNext() == &conns[0]), "Static request was starved");
+        fct_xchk((attoHTTPQueueNext() == &conns[1]), "API request was lost");
+        // The streak starts over
+        attoHTTPQueueAdd(&conns[0], REQUEST_STATIC);
+        attoHTTPQueueAdd(&conns[1], REQUEST_API);
+        fct_xchk((attoHTTPQueueNext() == &conns[1]), "API request didn't go first");
+    }
+    FCT_TEST_END()
+
+}
+FCTMF_FIXTURE_SUITE_END();
@@ -42,6 +42,19 @@ static const char default_return[] = "HTTP/1.0 200 OK\r\nContent-Type: text/even
 
 
 char write_buffer[WRITE_BUFFER_SIZE];
+static char sub_buffer[ATTOHTTP_SSE_SUBSCRIBERS][WRITE_BUFFER_SIZE];
+static void *closed;
+static uint8_t close_count;
+
+extern uint32_t _attoHTTPSSELastID;
+extern attoHTTPSSESubscriber_t _attoHTTPSSESubscribers[ATTOHTTP_SSE_SUBSCRIBERS];
+
+static void
+TestSSEClose(void *write)
+{
+    closed = write;
+    close_count++;
+}
 
 FCTMF_FIXTURE_SUITE_BGN(test_attohttpserversentevents)
 {
@@ -53,6 +66,9 @@ FCTMF_FIXTURE_SUITE_BGN(test_attohttpserversentevents)
     FCT_SETUP_BGN() {
         TestInit();
         memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        memset(sub_buffer, 0, sizeof(sub_buffer));
+        closed = NULL;
+        close_count = 0;
         attoHTTPInit();
     }
     FCT_SETUP_END();
@@ -119,6 +135,752 @@ FCTMF_FIXTURE_SUITE_BGN(test_attohttpserversentevents)
         fct_chk_eq_str(expect, write_buffer);
     }
     FCT_TEST_END()
+    /**
+     * @brief This tests filling up the subscriber list
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEAddFull) {
+        uint8_t i;
+        int8_t sub;
+        fct_xchk((attoHTTPSSECount() == 0), "Count was %d", attoHTTPSSECount());
+        for (i = 0; i < ATTOHTTP_SSE_SUBSCRIBERS; i++) {
+            sub = attoHTTPSSEAdd((void *)sub_buffer[i], TestSSEClose);
+            fct_xchk((sub == i), "Handle was %d, expected %d", sub, i);
+        }
+        fct_xchk((attoHTTPSSECount() == ATTOHTTP_SSE_SUBSCRIBERS), "Count was %d", attoHTTPSSECount());
+        sub = attoHTTPSSEAdd((void *)write_buffer, TestSSEClose);
+        fct_xchk((sub == -1), "Handle was %d, expected -1", sub);
+        sub = attoHTTPSSEAdd(NULL, TestSSEClose);
+        fct_xchk((sub == -1), "Handle was %d, expected -1", sub);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests sending an event to every subscriber
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEBroadcast) {
+        uint8_t count;
+        char *expect = "id:1\nevent:ASDF\ndata:fsda\n\n";
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        count = attoHTTPSSEBroadcast("ASDF", 4, "fsda", 4);
+        fct_xchk((count == 2), "Count was %d, expected 2", count);
+        fct_chk_eq_str(expect, sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+        fct_chk_eq_str("", sub_buffer[2]);
+        fct_xchk((close_count == 0), "Closed %d subscribers", close_count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests sending an event to one subscriber
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSESendOne) {
+        uint16_t count;
+        int8_t sub;
+        char *expect = "data:fsda\n\n";
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        count = attoHTTPSSESend(sub, "", 0, "fsda", 4);
+        fct_xchk((strlen(expect) == count), "Count was %d, expected %d", count, strlen(expect));
+        fct_chk_eq_str("", sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+        count = attoHTTPSSESend(ATTOHTTP_SSE_SUBSCRIBERS - 1, "", 0, "fsda", 4);
+        fct_xchk((count == 0), "Count was %d, expected 0", count);
+        count = attoHTTPSSESend(-1, "", 0, "fsda", 4);
+        fct_xchk((count == 0), "Count was %d, expected 0", count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a subscriber that fails a write gets dropped
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEDeadSubscriber) {
+        uint8_t count;
+        char *expect = "id:1\nevent:ASDF\n\n";
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestWriteFail = (uint8_t *)sub_buffer[0];
+        count = attoHTTPSSEBroadcast("ASDF", 4, "", 0);
+        fct_xchk((count == 1), "Count was %d, expected 1", count);
+        fct_xchk((attoHTTPSSECount() == 1), "%d subscribers left", attoHTTPSSECount());
+        fct_xchk((close_count == 1), "Closed %d subscribers", close_count);
+        fct_xchk((closed == (void *)sub_buffer[0]), "Closed the wrong subscriber");
+        fct_chk_eq_str(expect, sub_buffer[1]);
+        // The slot can be used again
+        count = attoHTTPSSEAdd((void *)sub_buffer[2], TestSSEClose);
+        fct_xchk((count == 0), "Handle was %d, expected 0", count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests removing a subscriber
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSERemove) {
+        int8_t sub;
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSERemove(sub) == 1), "Remove failed");
+        fct_xchk((closed == (void *)sub_buffer[0]), "Closed the wrong subscriber");
+        fct_xchk((attoHTTPSSERemove(sub) == 0), "Removed twice");
+        fct_xchk((attoHTTPSSERemove(ATTOHTTP_SSE_SUBSCRIBERS) == 0), "Removed out of range");
+        fct_xchk((close_count == 1), "Closed %d subscribers", close_count);
+        fct_xchk((attoHTTPSSECount() == 0), "%d subscribers left", attoHTTPSSECount());
+        // No close callback is fine
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], NULL);
+        fct_xchk((attoHTTPSSERemove(sub) == 1), "Remove failed");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the new subscriber callback
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSESubscribeCallback) {
+        int8_t sub;
+        char *expect = "event:hello\n\n";
+        void Subscribed(int8_t s) {
+            attoHTTPSSESend(s, "hello", 5, "", 0);
+        }
+        attoHTTPSSESetSubscribeCallback(Subscribed);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        fct_xchk((sub == 1), "Handle was %d, expected 1", sub);
+        fct_chk_eq_str(expect, sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that published events wait for a flush
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPublishFlush) {
+        uint8_t count;
+        int8_t sub;
+        char *expect = "id:1\nevent:one\n\nid:2\ndata:two\n\n";
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        fct_xchk((attoHTTPSSEPublish("one", 3, "", 0) == 1), "Publish failed");
+        fct_xchk((attoHTTPSSEPublish("", 0, "two", 3) == 1), "Publish failed");
+        fct_xchk((attoHTTPSSEPending(sub) == strlen(expect)), "%d bytes pending", attoHTTPSSEPending(sub));
+        fct_chk_eq_str("", sub_buffer[0]);
+        count = attoHTTPSSEFlush();
+        fct_xchk((count == 2), "Count was %d, expected 2", count);
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "%d bytes pending", attoHTTPSSEPending(sub));
+        fct_chk_eq_str(expect, sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that events come out right when the ring wraps around
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSERingWrap) {
+        uint16_t i;
+        char expect[WRITE_BUFFER_SIZE];
+        char event[32];
+        memset(expect, 0, sizeof(expect));
+        TestWriteChunk = 7;
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        for (i = 1; (strlen(expect) + sizeof(event)) < sizeof(expect); i++) {
+            attoHTTPSSEBroadcast("", 0, "0123456789", 10);
+            sprintf(event, "id:%d\ndata:0123456789\n\n", i);
+            strcat(expect, event);
+        }
+        fct_xchk((strlen(expect) > ATTOHTTP_SSE_RING_SIZE), "The ring didn't wrap");
+        fct_chk_eq_str(expect, sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a subscriber that can't take any data for a while
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEFullSubscriber) {
+        uint8_t count;
+        int8_t sub;
+        char *expect = "id:1\nevent:ASDF\n\nid:2\nevent:ASDF\n\n";
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[1];
+        count = attoHTTPSSEBroadcast("ASDF", 4, "", 0);
+        fct_xchk((count == 1), "Count was %d, expected 1", count);
+        count = attoHTTPSSEBroadcast("ASDF", 4, "", 0);
+        fct_xchk((count == 1), "Count was %d, expected 1", count);
+        fct_xchk((attoHTTPSSEPending(sub) == strlen(expect)), "%d bytes pending", attoHTTPSSEPending(sub));
+        fct_xchk((attoHTTPSSESend(sub, "x", 1, "", 0) == 0), "Sent around the pending data");
+        fct_chk_eq_str("", sub_buffer[1]);
+        TestWriteFull = NULL;
+        count = attoHTTPSSEFlush();
+        fct_xchk((count == 2), "Count was %d, expected 2", count);
+        fct_chk_eq_str(expect, sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+        fct_xchk((close_count == 0), "Closed %d subscribers", close_count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a subscriber that falls a whole ring behind is dropped
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSESlowSubscriberDropped) {
+        uint16_t i;
+        char data[100];
+        memset(data, 'a', sizeof(data));
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[1];
+        // Small events run out of history entries first
+        for (i = 0; (attoHTTPSSECount() == 2) && (i < ATTOHTTP_SSE_RING_SIZE); i++) {
+            attoHTTPSSEPublish("", 0, "0123456789", 10);
+        }
+        fct_xchk((i == (ATTOHTTP_SSE_HISTORY + 1)), "Dropped after %d events", i);
+        fct_xchk((attoHTTPSSECount() == 1), "%d subscribers left", attoHTTPSSECount());
+        fct_xchk((closed == (void *)sub_buffer[1]), "Closed the wrong subscriber");
+        fct_chk_eq_str("", sub_buffer[1]);
+        // Big events run out of ring first
+        attoHTTPSSEAdd((void *)sub_buffer[2], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[2];
+        for (i = 0; (attoHTTPSSECount() == 2) && (i < ATTOHTTP_SSE_RING_SIZE); i++) {
+            attoHTTPSSEPublish("", 0, data, sizeof(data));
+        }
+        fct_xchk(((i * 113) > ATTOHTTP_SSE_RING_SIZE), "Dropped after %d events", i);
+        fct_xchk((i <= ATTOHTTP_SSE_HISTORY), "Dropped after %d events", i);
+        fct_xchk((closed == (void *)sub_buffer[2]), "Closed the wrong subscriber");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that an event too big for the ring isn't published
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPublishTooBig) {
+        char data[ATTOHTTP_SSE_RING_SIZE];
+        memset(data, 'a', sizeof(data));
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSEPublish("", 0, data, sizeof(data)) == 0), "Published anyway");
+        fct_xchk((attoHTTPSSEPending(0) == 0), "%d bytes pending", attoHTTPSSEPending(0));
+        fct_xchk((attoHTTPSSEBroadcast("", 0, data, sizeof(data)) == 0), "Broadcast anyway");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the retry field after the headers
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSERetry) {
+        returncode_t ret;
+        char expect[sizeof(default_return) + 16];
+        sprintf(expect, "%sretry:2500\n\n", default_return);
+        attoHTTPServerSetEventsURL("/sse");
+        attoHTTPSSESetRetry(2500);
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nAccept: text/html\r\n\r\n",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_SERVERSENTEVENTS), "Return was not 'STATUS_SERVERSENTEVENTS' (%d)", ret);
+        fct_chk_eq_str(expect, write_buffer);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests replaying the events after Last-Event-ID
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSELastEventID) {
+        returncode_t ret;
+        int8_t sub;
+        char *expect = "id:3\ndata:three\n\nid:4\ndata:four\n\n";
+        attoHTTPServerSetEventsURL("/sse");
+        attoHTTPSSEPublish("", 0, "one", 3);
+        attoHTTPSSEPublish("", 0, "two", 3);
+        attoHTTPSSEPublish("", 0, "three", 5);
+        attoHTTPSSEPublish("", 0, "four", 4);
+        fct_xchk((attoHTTPSSELastID() == 4), "Last id was %d", attoHTTPSSELastID());
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: 2\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSEPending(sub) == strlen(expect)), "%d bytes pending", attoHTTPSSEPending(sub));
+        attoHTTPSSEFlush();
+        fct_chk_eq_str(expect, sub_buffer[0]);
+        attoHTTPSSEBroadcast("", 0, "five", 4);
+        fct_chk_eq_str("id:3\ndata:three\n\nid:4\ndata:four\n\nid:5\ndata:five\n\n", sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that events sent straight out carry the last id
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSESendID) {
+        returncode_t ret;
+        int8_t sub;
+        uint16_t count;
+        char *expect = "id:2\ndata:hi\n\n";
+        attoHTTPServerSetEventsURL("/sse");
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEPublish("", 0, "one", 3);
+        attoHTTPSSEPublish("", 0, "two", 3);
+        count = attoHTTPSSESend(sub, "", 0, "hi", 2);
+        fct_chk_eq_str("id:1\ndata:one\n\nid:2\ndata:two\n\nid:2\ndata:hi\n\n", sub_buffer[0]);
+        fct_xchk((count == strlen(expect)), "Count was %d, expected %d", count, strlen(expect));
+        attoHTTPSSEPublish("", 0, "three", 5);
+        // Coming back with the id from the sent event picks up after it
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: 2\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        attoHTTPSSEFlush();
+        fct_chk_eq_str("id:3\ndata:three\n\n", sub_buffer[1]);
+        // Straight to a connection, nobody knows what it has got
+        attoHTTPSendEvent((void *)sub_buffer[2], "", 0, "hi", 2);
+        fct_chk_eq_str("data:hi\n\n", sub_buffer[2]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that the event ids skip 0 when they wrap around
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEIDWrap) {
+        returncode_t ret;
+        int8_t sub;
+        attoHTTPServerSetEventsURL("/sse");
+        _attoHTTPSSELastID = 0xFFFFFFFE;
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEPublish("", 0, "a", 1);
+        attoHTTPSSEPublish("", 0, "b", 1);
+        attoHTTPSSEFlush();
+        fct_chk_eq_str("id:4294967295\ndata:a\n\nid:1\ndata:b\n\n", sub_buffer[0]);
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "%d bytes pending", attoHTTPSSEPending(sub));
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: 4294967295\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        attoHTTPSSEFlush();
+        fct_chk_eq_str("id:1\ndata:b\n\n", sub_buffer[1]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a Last-Event-ID that is already up to date
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSELastEventIDCurrent) {
+        returncode_t ret;
+        int8_t sub;
+        attoHTTPServerSetEventsURL("/sse");
+        attoHTTPSSEPublish("", 0, "one", 3);
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: 1\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "%d bytes pending", attoHTTPSSEPending(sub));
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a Last-Event-ID that is too old or isn't ours
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSELastEventIDGone) {
+        returncode_t ret;
+        uint16_t i;
+        int8_t sub;
+        attoHTTPServerSetEventsURL("/sse");
+        for (i = 0; i < (ATTOHTTP_SSE_HISTORY + 1); i++) {
+            attoHTTPSSEPublish("", 0, "0123456789", 10);
+        }
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: 0\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "%d bytes pending", attoHTTPSSEPending(sub));
+        NewConnection();
+        memset(write_buffer, 0, sizeof(write_buffer));
+        ret = attoHTTPExecute(
+            (void *)"GET /sse HTTP/1.0\r\nLast-Event-ID: abc\r\n\r\n",
+            (void *)write_buffer
+        );
+        CheckDefault(ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "%d bytes pending", attoHTTPSSEPending(sub));
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the disconnect policy at the high water mark
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPolicyDisconnect) {
+        uint8_t i;
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DISCONNECT, 64) == 1), "Set policy failed");
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[1];
+        for (i = 0; i < 2; i++) {
+            attoHTTPSSEBroadcast("", 0, "0123456789", 10);
+        }
+        fct_xchk((attoHTTPSSECount() == 2), "%d subscribers left", attoHTTPSSECount());
+        attoHTTPSSEBroadcast("", 0, "0123456789", 10);
+        fct_xchk((attoHTTPSSECount() == 1), "%d subscribers left", attoHTTPSSECount());
+        fct_xchk((closed == (void *)sub_buffer[1]), "Closed the wrong subscriber");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the drop oldest policy at the high water mark
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPolicyDropOldest) {
+        uint8_t i;
+        char *expect = "id:9\ndata:0123456789\n\nid:10\ndata:0123456789\n\n";
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DROP_OLDEST, 64) == 1), "Set policy failed");
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[0];
+        for (i = 0; i < 10; i++) {
+            attoHTTPSSEBroadcast("", 0, "0123456789", 10);
+            fct_xchk((attoHTTPSSEPending(0) <= 64), "%d bytes pending", attoHTTPSSEPending(0));
+        }
+        fct_xchk((attoHTTPSSECount() == 1), "%d subscribers left", attoHTTPSSECount());
+        TestWriteFull = NULL;
+        attoHTTPSSEFlush();
+        fct_chk_eq_str(expect, sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that drop oldest finishes an event it has started
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPolicyDropOldestPartial) {
+        uint8_t i;
+        char *expect = "id:1\ndata:0123456789\n\nid:9\ndata:0123456789\n\nid:10\ndata:0123456789\n\n";
+        attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DROP_OLDEST, 64);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[0];
+        TestWriteRoom = 8;
+        for (i = 0; i < 10; i++) {
+            attoHTTPSSEBroadcast("", 0, "0123456789", 10);
+        }
+        fct_chk_eq_str("id:1\ndat", sub_buffer[0]);
+        TestWriteFull = NULL;
+        attoHTTPSSEFlush();
+        fct_chk_eq_str(expect, sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the coalesce policy at the high water mark
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPolicyCoalesce) {
+        char *all = "id:1\nevent:temp\ndata:a\n\nid:2\nevent:hum\ndata:b\n\n"
+                    "id:3\nevent:temp\ndata:c\n\nid:4\nevent:hum\ndata:d\n\n"
+                    "id:5\nevent:other\ndata:e\n\n";
+        char *expect = "id:3\nevent:temp\ndata:c\n\nid:4\nevent:hum\ndata:d\n\n"
+                       "id:5\nevent:other\ndata:e\n\n";
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_COALESCE, 32) == 1), "Set policy failed");
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[1];
+        attoHTTPSSEBroadcast("temp", 4, "a", 1);
+        attoHTTPSSEBroadcast("hum", 3, "b", 1);
+        attoHTTPSSEBroadcast("temp", 4, "c", 1);
+        attoHTTPSSEBroadcast("hum", 3, "d", 1);
+        attoHTTPSSEBroadcast("other", 5, "e", 1);
+        fct_xchk((attoHTTPSSECount() == 2), "%d subscribers left", attoHTTPSSECount());
+        TestWriteFull = NULL;
+        attoHTTPSSEFlush();
+        fct_chk_eq_str(all, sub_buffer[0]);
+        fct_chk_eq_str(expect, sub_buffer[1]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a bad high water mark
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPolicyBad) {
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DROP_OLDEST, 0) == 0), "Took a 0 high water mark");
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DROP_OLDEST, ATTOHTTP_SSE_RING_SIZE + 1) == 0), "Took a high water mark bigger than the ring");
+        fct_xchk((attoHTTPSSESetPolicy(SSE_ALL_STREAMS, SSE_DROP_OLDEST, ATTOHTTP_SSE_RING_SIZE) == 1), "Set policy failed");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that published events wait for the flush window
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEFlushWindow) {
+        uint8_t count;
+        char *expect = "id:1\ndata:a\n\nid:2\ndata:b\n\n";
+        attoHTTPSSEPoll(1000);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEPublish("", 0, "a", 1);
+        attoHTTPSSEPublish("", 0, "b", 1);
+        count = attoHTTPSSEPoll(1000 + ATTOHTTP_SSE_FLUSH_WINDOW - 1);
+        fct_xchk((count == 0), "Count was %d, expected 0", count);
+        fct_chk_eq_str("", sub_buffer[0]);
+        count = attoHTTPSSEPoll(1000 + ATTOHTTP_SSE_FLUSH_WINDOW);
+        fct_xchk((count == 1), "Count was %d, expected 1", count);
+        fct_chk_eq_str(expect, sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that the flush window starts when the event is published
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEClock) {
+        uint8_t count;
+        attoHTTPSSESetClock(attoHTTPGetMillis);
+        attoHTTPSSEPoll(1000);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestMillis = 1015;
+        attoHTTPSSEPublish("", 0, "a", 1);
+        count = attoHTTPSSEPoll(1000 + ATTOHTTP_SSE_FLUSH_WINDOW);
+        fct_xchk((count == 0), "Count was %d, expected 0", count);
+        fct_chk_eq_str("", sub_buffer[0]);
+        count = attoHTTPSSEPoll(1015 + ATTOHTTP_SSE_FLUSH_WINDOW);
+        fct_xchk((count == 1), "Count was %d, expected 1", count);
+        fct_chk_eq_str("id:1\ndata:a\n\n", sub_buffer[0]);
+        // A clock a little ahead of the last poll doesn't flush early
+        TestMillis = 1015 + ATTOHTTP_SSE_FLUSH_WINDOW + 1;
+        attoHTTPSSEPublish("", 0, "b", 1);
+        count = attoHTTPSSEPoll(1015 + ATTOHTTP_SSE_FLUSH_WINDOW);
+        fct_xchk((count == 0), "Count was %d, expected 0", count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that subscribers that can't take everything get the rest later
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEPollCatchUp) {
+        char *expect = "id:1\ndata:a\n\n";
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[0];
+        TestWriteRoom = 4;
+        attoHTTPSSEBroadcast("", 0, "a", 1);
+        fct_chk_eq_str("id:1", sub_buffer[0]);
+        TestWriteFull = NULL;
+        attoHTTPSSEPoll(5);
+        fct_chk_eq_str(expect, sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the heartbeat on idle subscribers
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEHeartbeat) {
+        attoHTTPSSEPoll(0);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEPoll(ATTOHTTP_SSE_HEARTBEAT - 1);
+        fct_chk_eq_str("", sub_buffer[0]);
+        attoHTTPSSEPoll(ATTOHTTP_SSE_HEARTBEAT);
+        fct_chk_eq_str(":\n\n", sub_buffer[0]);
+        attoHTTPSSEPoll(ATTOHTTP_SSE_HEARTBEAT + 1);
+        fct_chk_eq_str(":\n\n", sub_buffer[0]);
+        // Sending anything puts the heartbeat off
+        attoHTTPSSEPoll(ATTOHTTP_SSE_HEARTBEAT + 10);
+        attoHTTPSSEBroadcast("", 0, "a", 1);
+        attoHTTPSSEPoll((2 * ATTOHTTP_SSE_HEARTBEAT) + 9);
+        fct_chk_eq_str(":\n\nid:1\ndata:a\n\n", sub_buffer[0]);
+        attoHTTPSSEPoll((2 * ATTOHTTP_SSE_HEARTBEAT) + 10);
+        fct_chk_eq_str(":\n\nid:1\ndata:a\n\n:\n\n", sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a heartbeat that was cut short is finished first
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEHeartbeatPartial) {
+        attoHTTPSSEPoll(0);
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestWriteFull = (uint8_t *)sub_buffer[0];
+        TestWriteRoom = 1;
+        attoHTTPSSEPoll(ATTOHTTP_SSE_HEARTBEAT);
+        fct_chk_eq_str(":", sub_buffer[0]);
+        TestWriteFull = NULL;
+        attoHTTPSSEBroadcast("", 0, "a", 1);
+        fct_chk_eq_str(":\n\nid:1\ndata:a\n\n", sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that each stream URL gets its own subscribers
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEStreams) {
+        returncode_t ret;
+        int8_t sub[3];
+        fct_xchk((attoHTTPSSEAddStream("/a") == 0), "Stream a is not 0");
+        fct_xchk((attoHTTPSSEAddStream("/b") == 1), "Stream b is not 1");
+        ret = attoHTTPExecute((void *)"GET /b HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        CheckDefault(ret);
+        sub[0] = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        TestInit();
+        ret = attoHTTPExecute((void *)"GET /a HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        sub[1] = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        TestInit();
+        ret = attoHTTPExecute((void *)"GET /b HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        sub[2] = attoHTTPSSEAdd((void *)sub_buffer[2], TestSSEClose);
+        fct_xchk(((sub[0] >= 0) && (sub[1] >= 0) && (sub[2] >= 0)), "Subscribe failed");
+        fct_xchk((attoHTTPSSEBroadcastStream(1, "", 0, "b", 1) == 3), "Not everyone is caught up");
+        fct_xchk((attoHTTPSSEBroadcastStream(0, "", 0, "a", 1) == 3), "Not everyone is caught up");
+        fct_xchk((attoHTTPSSEBroadcast("", 0, "all", 3) == 3), "Not everyone is caught up");
+        fct_chk_eq_str("id:1\ndata:b\n\nid:3\ndata:all\n\n", sub_buffer[0]);
+        fct_chk_eq_str("id:2\ndata:a\n\nid:3\ndata:all\n\n", sub_buffer[1]);
+        fct_chk_eq_str("id:1\ndata:b\n\nid:3\ndata:all\n\n", sub_buffer[2]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the stream limits and methods on stream URLs
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEStreamBad) {
+        returncode_t ret;
+        uint8_t i;
+        for (i = 0; i < ATTOHTTP_SSE_STREAMS; i++) {
+            fct_xchk((attoHTTPSSEAddStream("/s") == (int8_t)i), "Stream %d not added", i);
+        }
+        fct_xchk((attoHTTPSSEAddStream("/s") == -1), "Added too many streams");
+        fct_xchk((attoHTTPSSEPublishStream(ATTOHTTP_SSE_STREAMS, "", 0, "a", 1) == 0), "Published to a bad stream");
+        fct_xchk((attoHTTPSSESetPolicy(-2, SSE_DISCONNECT, 64) == 0), "Set the policy on a bad stream");
+        ret = attoHTTPExecute((void *)"POST /s HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_UNSUPPORTED), "Return was not 'STATUS_UNSUPPORTED' (%d)", ret);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that the length of an event stream page isn't a stream
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEStreamPageLength) {
+        returncode_t ret;
+        int8_t sub;
+        attoHTTPAddPage("/events", (const uint8_t *)"x", 200, TEXT_EVENTSTREAM);
+        ret = attoHTTPExecute((void *)"GET /events HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_SERVERSENTEVENTS), "Return was not 'STATUS_SERVERSENTEVENTS' (%d)", ret);
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((sub >= 0), "Subscriber not added");
+        fct_xchk((_attoHTTPSSESubscribers[sub].stream == 0), "Stream was %d", _attoHTTPSSESubscribers[sub].stream);
+        attoHTTPSSEPublishStream(0, "", 0, "a", 1);
+        attoHTTPSSEFlush();
+        fct_chk_eq_str("id:1\ndata:a\n\n", sub_buffer[0]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that each stream has its own back pressure policy
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEStreamPolicy) {
+        int8_t sub[2];
+        uint8_t i;
+        attoHTTPSSEAddStream("/a");
+        attoHTTPSSEAddStream("/b");
+        fct_xchk((attoHTTPSSESetPolicy(1, SSE_DROP_OLDEST, 32) == 1), "Set policy failed");
+        sub[0] = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPExecute((void *)"GET /b HTTP/1.0\r\n\r\n", (void *)write_buffer);
+        sub[1] = attoHTTPSSEAdd((void *)sub_buffer[1], TestSSEClose);
+        for (i = 0; i < 4; i++) {
+            attoHTTPSSEPublish("", 0, "0123456789", 10);
+        }
+        // Stream 0 still has the default high water mark
+        fct_xchk((attoHTTPSSEPending(sub[0]) == 4 * 22), "Stream 0 dropped events");
+        fct_xchk((attoHTTPSSEPending(sub[1]) == 22), "Stream 1 kept too much");
+        attoHTTPSSEFlush();
+        fct_chk_eq_str("id:4\ndata:0123456789\n\n", sub_buffer[1]);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a subscriber skips events from other streams without writing
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEStreamSkipped) {
+        int8_t sub;
+        attoHTTPSSEAddStream("/a");
+        attoHTTPSSEAddStream("/b");
+        sub = attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        attoHTTPSSEPublishStream(1, "", 0, "b", 1);
+        attoHTTPSSEPublishStream(1, "", 0, "b", 1);
+        fct_xchk((attoHTTPSSEFlush() == 1), "Subscriber not caught up");
+        fct_xchk((attoHTTPSSEPending(sub) == 0), "Subscriber has bytes pending");
+        fct_chk_eq_str("", sub_buffer[0]);
+        fct_xchk((close_count == 0), "Subscriber was closed");
+    }
+    FCT_TEST_END()
+#ifdef ATTOHTTP_SSE_QUEUE
+    /**
+     * @brief This tests that queued events are published in order by attoHTTPSSEPoll
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEQueue) {
+        attoHTTPSSEAddStream("/a");
+        attoHTTPSSEAddStream("/b");
+        attoHTTPSSEAdd((void *)sub_buffer[0], TestSSEClose);
+        fct_xchk((attoHTTPSSEQueue(SSE_ALL_STREAMS, "x", 1, "one", 3) == 1), "Queue failed");
+        fct_xchk((attoHTTPSSEQueue(1, "", 0, "skip", 4) == 1), "Queue failed");
+        fct_xchk((attoHTTPSSEQueue(0, "", 0, "two", 3) == 1), "Queue failed");
+        fct_xchk((attoHTTPSSELastID() == 0), "Queue published right away");
+        attoHTTPSSEPoll(0);
+        fct_xchk((attoHTTPSSELastID() == 3), "Queue was not drained");
+        fct_chk_eq_str("", sub_buffer[0]);
+        attoHTTPSSEPoll(ATTOHTTP_SSE_FLUSH_WINDOW);
+        fct_chk_eq_str("id:1\nevent:x\ndata:one\n\nid:3\ndata:two\n\n", sub_buffer[0]);
+        fct_xchk((attoHTTPSSEDrain() == 0), "Queue not empty");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a full queue, and events too big for a slot
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEQueueFull) {
+        char big[ATTOHTTP_SSE_QUEUE_EVENT_SIZE + 1];
+        uint8_t i;
+        memset(big, 'a', sizeof(big));
+        fct_xchk((attoHTTPSSEQueue(0, "e", 1, big, ATTOHTTP_SSE_QUEUE_EVENT_SIZE) == 0), "Took an event too big");
+        fct_xchk((attoHTTPSSEQueue(0, "", 0, big, ATTOHTTP_SSE_QUEUE_EVENT_SIZE) == 1), "Full sized event failed");
+        for (i = 1; i < ATTOHTTP_SSE_QUEUE_SLOTS; i++) {
+            fct_xchk((attoHTTPSSEQueue(0, "", 0, "a", 1) == 1), "Queue %d failed", i);
+        }
+        fct_xchk((attoHTTPSSEQueue(0, "", 0, "a", 1) == 0), "Queued into a full queue");
+        fct_xchk((attoHTTPSSEDrain() == ATTOHTTP_SSE_QUEUE_SLOTS), "Drain missed some");
+        // Going around the queue a second time works the same
+        for (i = 0; i < ATTOHTTP_SSE_QUEUE_SLOTS; i++) {
+            fct_xchk((attoHTTPSSEQueue(0, "", 0, "a", 1) == 1), "Queue %d failed", i);
+        }
+        fct_xchk((attoHTTPSSEQueue(0, "", 0, "a", 1) == 0), "Queued into a full queue");
+        fct_xchk((attoHTTPSSEDrain() == ATTOHTTP_SSE_QUEUE_SLOTS), "Drain missed some");
+        fct_xchk((attoHTTPSSELastID() == (2 * ATTOHTTP_SSE_QUEUE_SLOTS)), "Events went missing");
+    }
+    FCT_TEST_END()
+#endif
 
 }
 FCTMF_FIXTURE_SUITE_END();
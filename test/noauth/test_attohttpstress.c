@@ -31,6 +31,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
 #include "attohttp.h"
 #include "test.h"
 #include "bigfile.h"
@@ -39,6 +42,7 @@ static const uint8_t default_content[] = "Default";
 static const char default_return[] = "HTTP/1.0 200 OK\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: 8\r\n\r\nDefault";
 
 #define WRITE_BUFFER_SIZE 1024
+#define PARAM_ROUNDS 65535
 #define CheckUnsupported(ret) fct_xchk((ret == STATUS_UNSUPPORTED), "Return was not 'STATUS_UNSUPPORTED'"); fct_chk_eq_str("HTTP/1.0 501 Not Implemented\r\n", write_buffer)
 #define CheckNotFound(ret) fct_xchk((ret == STATUS_NOT_FOUND), "Return was not 'STATUS_NOT_FOUND'"); fct_chk_eq_str("HTTP/1.0 404 Not Found\r\n", write_buffer)
 #define CheckDefault(ret) fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'"); fct_chk_eq_str(default_return, write_buffer)
@@ -46,6 +50,278 @@ static const char default_return[] = "HTTP/1.0 200 OK\r\nContent-Type: text/html
 
 char write_buffer[WRITE_BUFFER_SIZE];
 
+/**
+ * @brief Gets the monotonic time in ns
+ */
+static uint64_t
+StressNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+#ifdef ATTOHTTP_SSE_QUEUE
+#define QUEUE_EVENTS 20000
+/**
+ * @brief What each producer thread in the queue benchmark keeps track of
+ */
+typedef struct {
+    pthread_t thread;
+    uint64_t total;
+    uint64_t max;
+    uint32_t full;
+} queue_producer_t;
+/**
+ * @brief Queues QUEUE_EVENTS events, timing each one
+ */
+static void *
+QueueProducer(void *arg)
+{
+    queue_producer_t *p = (queue_producer_t *)arg;
+    char data[16];
+    uint32_t i;
+    uint64_t start, took;
+    int len;
+    for (i = 0; i < QUEUE_EVENTS; i++) {
+        len = snprintf(data, sizeof(data), "%" PRIu32, i);
+        // Waiting on a full queue is part of what it costs to publish
+        start = StressNow();
+        for (;;) {
+            if (attoHTTPSSEQueue(SSE_ALL_STREAMS, "", 0, data, len)) {
+                break;
+            }
+            p->full++;
+            sched_yield();
+        }
+        took = StressNow() - start;
+        p->total += took;
+        if (took > p->max) {
+            p->max = took;
+        }
+    }
+    return NULL;
+}
+/**
+ * @brief Runs producers threads against the queue while this thread drains it
+ *
+ * @return 1 if every event got published, 0 otherwise
+ */
+static uint8_t
+QueueContention(uint8_t producers)
+{
+    queue_producer_t p[8];
+    uint64_t total = 0, max = 0;
+    uint32_t full = 0;
+    uint32_t events = producers * QUEUE_EVENTS;
+    uint8_t i;
+    memset(p, 0, sizeof(p));
+    attoHTTPInit();
+    for (i = 0; i < producers; i++) {
+        pthread_create(&p[i].thread, NULL, QueueProducer, &p[i]);
+    }
+    while (attoHTTPSSELastID() < events) {
+        if (attoHTTPSSEDrain() == 0) {
+            sched_yield();
+        }
+    }
+    for (i = 0; i < producers; i++) {
+        pthread_join(p[i].thread, NULL);
+        total += p[i].total;
+        full += p[i].full;
+        if (p[i].max > max) {
+            max = p[i].max;
+        }
+    }
+    printf(
+        "\n%d producers: %" PRIu32 " events, %" PRIu64 " ns average, %" PRIu64 " ns max, %" PRIu32 " times full\n",
+        producers, events, total / events, max, full
+    );
+    return (attoHTTPSSELastID() == events) && (attoHTTPSSEDrain() == 0);
+}
+#endif
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+#define DEFLATE_ROUNDS 2000
+#define DEFLATE_UPGRADE "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n"
+/**
+ * @brief Telemetry frames, the way a sensor node sends them once a second
+ *
+ * Each one gets the time and a reading that changes put into it.
+ */
+static const char *telemetry[] = {
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.%02u,\"hum\":40.2,\"pres\":1013.25,\"vbat\":3.712,\"rssi\":-61}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.50,\"hum\":40.%u,\"pres\":1013.24,\"vbat\":3.712,\"rssi\":-62}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.51,\"hum\":40.1,\"pres\":1013.%02u,\"vbat\":3.711,\"rssi\":-61}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.53,\"hum\":40.1,\"pres\":1013.25,\"vbat\":3.7%02u,\"rssi\":-60}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"alarm\":{\"id\":%u,\"level\":\"warn\",\"text\":\"door open\"},\"temp\":21.55}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.56,\"hum\":40.0,\"pres\":1013.27,\"vbat\":3.710,\"rssi\":-%u}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"accel\":[0.0%02u,-0.003,0.981,0.011,-0.004,0.980,0.013,-0.002,0.982]}",
+    "{\"t\":%" PRIu32 ",\"dev\":\"node-07\",\"temp\":21.58,\"hum\":40.0,\"pres\":1013.26,\"vbat\":3.710,\"rssi\":-%u}",
+};
+static uint16_t deflate_len;
+/**
+ * @brief Keeps the length of the last message, to check the round trip
+ */
+static void
+DeflateMessage(int8_t ws, wsopcode_t opcode, uint8_t *data, uint16_t len)
+{
+    deflate_len = len;
+}
+/**
+ * @brief Sends the telemetry frames over and over, and times it
+ *
+ * If inflate is set, every compressed frame is also sent back in, to time
+ * inflating it.  That only works without context takeover, since the client
+ * side is never allowed to keep its context.
+ *
+ * @return 1 if every frame went out and came back right, 0 otherwise
+ */
+static uint8_t
+DeflateTelemetry(const char *name, const char *request, uint8_t inflate)
+{
+    uint8_t frame[WRITE_BUFFER_SIZE];
+    char data[128];
+    uint64_t raw = 0, sent = 0, deflate = 0, inflated = 0, start;
+    uint32_t i;
+    uint16_t len, f, j;
+    uint8_t k, good = 1;
+    int8_t ws;
+    const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    TestInit();
+    attoHTTPInit();
+    attoHTTPAddWebSocket("/ws", DeflateMessage);
+    if (attoHTTPExecute((void *)request, (void *)write_buffer) != STATUS_SWITCHING_PROTOCOLS) {
+        return 0;
+    }
+    ws = attoHTTPWebSocketAdd((void *)"", (void *)write_buffer, NULL);
+    for (i = 0; i < DEFLATE_ROUNDS; i++) {
+        for (k = 0; k < (sizeof(telemetry) / sizeof(telemetry[0])); k++) {
+            len = snprintf(data, sizeof(data), telemetry[k], 1700000000 + i, (unsigned)((i * 7 + k) % 100));
+            TestWriteCount = 0;
+            start = StressNow();
+            good &= attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)data, len);
+            deflate += StressNow() - start;
+            raw += len;
+            sent += TestWriteCount - 2;
+            if (inflate && ((write_buffer[0] & 0x40) != 0)) {
+                // Send it back in, masked like a client would
+                frame[0] = write_buffer[0];
+                frame[1] = 0x80 | write_buffer[1];
+                memcpy(&frame[2], mask, sizeof(mask));
+                f = 6;
+                for (j = 0; j < (TestWriteCount - 2); j++) {
+                    frame[f++] = write_buffer[j + 2] ^ mask[j & 3];
+                }
+                TestReadString = frame;
+                TestReadCount = 0;
+                TestReadLength = f;
+                deflate_len = 0;
+                start = StressNow();
+                good &= (attoHTTPWebSocketRead(ws) == 1);
+                inflated += StressNow() - start;
+                good &= (deflate_len == len);
+            }
+        }
+    }
+    i = DEFLATE_ROUNDS * (sizeof(telemetry) / sizeof(telemetry[0]));
+    printf(
+        "\n%s: %" PRIu64 " bytes to %" PRIu64 " (%.1f%%), send %" PRIu64 " ns/frame %.2f ns/byte",
+        name, raw, sent, (100.0 * sent) / raw, deflate / i, (double)deflate / raw
+    );
+    if (inflate) {
+        printf(", inflate %" PRIu64 " ns/frame", inflated / i);
+    }
+    printf("\n");
+    attoHTTPWebSocketRemove(ws);
+    return good;
+}
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+#define RATE_ROUNDS 100000
+/**
+ * @brief Times turning away a client that is over its limit
+ *
+ * This compares it to serving the same client's request all the way through.
+ *
+ * @return 1 if everything was turned away, 0 otherwise
+ */
+static uint8_t
+RateLimitCost(void)
+{
+    static const char request[] = "GET /api/status HTTP/1.1\r\nHost: device.local\r\nUser-Agent: poller/1.0\r\nAccept: application/json\r\nConnection: close\r\n\r\n";
+    uint64_t start, rejected, served, admit;
+    uint32_t i;
+    uint8_t good = 1;
+    attoHTTPDefaultPage("/", default_content, sizeof(default_content), TEXT_HTML);
+    while (attoHTTPPeerOpen(0x0A000001, 0)) {
+        attoHTTPPeerClose(0x0A000001);
+    }
+    start = StressNow();
+    for (i = 0; i < RATE_ROUNDS; i++) {
+        TestInit();
+        good &= !attoHTTPPeerOpen(0x0A000001, 0);
+        attoHTTPReject((void *)write_buffer, STATUS_TOO_MANY_REQUESTS);
+    }
+    rejected = StressNow() - start;
+    start = StressNow();
+    for (i = 0; i < RATE_ROUNDS; i++) {
+        if (attoHTTPPeerOpen(0xC0A80000 + (i & 0xFF), i * 1000)) {
+            attoHTTPPeerClose(0xC0A80000 + (i & 0xFF));
+        }
+    }
+    admit = StressNow() - start;
+    start = StressNow();
+    for (i = 0; i < RATE_ROUNDS; i++) {
+        TestInit();
+        attoHTTPExecute((void *)request, (void *)write_buffer);
+    }
+    served = StressNow() - start;
+    printf(
+        "\nrate limit: reject %" PRIu64 " ns, open/close with 256 peers %" PRIu64 " ns, serving it %" PRIu64 " ns\n",
+        rejected / RATE_ROUNDS, admit / RATE_ROUNDS, served / RATE_ROUNDS
+    );
+    return good;
+}
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+/**
+ * @brief Stands in for the REST handler when sorting requests
+ *
+ * @return STATUS_OK always
+ */
+static returncode_t
+RequestQueueREST(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+{
+    return STATUS_OK;
+}
+/**
+ * @brief Times sorting a request by its request line and putting it in line
+ *
+ * @return 1 if every request went in the right line, 0 otherwise
+ */
+static uint8_t
+RequestQueueCost(void)
+{
+    static const uint8_t line[] = "GET /api/status/sensors?fields=temp,humidity HTTP/1.1\r\nHost: device.local\r\n";
+    static const char *urls[] = {"/index.html", "/app.js", "/app.css", "/logo.png", "/setup.html", "/status.html", "/events"};
+    uint64_t start, classify;
+    uint32_t i;
+    uint8_t good = 1;
+    int conn;
+    for (i = 0; i < (sizeof(urls) / sizeof(urls[0])); i++) {
+        attoHTTPAddPage(urls[i], default_content, sizeof(default_content), TEXT_HTML);
+    }
+    attoHTTPDefaultREST(RequestQueueREST);
+    start = StressNow();
+    for (i = 0; i < RATE_ROUNDS; i++) {
+        good &= attoHTTPQueueAdd(&conn, attoHTTPClassify(line, sizeof(line) - 1));
+        good &= (attoHTTPQueueNext() == &conn);
+    }
+    classify = StressNow() - start;
+    printf("\nrequest queue: classify, add and take %" PRIu64 " ns with 8 pages\n", classify / RATE_ROUNDS);
+    return good;
+}
+#endif
+
 FCTMF_FIXTURE_SUITE_BGN(test_attohttpstress)
 {
     /**
@@ -123,6 +399,105 @@ FCTMF_FIXTURE_SUITE_BGN(test_attohttpstress)
 
     }
     FCT_TEST_END()
+    /**
+     * @brief This times looking up parameters in a 10 parameter query
+     *
+     * The first lookup decodes the parameters into the index, so it is timed
+     * apart from the ones after it.
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testGETManyParamsManyTimes) {
+        returncode_t ret;
+        uint32_t i;
+        uint64_t start, total, first = 0, later = 0;
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            const char *b, *a, *j;
+            uint64_t t0, t1, t2;
+            t0 = StressNow();
+            b = attoHTTPGetURLParam("b");
+            t1 = StressNow();
+            a = attoHTTPGetURLParam("a");
+            j = attoHTTPGetURLParam("j");
+            t2 = StressNow();
+            first += t1 - t0;
+            later += t2 - t1;
+            if ((b == NULL) || (a == NULL) || (j == NULL) || (*b != '2') || (*a != '1') || (*j != '1')) {
+                return STATUS_INTERNAL_ERROR;
+            }
+            return STATUS_OK;
+        }
+        char read_buffer[] = "GET /level1?a=1&b=2&c=3&d=4&e=5&f=6&g=7&h=8&i=9&j=10 HTTP/1.0\r\n\r\n";
+        attoHTTPDefaultREST(testCallback);
+
+        start = StressNow();
+        for (i = 0; i < PARAM_ROUNDS; i++) {
+            NewConnection();
+            ret = attoHTTPExecute(
+                (void *)read_buffer,
+                (void *)write_buffer
+            );
+            fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+        }
+        total = StressNow() - start;
+        printf(
+            "\nURL params: request with 10 params %" PRIu64 " ns, first lookup %" PRIu64 " ns, 2 more lookups %" PRIu64 " ns\n",
+            total / PARAM_ROUNDS, first / PARAM_ROUNDS, later / PARAM_ROUNDS
+        );
+    }
+    FCT_TEST_END()
+#ifdef ATTOHTTP_SSE_QUEUE
+    /**
+     * @brief This times queueing events from 4 and 8 threads at once
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testSSEQueueContention) {
+        fct_xchk(QueueContention(4), "4 producers lost events");
+        fct_xchk(QueueContention(8), "8 producers lost events");
+    }
+    FCT_TEST_END()
+#endif
+#ifdef ATTOHTTP_RATE_LIMIT
+    /**
+     * @brief This times turning away a client that is over its limit
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRateLimitCost) {
+        fct_xchk(RateLimitCost(), "Client over its limit was let in");
+    }
+    FCT_TEST_END()
+#endif
+#ifdef ATTOHTTP_REQUEST_QUEUE
+    /**
+     * @brief This times sorting requests into the request queue
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testRequestQueueCost) {
+        fct_xchk(RequestQueueCost(), "Request went in the wrong line");
+    }
+    FCT_TEST_END()
+#endif
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    /**
+     * @brief This measures permessage-deflate on recorded telemetry frames
+     *
+     * The first run doesn't compress, so the cost of compressing is the
+     * difference between it and the others.
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketDeflateTelemetry) {
+        fct_xchk(DeflateTelemetry("none", DEFLATE_UPGRADE "\r\n", 0), "Plain frames failed");
+        fct_xchk(DeflateTelemetry("no context takeover", DEFLATE_UPGRADE "Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover\r\n\r\n", 1), "Frames didn't round trip");
+        fct_xchk(DeflateTelemetry("context takeover", DEFLATE_UPGRADE "Sec-WebSocket-Extensions: permessage-deflate\r\n\r\n", 0), "Context takeover frames failed");
+        fct_xchk(DeflateTelemetry("9 bit window", DEFLATE_UPGRADE "Sec-WebSocket-Extensions: permessage-deflate; server_max_window_bits=9\r\n\r\n", 0), "9 bit window frames failed");
+    }
+    FCT_TEST_END()
+#endif
 
 }
 FCTMF_FIXTURE_SUITE_END();
@@ -0,0 +1,260 @@
+/**
+ * @file    test/test_attohttpupload.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define WRITE_BUFFER_SIZE 1024
+
+char write_buffer[WRITE_BUFFER_SIZE];
+
+uint8_t upload_data[2048];
+uint32_t upload_len;
+uint16_t upload_blocks;
+uint8_t upload_last;
+uint8_t upload_bad_offset;
+uint16_t upload_bad_size;
+
+uint8_t
+testUploadHandler(const uint8_t *data, uint16_t len, uint32_t offset, uint8_t last)
+{
+    if (offset != upload_len) {
+        upload_bad_offset = 1;
+    }
+    if (!last && (len != 64)) {
+        upload_bad_size = len;
+    }
+    memcpy(&upload_data[upload_len], data, len);
+    upload_len += len;
+    upload_blocks++;
+    upload_last = last;
+    return 1;
+}
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttpupload)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        memset(upload_data, 0, sizeof(upload_data));
+        upload_len = 0;
+        upload_blocks = 0;
+        upload_last = 0;
+        upload_bad_offset = 0;
+        upload_bad_size = 0;
+        attoHTTPInit();
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests an upload that is many blocks long
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadBlocks) {
+        returncode_t ret;
+        char read_buffer[2048];
+        char body[1001];
+        uint16_t i;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint32_t block[16];
+            int32_t total;
+            total = attoHTTPUpload(testUploadHandler, (uint8_t *)block, sizeof(block));
+            fct_xchk((total == 1000), "Total was %d not 1000", total);
+            fct_xchk((upload_blocks == 16), "Blocks was %d not 16", upload_blocks);
+            fct_xchk((upload_last == 1), "Last was not set");
+            fct_xchk((upload_bad_offset == 0), "Offset was wrong");
+            fct_xchk((upload_bad_size == 0), "Got a short block of %d", upload_bad_size);
+            fct_xchk((memcmp(upload_data, body, 1000) == 0), "Data was wrong");
+            return STATUS_OK;
+        }
+        for (i = 0; i < 1000; i++) {
+            body[i] = 'A' + (i % 26);
+        }
+        body[1000] = 0;
+        snprintf(read_buffer, sizeof(read_buffer), "PUT /fw HTTP/1.1\r\nContent-Length: 1000\r\n\r\n%s", body);
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)read_buffer,
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+        fct_chk_eq_str("HTTP/1.0 200 OK\r\n", write_buffer);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests an upload that is an exact number of blocks
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadExactBlocks) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            int32_t total;
+            total = attoHTTPUpload(testUploadHandler, block, sizeof(block));
+            fct_xchk((total == 16), "Total was %d not 16", total);
+            fct_xchk((upload_blocks == 2), "Blocks was %d not 2", upload_blocks);
+            fct_xchk((upload_last == 1), "Last was not set");
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.0\r\nContent-Length: 16\r\n\r\n0123456789abcdef",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the client sending less than it said it would
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadShort) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            int32_t total;
+            total = attoHTTPUpload(testUploadHandler, block, sizeof(block));
+            fct_xchk((total == -1), "Total was %d not -1", total);
+            fct_xchk((upload_len == 10), "Length was %d not 10", upload_len);
+            return STATUS_BADREQUEST;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.0\r\nContent-Length: 100\r\n\r\n0123456789",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_BADREQUEST), "Return was not 'STATUS_BADREQUEST'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the handler stopping the upload
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadHandlerStops) {
+        returncode_t ret;
+
+        uint8_t stopHandler(const uint8_t *data, uint16_t len, uint32_t offset, uint8_t last)
+        {
+            upload_blocks++;
+            return 0;
+        }
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            int32_t total;
+            total = attoHTTPUpload(stopHandler, block, sizeof(block));
+            fct_xchk((total == -1), "Total was %d not -1", total);
+            fct_xchk((upload_blocks == 1), "Blocks was %d not 1", upload_blocks);
+            return STATUS_INTERNAL_ERROR;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.0\r\nContent-Length: 16\r\n\r\n0123456789abcdef",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_INTERNAL_ERROR), "Return was not 'STATUS_INTERNAL_ERROR'");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests the 100 Continue handshake
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadExpectContinue) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            uint8_t block[8];
+            fct_xchk((write_buffer[0] == 0), "Something was sent before the body was read");
+            attoHTTPUpload(testUploadHandler, block, sizeof(block));
+            return STATUS_OK;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 4\r\n\r\nabcd",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_OK), "Return was not 'STATUS_OK'");
+        fct_chk_eq_str("HTTP/1.1 100 Continue\r\n\r\nHTTP/1.0 200 OK\r\n", write_buffer);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests turning down an upload without reading it
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testUploadExpectContinueRejected) {
+        returncode_t ret;
+
+        returncode_t testCallback(httpmethod_t method, uint16_t accepted, uint8_t **command, uint8_t **id, uint8_t cmdlvl, uint8_t idlvl)
+        {
+            return STATUS_BADREQUEST;
+        }
+
+        attoHTTPDefaultREST(testCallback);
+        ret = attoHTTPExecute(
+            (void *)"PUT /fw HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 4\r\n\r\nabcd",
+            (void *)write_buffer
+        );
+        fct_xchk((ret == STATUS_BADREQUEST), "Return was not 'STATUS_BADREQUEST'");
+        fct_chk_eq_str("HTTP/1.0 400 Bad Request\r\n", write_buffer);
+    }
+    FCT_TEST_END()
+
+}
+FCTMF_FIXTURE_SUITE_END();
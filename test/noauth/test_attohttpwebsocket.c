@@ -0,0 +1,547 @@
+/**
+ * @file    test/test_attohttpwebsocket.c
+ * @brief   A small http server for embedded systems
+ * @details
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 attoHTTP contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "attohttp.h"
+#include "test.h"
+
+#define WRITE_BUFFER_SIZE 1024
+#define UPGRADE_HEADERS "GET /ws HTTP/1.1\r\nHost: server.example.com\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n"
+#define UPGRADE_REQUEST UPGRADE_HEADERS "\r\n"
+#define DEFLATE_REQUEST(ext) UPGRADE_HEADERS "Sec-WebSocket-Extensions: " ext "\r\n\r\n"
+#define UPGRADE_RETURN "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#define CheckFrame(expect, len) fct_xchk(((TestWriteCount - upgrade_len) == (len)), "Wrote %d bytes not %d", (int)(TestWriteCount - upgrade_len), (int)(len)); fct_xchk((memcmp(&write_buffer[upgrade_len], expect, len) == 0), "Frame was wrong")
+
+static const char upgrade_return[] = UPGRADE_RETURN "\r\n";
+static const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+static char write_buffer[WRITE_BUFFER_SIZE];
+static uint32_t upgrade_len;
+static uint8_t message[WRITE_BUFFER_SIZE];
+static uint16_t message_len;
+static wsopcode_t message_opcode;
+static uint8_t message_count;
+static uint8_t echo;
+static void *closed;
+
+static void
+TestWSMessage(int8_t ws, wsopcode_t opcode, uint8_t *data, uint16_t len)
+{
+    memcpy(message, data, len);
+    message_len = len;
+    message_opcode = opcode;
+    message_count++;
+    if (echo) {
+        attoHTTPWebSocketSend(ws, opcode, data, len);
+    }
+}
+
+static void
+TestWSClose(void *write)
+{
+    closed = write;
+}
+/**
+ * @brief Upgrades a connection with the given request and adds it as a WebSocket
+ *
+ * @return The WebSocket handle
+ */
+static int8_t
+TestWSOpenWith(const char *request)
+{
+    returncode_t ret;
+    attoHTTPAddWebSocket("/ws", TestWSMessage);
+    ret = attoHTTPExecute((void *)request, (void *)write_buffer);
+    upgrade_len = TestWriteCount;
+    if (ret != STATUS_SWITCHING_PROTOCOLS) {
+        return -1;
+    }
+    return attoHTTPWebSocketAdd((void *)"", (void *)write_buffer, TestWSClose);
+}
+/**
+ * @brief Upgrades a connection and adds it as a WebSocket
+ *
+ * @return The WebSocket handle
+ */
+static int8_t
+TestWSOpen(void)
+{
+    return TestWSOpenWith(UPGRADE_REQUEST);
+}
+/**
+ * @brief Sets up the bytes for the next attoHTTPWebSocketRead()
+ *
+ * @return None
+ */
+static void
+TestWSInput(const uint8_t *frame, uint16_t len)
+{
+    TestReadString = (uint8_t *)frame;
+    TestReadCount = 0;
+    TestReadLength = len;
+}
+/**
+ * @brief Builds a masked frame, the way a client would send it
+ *
+ * @return The length of the frame
+ */
+static uint16_t
+TestWSFrame(uint8_t *frame, uint8_t first, const char *payload, uint16_t len)
+{
+    uint16_t i;
+    uint16_t f = 0;
+    frame[f++] = first;
+    if (len < 126) {
+        frame[f++] = 0x80 | len;
+    } else {
+        frame[f++] = 0x80 | 126;
+        frame[f++] = len >> 8;
+        frame[f++] = len & 0xFF;
+    }
+    memcpy(&frame[f], mask, sizeof(mask));
+    f += sizeof(mask);
+    for (i = 0; i < len; i++) {
+        frame[f++] = payload[i] ^ mask[i & 3];
+    }
+    return f;
+}
+
+FCTMF_FIXTURE_SUITE_BGN(test_attohttpwebsocket)
+{
+    /**
+    * @brief This sets up this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_SETUP_BGN() {
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        upgrade_len = 0;
+        message_len = 0;
+        message_count = 0;
+        echo = 0;
+        closed = NULL;
+        attoHTTPInit();
+    }
+    FCT_SETUP_END();
+    /**
+    * @brief This tears down this suite
+    *
+    * @return 0 success, otherwise failure
+    */
+    FCT_TEARDOWN_BGN() {
+    } FCT_TEARDOWN_END();
+    /**
+     * @brief This tests the upgrade, with the example key from RFC 6455
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketUpgrade) {
+        returncode_t ret;
+        attoHTTPAddWebSocket("/ws", TestWSMessage);
+        ret = attoHTTPExecute((void *)UPGRADE_REQUEST, (void *)write_buffer);
+        fct_xchk((ret == STATUS_SWITCHING_PROTOCOLS), "Return was not 'STATUS_SWITCHING_PROTOCOLS' (%d)", ret);
+        fct_chk_eq_str(upgrade_return, write_buffer);
+        fct_xchk((attoHTTPWebSocketAdd((void *)"", (void *)write_buffer, TestWSClose) == 0), "Add failed");
+        fct_xchk((attoHTTPWebSocketAdd((void *)"", (void *)write_buffer, TestWSClose) == -1), "Added without an upgrade");
+        fct_xchk((attoHTTPWebSocketCount() == 1), "Count is wrong");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests requests to a WebSocket URL that can't be upgraded
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketBadUpgrade) {
+        returncode_t ret;
+        attoHTTPAddWebSocket("/ws", TestWSMessage);
+        ret = attoHTTPExecute((void *)"GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_BADREQUEST), "No key was not 'STATUS_BADREQUEST' (%d)", ret);
+        TestInit();
+        ret = attoHTTPExecute((void *)"GET /ws HTTP/1.0\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_BADREQUEST), "HTTP/1.0 was not 'STATUS_BADREQUEST' (%d)", ret);
+        TestInit();
+        ret = attoHTTPExecute((void *)"GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 8\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_BADREQUEST), "Version 8 was not 'STATUS_BADREQUEST' (%d)", ret);
+        TestInit();
+        ret = attoHTTPExecute((void *)"GET /other HTTP/1.1\r\n\r\n", (void *)write_buffer);
+        fct_xchk((ret == STATUS_NOT_FOUND), "Other URL was not 'STATUS_NOT_FOUND' (%d)", ret);
+        fct_xchk((attoHTTPWebSocketAdd((void *)"", (void *)write_buffer, TestWSClose) == -1), "Added without an upgrade");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a masked text message from RFC 6455, and sending one back
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketMessage) {
+        int8_t ws;
+        const uint8_t frame[] = {0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58};
+        const uint8_t expect[] = {0x81, 0x05, 'H', 'e', 'l', 'l', 'o'};
+        ws = TestWSOpen();
+        fct_xchk((ws >= 0), "Open failed");
+        echo = 1;
+        TestWSInput(frame, sizeof(frame));
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((message_count == 1), "Callback called %d times", message_count);
+        fct_xchk((message_opcode == WS_TEXT), "Opcode was not WS_TEXT");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Message was wrong");
+        CheckFrame(expect, sizeof(expect));
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a frame that comes in over several reads
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketPartial) {
+        int8_t ws;
+        const uint8_t frame[] = {0x82, 0x85, 0x37, 0xfa, 0x21, 0x3d, 0x7f, 0x9f, 0x4d, 0x51, 0x58};
+        ws = TestWSOpen();
+        TestWSInput(frame, 3);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 0), "Read didn't wait for more");
+        TestWSInput(&frame[3], 5);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 0), "Read didn't wait for more");
+        TestWSInput(&frame[8], 3);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((message_opcode == WS_BINARY), "Opcode was not WS_BINARY");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Message was wrong");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests putting fragments back together, with a ping in the middle
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketFragments) {
+        int8_t ws;
+        uint8_t frame[64];
+        uint16_t len;
+        const uint8_t pong[] = {0x8A, 0x02, 'h', 'i'};
+        ws = TestWSOpen();
+        len = TestWSFrame(frame, 0x01, "Hel", 3);
+        len += TestWSFrame(&frame[len], 0x89, "hi", 2);
+        len += TestWSFrame(&frame[len], 0x80, "lo", 2);
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((message_count == 0), "Callback called too soon");
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        CheckFrame(pong, sizeof(pong));
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((message_count == 1), "Callback called %d times", message_count);
+        fct_xchk((message_opcode == WS_TEXT), "Opcode was not WS_TEXT");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Message was wrong");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a message with a 16 bit length, in and out
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketLong) {
+        int8_t ws;
+        char payload[200];
+        uint8_t frame[256];
+        uint16_t len;
+        uint16_t i;
+        for (i = 0; i < sizeof(payload); i++) {
+            payload[i] = 'a' + (i % 26);
+        }
+        ws = TestWSOpen();
+        echo = 1;
+        len = TestWSFrame(frame, 0x82, payload, sizeof(payload));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk(((message_len == sizeof(payload)) && (memcmp(message, payload, sizeof(payload)) == 0)), "Message was wrong");
+        fct_xchk(((uint8_t)write_buffer[upgrade_len + 1] == 126), "Didn't use a 16 bit length");
+        fct_xchk(((uint8_t)write_buffer[upgrade_len + 3] == sizeof(payload)), "Length was wrong");
+        fct_xchk((memcmp(&write_buffer[upgrade_len + 4], payload, sizeof(payload)) == 0), "Payload was wrong");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that the close code is sent back
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketClientClose) {
+        int8_t ws;
+        uint8_t frame[16];
+        uint16_t len;
+        const uint8_t expect[] = {0x88, 0x02, 0x03, 0xE8};
+        ws = TestWSOpen();
+        len = TestWSFrame(frame, 0x88, "\x03\xE8", 2);
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Connection not closed");
+        CheckFrame(expect, sizeof(expect));
+        fct_xchk((closed == (void *)write_buffer), "Close callback not called");
+        fct_xchk((attoHTTPWebSocketCount() == 0), "Count is wrong");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that frames that break the rules close the connection
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketProtocolError) {
+        int8_t ws;
+        const uint8_t unmasked[] = {0x81, 0x02, 'h', 'i'};
+        const uint8_t continuation[] = {0x80, 0x80, 0x37, 0xfa, 0x21, 0x3d};
+        const uint8_t expect[] = {0x88, 0x02, 0x03, 0xEA};
+        ws = TestWSOpen();
+        TestWSInput(unmasked, sizeof(unmasked));
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Unmasked frame didn't close");
+        CheckFrame(expect, sizeof(expect));
+        fct_xchk((closed == (void *)write_buffer), "Close callback not called");
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ws = TestWSOpen();
+        TestWSInput(continuation, sizeof(continuation));
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Stray continuation didn't close");
+        CheckFrame(expect, sizeof(expect));
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests a message too big for the buffer
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketTooBig) {
+        int8_t ws;
+        const uint8_t frame[] = {0x82, 0xFE, (ATTOHTTP_WEBSOCKET_BUFFER_SIZE + 1) >> 8, (ATTOHTTP_WEBSOCKET_BUFFER_SIZE + 1) & 0xFF, 0x37, 0xfa, 0x21, 0x3d};
+        const uint8_t expect[] = {0x88, 0x02, 0x03, 0xF1};
+        ws = TestWSOpen();
+        TestWSInput(frame, sizeof(frame));
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Connection not closed");
+        CheckFrame(expect, sizeof(expect));
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests that a read with nothing there means the client left
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketGone) {
+        int8_t ws;
+        ws = TestWSOpen();
+        TestWSInput((const uint8_t *)"", 0);
+        TestReadLength = 0;
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Connection not closed");
+        fct_xchk((closed == (void *)write_buffer), "Close callback not called");
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Read on a closed connection");
+        fct_xchk((attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)"a", 1) == 0), "Sent on a closed connection");
+    }
+    FCT_TEST_END()
+#ifdef ATTOHTTP_WEBSOCKET_DEFLATE
+    /**
+     * @brief This tests taking and turning down permessage-deflate offers
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketDeflateOffer) {
+        returncode_t ret;
+        attoHTTPAddWebSocket("/ws", TestWSMessage);
+        ret = attoHTTPExecute((void *)DEFLATE_REQUEST("permessage-deflate; client_max_window_bits"), (void *)write_buffer);
+        fct_xchk((ret == STATUS_SWITCHING_PROTOCOLS), "Return was not 'STATUS_SWITCHING_PROTOCOLS' (%d)", ret);
+        fct_chk_eq_str(UPGRADE_RETURN "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover\r\n\r\n", write_buffer);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPExecute((void *)DEFLATE_REQUEST("foo, permessage-deflate; server_no_context_takeover"), (void *)write_buffer);
+        fct_chk_eq_str(UPGRADE_RETURN "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover; server_no_context_takeover\r\n\r\n", write_buffer);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPExecute((void *)DEFLATE_REQUEST("permessage-deflate; server_max_window_bits=\"9\""), (void *)write_buffer);
+        fct_chk_eq_str(UPGRADE_RETURN "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover; server_max_window_bits=9\r\n\r\n", write_buffer);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPExecute((void *)DEFLATE_REQUEST("permessage-deflate; server_max_window_bits=15"), (void *)write_buffer);
+        fct_chk_eq_str(UPGRADE_RETURN "Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover; server_max_window_bits=" XSTR(ATTOHTTP_WEBSOCKET_DEFLATE_BITS) "\r\n\r\n", write_buffer);
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPExecute((void *)DEFLATE_REQUEST("permessage-deflate; server_max_window_bits=16, permessage-deflate; foo"), (void *)write_buffer);
+        fct_chk_eq_str(upgrade_return, write_buffer);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests compressed messages from the client
+     *
+     * The first two are the "Hello" examples from RFC 7692.  The last one is
+     * from zlib, and uses dynamic Huffman codes.
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketDeflateMessage) {
+        int8_t ws;
+        uint8_t frame[128];
+        uint16_t len;
+        const char hello[] = {0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00};
+        const char stored[] = {0x00, 0x05, 0x00, 0xfa, 0xff, 'H', 'e', 'l', 'l', 'o', 0x00};
+        const char dynamic[] = {
+            0x3c, 0xcb, 0x3b, 0x0e, 0x80, 0x20, 0x10, 0x00, 0xd1, 0xbb, 0x6c, 0xbd, 0x12, 0x16, 0x95, 0xdf,
+            0x55, 0x8c, 0x85, 0x46, 0x12, 0x1b, 0xd4, 0x08, 0xda, 0x18, 0xef, 0x2e, 0x16, 0x4b, 0xf3, 0xaa,
+            0x99, 0x07, 0x96, 0x70, 0x83, 0x87, 0x14, 0xb6, 0xb4, 0x9f, 0x0d, 0x01, 0x42, 0x0e, 0xf1, 0x00,
+            0x3f, 0x28, 0x12, 0x3d, 0x32, 0xba, 0x62, 0x2a, 0xf6, 0xc7, 0xa1, 0x52, 0x42, 0xfe, 0xd0, 0x88,
+            0xb0, 0x5e, 0xb1, 0x9c, 0x9d, 0x14, 0x0a, 0x19, 0xaa, 0x48, 0x6c, 0x5d, 0xe9, 0x19, 0x5b, 0x31,
+            0xe5, 0xbc, 0xe7, 0x29, 0x97, 0xb5, 0x15, 0x86, 0x90, 0x91, 0x8c, 0x76, 0xe3, 0xfb, 0x01
+        };
+        const char telemetry[] = "{\"dev\":\"sensor-1\",\"temp\":[21.5,21.5,21.6,21.6,21.7,21.7,21.8,21.9,22.0,22.1],\"hum\":[40.2,40.2,40.1,40.1,40.0,39.9,39.9,39.8,39.8,39.7],\"vbat\":[3.71,3.71,3.70,3.70,3.69]}";
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        fct_xchk((ws >= 0), "Open failed");
+        len = TestWSFrame(frame, 0xC1, hello, sizeof(hello));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Fixed Huffman message was wrong");
+        len = TestWSFrame(frame, 0xC1, stored, sizeof(stored));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Stored message was wrong");
+        len = TestWSFrame(frame, 0x41, hello, 3);
+        len += TestWSFrame(&frame[len], 0x80, &hello[3], sizeof(hello) - 3);
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk(((message_len == 5) && (memcmp(message, "Hello", 5) == 0)), "Fragmented message was wrong");
+        len = TestWSFrame(frame, 0xC2, dynamic, sizeof(dynamic));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((message_opcode == WS_BINARY), "Opcode was not WS_BINARY");
+        fct_xchk(((message_len == strlen(telemetry)) && (memcmp(message, telemetry, message_len) == 0)), "Dynamic Huffman message was wrong");
+        fct_xchk((message_count == 4), "Callback called %d times", message_count);
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests compressing messages to the client, with and without context takeover
+     *
+     * Each compressed message is sent back in to make sure it inflates to what
+     * was sent.
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketDeflateSend) {
+        int8_t ws;
+        uint8_t frame[128];
+        char sent[128];
+        uint16_t len, first;
+        const char telemetry[] = "{\"t\":1700000000,\"dev\":\"sensor-1\",\"temp\":21.5,\"hum\":40.2,\"temp_max\":21.5,\"hum_max\":40.2}";
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        fct_xchk((attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)telemetry, strlen(telemetry)) == 1), "Send failed");
+        fct_xchk(((uint8_t)write_buffer[upgrade_len] == 0xC1), "RSV1 was not set");
+        first = (uint8_t)write_buffer[upgrade_len + 1];
+        fct_xchk((first < strlen(telemetry)), "Compressed is %d bytes", first);
+        memcpy(sent, &write_buffer[upgrade_len + 2], first);
+        len = TestWSFrame(frame, 0xC1, sent, first);
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk(((message_len == strlen(telemetry)) && (memcmp(message, telemetry, message_len) == 0)), "Message didn't inflate right");
+        // The second one can point back at the first
+        TestWriteCount = upgrade_len;
+        attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)telemetry, strlen(telemetry));
+        fct_xchk(((uint8_t)write_buffer[upgrade_len + 1] < (first / 2)), "Context wasn't used (%d bytes)", (uint8_t)write_buffer[upgrade_len + 1]);
+        // Short messages and control frames are sent as they are
+        TestWriteCount = upgrade_len;
+        attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)"hi", 2);
+        CheckFrame("\x81\x02hi", 4);
+
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        attoHTTPInit();
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate; server_no_context_takeover"));
+        attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)telemetry, strlen(telemetry));
+        fct_xchk(((uint8_t)write_buffer[upgrade_len + 1] == first), "Compressed is %d bytes not %d", (uint8_t)write_buffer[upgrade_len + 1], first);
+        TestWriteCount = upgrade_len;
+        attoHTTPWebSocketSend(ws, WS_TEXT, (const uint8_t *)telemetry, strlen(telemetry));
+        fct_xchk(((uint8_t)write_buffer[upgrade_len + 1] == first), "Context was used");
+        fct_xchk((memcmp(&write_buffer[upgrade_len + 2], sent, first) == 0), "Compressed message changed");
+    }
+    FCT_TEST_END()
+    /**
+     * @brief This tests compressed frames that break the rules
+     *
+     * @return void
+     */
+    FCT_TEST_BGN(testWebSocketDeflateErrors) {
+        int8_t ws;
+        uint8_t frame[64];
+        uint16_t len;
+        const char hello[] = {0xf2, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00};
+        const char takeover[] = {0xf2, 0x00, 0x11, 0x00, 0x00};
+        const char big[] = {0x4a, 0x4c, 0x1c, 0x05, 0xc4, 0x02, 0x00, 0x00};
+        const char bad[] = {0xff, 0xff};
+        const uint8_t protocol[] = {0x88, 0x02, 0x03, 0xEA};
+        const uint8_t invalid[] = {0x88, 0x02, 0x03, 0xEF};
+        const uint8_t toobig[] = {0x88, 0x02, 0x03, 0xF1};
+        // RSV1 without permessage-deflate
+        ws = TestWSOpen();
+        len = TestWSFrame(frame, 0xC1, hello, sizeof(hello));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "RSV1 without deflate didn't close");
+        CheckFrame(protocol, sizeof(protocol));
+        // RSV1 on a continuation
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        len = TestWSFrame(frame, 0x41, hello, 3);
+        len += TestWSFrame(&frame[len], 0xC0, &hello[3], sizeof(hello) - 3);
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == 1), "Read failed");
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "RSV1 on a continuation didn't close");
+        CheckFrame(protocol, sizeof(protocol));
+        // A bad block type
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        len = TestWSFrame(frame, 0xC1, bad, sizeof(bad));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Bad data didn't close");
+        CheckFrame(invalid, sizeof(invalid));
+        // Pointing back into the last message, after client_no_context_takeover
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        len = TestWSFrame(frame, 0xC1, takeover, sizeof(takeover));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Context takeover didn't close");
+        CheckFrame(invalid, sizeof(invalid));
+        // Inflates to more than the buffer
+        TestInit();
+        memset(write_buffer, 0, WRITE_BUFFER_SIZE);
+        ws = TestWSOpenWith(DEFLATE_REQUEST("permessage-deflate"));
+        len = TestWSFrame(frame, 0xC1, big, sizeof(big));
+        TestWSInput(frame, len);
+        fct_xchk((attoHTTPWebSocketRead(ws) == -1), "Too big didn't close");
+        CheckFrame(toobig, sizeof(toobig));
+        fct_xchk((message_count == 0), "Callback called %d times", message_count);
+    }
+    FCT_TEST_END()
+#endif
+
+}
+FCTMF_FIXTURE_SUITE_END();